@@ -23,16 +23,28 @@
 
 using namespace tinyrv;
 
-Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor)
+Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const CoreConfig& config)
     : SimObject(ctx, "core")
     , core_id_(core_id)
     , processor_(processor)
+    , config_(config)
     , reg_file_(NUM_REGS)
+    , fetch_buf_(&mmu_)
+    , wbuf_(NULL)
+    , mul_unit_(config.mul_latency)
+    , div_unit_(config.div_latency)
 {
+  if (config.wbuf_size != 0) {
+    wbuf_ = new WriteBuffer(WriteBuffer::Config{config.wbuf_size, MEM_BLOCK_SIZE, config.wbuf_latency}, &mmu_);
+  }
   this->reset();
 }
 
-Core::~Core() {}
+Core::~Core() {
+  if (wbuf_) {
+    delete wbuf_;
+  }
+}
 
 void Core::reset() {
   if_id_.reset();
@@ -48,11 +60,27 @@ void Core::reset() {
   fetched_instrs_ = 0;
   perf_stats_ = PerfStats();
 
+  fetch_buf_.reset();
+
+  if (wbuf_) {
+    wbuf_->reset();
+  }
+
+  mul_unit_.reset();
+  div_unit_.reset();
+  muldiv_pending_ = false;
+
   fetch_stalled_ = false;
+  draining_ = false;
   exited_ = false;
 }
 
 void Core::tick() {
+  // drain buffered stores
+  if (wbuf_) {
+    wbuf_->tick(perf_stats_.cycles);
+  }
+
   this->wb_stage();
   this->mem_stage();
   this->ex_stage();
@@ -64,23 +92,27 @@ void Core::tick() {
 }
 
 void Core::if_stage() {
-  if (fetch_stalled_ || !if_id_.empty())
+  if (fetch_stalled_ || draining_ || !if_id_.empty())
     return;
 
+  // fetch next instruction through the alignment buffer
+  uint32_t instr_code = 0;
+  uint32_t instr_size = 0;
+  if (!fetch_buf_.fetch(PC_, &instr_code, &instr_size)) {
+    DT(3, "*** IF Stall: instruction straddles fetch blocks");
+    return;
+  }
+
   // allocate a new uuid
   uint32_t uuid = uuid_ctr_++;
 
-  // fetch next instruction from memory at PC address
-  uint32_t instr_code = 0;
-  mmu_.read(&instr_code, PC_, sizeof(uint32_t), 0);
-
   DT(2, "IF: instr=0x" << instr_code << ", PC=0x" << std::hex << PC_ << std::dec << " (#" << uuid << ")");
 
   // move instruction data to next stage
   if_id_.push({instr_code, PC_, uuid});
 
   // advance program counter
-  PC_ += 4;
+  PC_ += instr_size;
 
   // lock this stage until branch resoluion
   fetch_stalled_ = true;
@@ -130,6 +162,12 @@ void Core::ex_stage() {
 
   auto& stage_data = id_ex_.data();
 
+  // multiply/divide operations hold EX until their unit completes
+  if (this->muldiv_stall(*stage_data.instr, stage_data.rs1_data, stage_data.rs2_data, stage_data.uuid)) {
+    DT(3, "*** EX Stall: multiply/divide in progress (#" << stage_data.uuid << ")");
+    return;
+  }
+
   // ALU operations
   auto result = this->alu_unit(*stage_data.instr, stage_data.rs1_data, stage_data.rs2_data, stage_data.PC);
 
@@ -149,7 +187,13 @@ void Core::mem_stage() {
 
   auto& stage_data = ex_mem_.data();
 
-  auto result = this->mem_access(*stage_data.instr, stage_data.result, stage_data.rs2_data);
+  // stall stores while the write buffer is full
+  if (wbuf_ && !this->wbuf_ready(*stage_data.instr, stage_data.result)) {
+    DT(3, "*** MEM Stall: write buffer full (#" << stage_data.uuid << ")");
+    return;
+  }
+
+  auto result = this->mem_access(*stage_data.instr, stage_data.result, stage_data.rs2_data, stage_data.uuid);
 
   DT(3, "MEM: result=0x" << std::hex << result << std::dec << " (#" << stage_data.uuid << ")");
 
@@ -172,14 +216,62 @@ void Core::wb_stage() {
   assert(perf_stats_.instrs <= fetched_instrs_);
   ++perf_stats_.instrs;
 
+  // apply guest control CSR writes
+  if (stage_data.instr->getExeFlags().is_csr) {
+    processor_->commit_sim_csr(stage_data.uuid);
+  }
+
   // handle program termination
   if (stage_data.instr->getExeFlags().is_exit) {
+    if (wbuf_) {
+      wbuf_->flush();
+    }
     exited_ = true;
   }
 
   mem_wb_.pop();
 }
 
+bool Core::wbuf_ready(const Instr &instr, uint32_t mem_addr) {
+  if (!instr.getExeFlags().is_store)
+    return true;
+  if (mem_addr >= uint32_t(IO_COUT_ADDR)
+   && mem_addr < (uint32_t(IO_COUT_ADDR) + IO_COUT_SIZE))
+    return true;
+  uint32_t data_bytes = 1 << (instr.getFunc3() & 0x3);
+  return wbuf_->can_accept(mem_addr, data_bytes);
+}
+
+bool Core::muldiv_stall(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint64_t uuid) {
+  auto alu_op = instr.getAluOp();
+  bool is_mul = is_mul_op(alu_op);
+  if (!is_mul && !is_div_op(alu_op))
+    return false;
+
+  auto cycle = perf_stats_.cycles;
+  if (!muldiv_pending_ || muldiv_uuid_ != uuid) {
+    // start the operation on its unit
+    if (is_mul) {
+      if (!mul_unit_.can_issue(cycle))
+        return true;
+      muldiv_done_ = mul_unit_.issue(cycle);
+    } else {
+      if (!div_unit_.can_issue(cycle))
+        return true;
+      muldiv_done_ = div_unit_.issue(cycle, alu_op, rs1_data, rs2_data);
+    }
+    muldiv_pending_ = true;
+    muldiv_uuid_ = uuid;
+  }
+
+  // hold EX until the last cycle of the operation
+  if (cycle + 1 < muldiv_done_)
+    return true;
+
+  muldiv_pending_ = false;
+  return false;
+}
+
 bool Core::check_data_hazards(const Instr &instr) {
   auto exe_flags = instr.getExeFlags();
 
@@ -289,6 +381,30 @@ bool Core::check_exit(Word* exitcode, bool riscv_test) const {
   return false;
 }
 
+bool Core::drain() {
+  draining_ = true;
+  if (!if_id_.empty() || !id_ex_.empty() || !ex_mem_.empty() || !mem_wb_.empty())
+    return false;
+  if (wbuf_) {
+    wbuf_->flush();
+  }
+  return true;
+}
+
+void Core::warm_branch(Word PC, Word next_PC, bool taken) {
+  // no predictor to train
+  (void) PC;
+  (void) next_PC;
+  (void) taken;
+}
+
+void Core::warm_mem(uint64_t addr, uint32_t size, bool write) {
+  // no cache to fill
+  (void) addr;
+  (void) size;
+  (void) write;
+}
+
 bool Core::running() const {
   return (perf_stats_.instrs != fetched_instrs_) || (fetched_instrs_ == 0);
 }
@@ -299,4 +415,23 @@ void Core::attach_ram(RAM* ram) {
 
 void Core::showStats() {
   std::cout << std::dec << "PERF: instrs=" << perf_stats_.instrs << ", cycles=" << perf_stats_.cycles << std::endl;
+  if (wbuf_) {
+    auto& wbuf_stats = wbuf_->perf_stats();
+    std::cout << std::dec << "WBUF: stores=" << wbuf_stats.stores << ", coalesced=" << wbuf_stats.coalesced
+              << ", forwards=" << wbuf_stats.forwards << ", full_stalls=" << wbuf_stats.full_stalls
+              << ", drains=" << wbuf_stats.drains
+              << ", coalesce_rate=" << (wbuf_stats.stores ? (100 * wbuf_stats.coalesced / wbuf_stats.stores) : 0) << "%" << std::endl;
+  }
+  auto& fetch_stats = fetch_buf_.perf_stats();
+  std::cout << std::dec << "FETCH: instrs=" << fetch_stats.instrs << ", compressed=" << fetch_stats.compressed
+            << " (" << (fetch_stats.instrs ? (100 * fetch_stats.compressed / fetch_stats.instrs) : 0) << "%)"
+            << ", blocks=" << fetch_stats.blocks << ", straddles=" << fetch_stats.straddles
+            << ", block_util=" << (fetch_stats.blocks ? (100 * fetch_stats.used_bytes / (fetch_stats.blocks * FetchBuffer::BLOCK_SIZE)) : 0) << "%" << std::endl;
+  auto& mul_stats = mul_unit_.perf_stats();
+  std::cout << std::dec << "MUL: ops=" << mul_stats.ops << ", busy_cycles=" << mul_stats.busy_cycles
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * mul_stats.stage_cycles / (perf_stats_.cycles * mul_unit_.latency())) : 0) << "%" << std::endl;
+  auto& div_stats = div_unit_.perf_stats();
+  std::cout << std::dec << "DIV: ops=" << div_stats.ops << ", busy_cycles=" << div_stats.busy_cycles
+            << ", early_outs=" << div_stats.early_outs
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * div_stats.busy_cycles / perf_stats_.cycles) : 0) << "%" << std::endl;
 }
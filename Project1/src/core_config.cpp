@@ -0,0 +1,110 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <stdlib.h>
+#include <util.h>
+#include "core_config.h"
+#include "config.h"
+
+using namespace tinyrv;
+
+static const struct {
+  const char* name;
+  uint32_t CoreConfig::*field;
+} core_params[] = {
+  {"mul_latency",  &CoreConfig::mul_latency},
+  {"div_latency",  &CoreConfig::div_latency},
+  {"wbuf_size",    &CoreConfig::wbuf_size},
+  {"wbuf_latency", &CoreConfig::wbuf_latency},
+};
+
+static std::string trim(const std::string& str) {
+  auto first = str.find_first_not_of(" \t\r");
+  if (first == std::string::npos)
+    return "";
+  auto last = str.find_last_not_of(" \t\r");
+  return str.substr(first, last - first + 1);
+}
+
+CoreConfig::CoreConfig()
+  : mul_latency(MUL_LATENCY)
+  , div_latency(DIV_LATENCY)
+  , wbuf_size(WBUF_SIZE)
+  , wbuf_latency(WBUF_LATENCY)
+{}
+
+bool CoreConfig::set(const std::string& name, const std::string& value) {
+  for (auto& param : core_params) {
+    if (name != param.name)
+      continue;
+    char* end;
+    auto number = std::strtoul(value.c_str(), &end, 0);
+    if (value.empty() || *end != '\0' || number > UINT32_MAX) {
+      std::cout << "*** error: invalid value for " << name << ": " << value << std::endl;
+      return false;
+    }
+    this->*param.field = number;
+    return true;
+  }
+  std::cout << "*** error: unknown core parameter: " << name << std::endl;
+  return false;
+}
+
+bool CoreConfig::parse(const std::string& assignment) {
+  auto eq = assignment.find('=');
+  if (eq == std::string::npos) {
+    std::cout << "*** error: expected name=value: " << assignment << std::endl;
+    return false;
+  }
+  return this->set(trim(assignment.substr(0, eq)), trim(assignment.substr(eq + 1)));
+}
+
+bool CoreConfig::load(const char* filename) {
+  std::ifstream ifs(filename);
+  if (!ifs) {
+    std::cout << "*** error: cannot open " << filename << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(ifs, line)) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    if (!this->parse(line))
+      return false;
+  }
+  return true;
+}
+
+bool CoreConfig::validate() const {
+  const char* error = nullptr;
+  if (mul_latency == 0 || div_latency == 0) {
+    error = "mul_latency and div_latency must be nonzero";
+  }
+  if (error) {
+    std::cout << "*** error: invalid core config: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void CoreConfig::dump(std::ostream& os) const {
+  os << std::dec << "CONFIG:";
+  const char* sep = " ";
+  for (auto& param : core_params) {
+    os << sep << param.name << "=" << this->*param.field;
+    sep = ", ";
+  }
+  os << std::endl;
+}
@@ -0,0 +1,639 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <mem.h>
+#include "dbt.h"
+#include "emulator.h"
+#include "core.h"
+#include "debug.h"
+
+using namespace tinyrv;
+
+static_assert(RAM_PAGE_SIZE >= 4096, "the DBT maps guest pages of 4KB onto RAM pages");
+
+namespace {
+
+// x86-64 registers
+enum X86Reg {
+  EAX = 0,
+  ECX = 1,
+  EDX = 2,
+  EBX = 3,
+  ESI = 6,
+  EDI = 7,
+};
+
+// x86-64 condition codes
+enum X86Cond {
+  CC_B  = 0x2,
+  CC_AE = 0x3,
+  CC_E  = 0x4,
+  CC_NE = 0x5,
+  CC_L  = 0xc,
+  CC_GE = 0xd,
+};
+
+// x86-64 ALU opcodes for "op r32, r/m32" (the /digit of 0x81 is opcode >> 3)
+enum X86AluOp {
+  ALU_ADD = 0x03,
+  ALU_OR  = 0x0b,
+  ALU_AND = 0x23,
+  ALU_SUB = 0x2b,
+  ALU_XOR = 0x33,
+  ALU_CMP = 0x3b,
+};
+
+// /digit of the shift opcodes
+enum X86ShiftOp {
+  SHIFT_SHL = 4,
+  SHIFT_SHR = 5,
+  SHIFT_SAR = 7,
+};
+
+// Minimal x86-64 assembler.
+// Memory operands are [rbx + disp32], rbx holding the DBT context.
+class X86Emitter {
+public:
+  X86Emitter(uint8_t* ptr) : ptr_(ptr) {}
+
+  uint8_t* ptr() const { return ptr_; }
+
+  void byte(uint8_t value) { *ptr_++ = value; }
+
+  void dword(uint32_t value) {
+    memcpy(ptr_, &value, 4);
+    ptr_ += 4;
+  }
+
+  void qword(uint64_t value) {
+    memcpy(ptr_, &value, 8);
+    ptr_ += 8;
+  }
+
+  // mod=10 r/m=rbx with a 32-bit displacement
+  void modrm_ctx(uint32_t reg, uint32_t disp) {
+    this->byte(0x80 | (reg << 3) | EBX);
+    this->dword(disp);
+  }
+
+  void mov_r_m(X86Reg dst, uint32_t disp) {
+    this->byte(0x8b);
+    this->modrm_ctx(dst, disp);
+  }
+
+  void mov_m_r(uint32_t disp, X86Reg src) {
+    this->byte(0x89);
+    this->modrm_ctx(src, disp);
+  }
+
+  void mov_m_imm(uint32_t disp, uint32_t imm) {
+    this->byte(0xc7);
+    this->modrm_ctx(0, disp);
+    this->dword(imm);
+  }
+
+  void mov_r_r(X86Reg dst, X86Reg src) {
+    this->byte(0x89);
+    this->byte(0xc0 | (src << 3) | dst);
+  }
+
+  void mov_r_imm(X86Reg dst, uint32_t imm) {
+    this->byte(0xb8 | dst);
+    this->dword(imm);
+  }
+
+  void alu_r_m(X86AluOp op, X86Reg dst, uint32_t disp) {
+    this->byte(op);
+    this->modrm_ctx(dst, disp);
+  }
+
+  void alu_r_imm(X86AluOp op, X86Reg dst, uint32_t imm) {
+    this->byte(0x81);
+    this->byte(0xc0 | (op & 0x38) | dst);
+    this->dword(imm);
+  }
+
+  void shift_r_cl(X86ShiftOp op, X86Reg dst) {
+    this->byte(0xd3);
+    this->byte(0xc0 | (op << 3) | dst);
+  }
+
+  void shift_r_imm(X86ShiftOp op, X86Reg dst, uint8_t imm) {
+    this->byte(0xc1);
+    this->byte(0xc0 | (op << 3) | dst);
+    this->byte(imm);
+  }
+
+  // eax = (cond) ? 1 : 0
+  void setcc_eax(X86Cond cond) {
+    this->byte(0x0f); this->byte(0x90 | cond); this->byte(0xc0);
+    this->byte(0x0f); this->byte(0xb6); this->byte(0xc0);
+  }
+
+  // add/sub qword [rbx + disp], imm32
+  void add64_m_imm(uint32_t disp, int32_t imm) {
+    this->byte(0x48); this->byte(0x81);
+    this->modrm_ctx(imm >= 0 ? 0 : 5, disp);
+    this->dword(imm >= 0 ? imm : -imm);
+  }
+
+  void test_eax_imm(uint32_t imm) {
+    this->byte(0xa9);
+    this->dword(imm);
+  }
+
+  // call an absolute address through rax, rdi = context
+  void call(const void* target) {
+    this->byte(0x48); this->byte(0x89); this->byte(0xdf);  // mov rdi, rbx
+    this->byte(0x48); this->byte(0xb8);                    // mov rax, imm64
+    this->qword(reinterpret_cast<uint64_t>(target));
+    this->byte(0xff); this->byte(0xd0);                    // call rax
+  }
+
+  // jumps with a 32-bit displacement, return the displacement to bind
+  uint8_t* jcc(X86Cond cond) {
+    this->byte(0x0f);
+    this->byte(0x80 | cond);
+    this->dword(0);
+    return ptr_ - 4;
+  }
+
+  uint8_t* jmp() {
+    this->byte(0xe9);
+    this->dword(0);
+    return ptr_ - 4;
+  }
+
+  void jmp(const uint8_t* target) {
+    bind(this->jmp(), target);
+  }
+
+  // point a jump displacement at target
+  static void bind(uint8_t* disp, const uint8_t* target) {
+    int32_t rel = int32_t(target - (disp + 4));
+    memcpy(disp, &rel, 4);
+  }
+
+  void bind(uint8_t* disp) {
+    bind(disp, ptr_);
+  }
+
+private:
+  uint8_t* ptr_;
+};
+
+// context field displacements
+#define CTX_OFF(field) uint32_t(offsetof(ctx_type, field))
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Dbt::Dbt(Emulator* emulator, RAM* ram)
+  : emulator_(emulator)
+  , ram_(ram)
+  , code_(nullptr)
+  , jmp_cache_(JMP_ENTRIES)
+  , hot_counts_(JMP_ENTRIES)
+{
+  memset(&ctx_, 0, sizeof(ctx_));
+  ctx_.dbt = this;
+
+#if EMU_DBT
+  void* code = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    DP(1, "DBT: cannot map an executable code cache, translation disabled");
+    return;
+  }
+  code_ = (uint8_t*)code;
+
+  // enter: push rbx; mov rbx, rdi; jmp rsi
+  X86Emitter e(code_);
+  enter_ = reinterpret_cast<enter_t>(e.ptr());
+  e.byte(0x53);
+  e.byte(0x48); e.byte(0x89); e.byte(0xfb);
+  e.byte(0xff); e.byte(0xe6);
+
+  // exit: pop rbx; ret
+  exit_stub_ = e.ptr();
+  e.byte(0x5b);
+  e.byte(0xc3);
+
+  code_start_ = e.ptr();
+
+  this->reset();
+#endif
+}
+
+Dbt::~Dbt() {
+  if (code_) {
+    munmap(code_, CODE_SIZE);
+  }
+}
+
+void Dbt::reset() {
+  this->flush();
+  code_pages_.clear();
+  for (auto& entry : hot_counts_) {
+    entry = {1, 0};
+  }
+  perf_stats_ = PerfStats();
+}
+
+void Dbt::flush() {
+  code_ptr_ = code_start_;
+  blocks_.clear();
+  block_map_.clear();
+  translated_.clear();
+  for (auto& entry : jmp_cache_) {
+    entry = {1, nullptr};
+  }
+  for (uint32_t i = 0; i < TLB_ENTRIES; ++i) {
+    ctx_.tlb_read[i].tag = ~0u;
+    ctx_.tlb_write[i].tag = ~0u;
+  }
+  ctx_.last_exit = nullptr;
+  ++perf_stats_.flushes;
+}
+
+void Dbt::mark_code(Word PC, uint32_t size) {
+  for (uint32_t page : {PC >> PAGE_BITS, (PC + size - 1) >> PAGE_BITS}) {
+    if (code_pages_.insert(page).second) {
+      // stores to this page now take the helper
+      auto& entry = ctx_.tlb_write[page % TLB_ENTRIES];
+      if (entry.tag == page) {
+        entry.tag = ~0u;
+      }
+    }
+  }
+}
+
+void Dbt::invalidate(uint64_t addr, uint32_t size) {
+  if (translated_.empty())
+    return;
+  for (uint64_t a = addr & ~uint64_t(1); a < addr + size; a += 2) {
+    auto it = translated_.find(uint32_t(a >> PAGE_BITS));
+    if (it != translated_.end() && it->second.test((a >> 1) & ((1 << (PAGE_BITS - 1)) - 1))) {
+      DP(2, "DBT: store to translated code at 0x" << std::hex << a << std::dec << ", flushing");
+      this->flush();
+      return;
+    }
+  }
+}
+
+void Dbt::tlb_fill(tlb_entry_t* tlb, uint32_t addr) {
+  uint32_t page = addr >> PAGE_BITS;
+  // the console is not RAM, neither are pages with code for stores
+  uint32_t io_first = uint32_t(IO_COUT_ADDR) >> PAGE_BITS;
+  uint32_t io_last = uint32_t(IO_COUT_ADDR + IO_COUT_SIZE - 1) >> PAGE_BITS;
+  if (page >= io_first && page <= io_last)
+    return;
+  if (tlb == ctx_.tlb_write && code_pages_.count(page))
+    return;
+  uint32_t base = page << PAGE_BITS;
+  auto& entry = tlb[page % TLB_ENTRIES];
+  entry.tag = page;
+  entry.addend = uint64_t(&(*ram_)[base]) - base;
+}
+
+uint32_t Dbt::load_helper(ctx_t* ctx, uint32_t addr, uint32_t kind) {
+  // kind: access size in bytes, bit 3 set for sign extension
+  auto dbt = ctx->dbt;
+  uint32_t size = kind & 0x7;
+  uint32_t data = 0;
+  dbt->emulator_->dmem_read(&data, addr, size);
+  if ((addr & (size - 1)) == 0) {
+    dbt->tlb_fill(ctx->tlb_read, addr);
+  }
+  if (kind & 0x8) {
+    data = sext(data, 8 * size);
+  }
+  return data;
+}
+
+uint32_t Dbt::store_helper(ctx_t* ctx, uint32_t addr, uint32_t value, uint32_t size) {
+  // returns non-zero if the store flushed the code cache
+  auto dbt = ctx->dbt;
+  auto flushes = dbt->perf_stats_.flushes;
+  dbt->emulator_->dmem_write(&value, addr, size);
+  if ((addr & (size - 1)) == 0) {
+    dbt->tlb_fill(ctx->tlb_write, addr);
+  }
+  return dbt->perf_stats_.flushes != flushes;
+}
+
+const Dbt::block_t* Dbt::lookup(Word PC) {
+  auto& entry = jmp_cache_[(PC >> 1) % JMP_ENTRIES];
+  if (entry.first == PC)
+    return entry.second;
+
+  auto it = block_map_.find(PC);
+  if (it == block_map_.end()) {
+    // translate once the block has been reached often enough
+    auto& count = hot_counts_[(PC >> 1) % JMP_ENTRIES];
+    if (count.first != PC) {
+      count = {PC, 0};
+    }
+    if (++count.second < DBT_HOT_THRESHOLD)
+      return nullptr;
+    auto block = this->translate(PC);
+    it = block_map_.emplace(PC, block).first;
+  }
+
+  entry = {PC, it->second};
+  return it->second;
+}
+
+const Dbt::block_t* Dbt::translate(Word PC) {
+  typedef ctx_t ctx_type;
+  typedef Emulator::EmuOp EmuOp;
+
+  // a block takes at most about 100 bytes per instruction
+  if (code_ptr_ + MAX_BLOCK_SIZE * 128 > code_ + CODE_SIZE) {
+    this->flush();
+  }
+
+  // decode the block up to its first control transfer
+  std::vector<Emulator::emu_instr_t> instrs;
+  Word next_PC = PC;
+  while (instrs.size() < MAX_BLOCK_SIZE) {
+    Emulator::emu_instr_t instr;
+    emulator_->predecode(next_PC, &instr);
+    auto op = instr.op;
+    if (op == EmuOp::ALU || op == EmuOp::CSR || op == EmuOp::EXIT)
+      break;
+    instrs.push_back(instr);
+    next_PC += instr.size;
+    if (op >= EmuOp::BEQ)
+      break;
+  }
+  if (instrs.empty())
+    return nullptr;
+
+  uint32_t n = instrs.size();
+  uint32_t loads = 0, stores = 0, branches = 0;
+  for (auto& instr : instrs) {
+    this->mark_code(instr.PC, instr.size);
+    auto& bits = translated_[instr.PC >> PAGE_BITS];
+    bits.set((instr.PC >> 1) & ((1 << (PAGE_BITS - 1)) - 1));
+    if (instr.size == 4) {
+      // the upper half may sit on the next page
+      Word upper = instr.PC + 2;
+      translated_[upper >> PAGE_BITS].set((upper >> 1) & ((1 << (PAGE_BITS - 1)) - 1));
+    }
+    loads    += (instr.op >= EmuOp::LB && instr.op <= EmuOp::LHU);
+    stores   += (instr.op >= EmuOp::SB && instr.op <= EmuOp::SW);
+    branches += (instr.op >= EmuOp::BEQ);
+  }
+
+  auto reg = [](uint32_t index) { return CTX_OFF(regs) + 4 * index; };
+
+  X86Emitter e(code_ptr_);
+  uint8_t* entry = e.ptr();
+
+  // leave with PC = target through a jump that is patched once target is translated
+  auto chain_exit = [&](Word target) {
+    uint8_t* site = e.ptr();
+    e.jmp();
+    X86Emitter::bind(site + 1, site + 5);
+    e.mov_m_imm(CTX_OFF(PC), target);
+    e.byte(0x48); e.byte(0xb8); e.qword(reinterpret_cast<uint64_t>(site));  // mov rax, site
+    e.byte(0x48); e.byte(0x89); e.modrm_ctx(EAX, CTX_OFF(last_exit));     // mov [last_exit], rax
+    e.jmp(exit_stub_);
+  };
+
+  // budget check, then account the whole block
+  e.add64_m_imm(CTX_OFF(budget), -int32_t(n));
+  auto body = e.jcc(CC_AE);
+  e.add64_m_imm(CTX_OFF(budget), n);
+  e.mov_m_imm(CTX_OFF(PC), PC);
+  e.jmp(exit_stub_);
+  e.bind(body);
+  if (loads)    e.add64_m_imm(CTX_OFF(loads), loads);
+  if (stores)   e.add64_m_imm(CTX_OFF(stores), stores);
+  if (branches) e.add64_m_imm(CTX_OFF(branches), branches);
+
+  uint32_t loads_left = loads, stores_left = stores;
+  for (uint32_t i = 0; i < n; ++i) {
+    auto& instr = instrs[i];
+    Word fallthrough = instr.PC + instr.size;
+    switch (instr.op) {
+    case EmuOp::ADD:  case EmuOp::SUB: case EmuOp::AND: case EmuOp::OR: case EmuOp::XOR:
+    case EmuOp::SLT:  case EmuOp::SLTU: {
+      static const X86AluOp alu_ops[] = {ALU_ADD, ALU_SUB, ALU_AND, ALU_OR, ALU_XOR};
+      e.mov_r_m(EAX, reg(instr.rs1));
+      if (instr.op == EmuOp::SLT || instr.op == EmuOp::SLTU) {
+        e.alu_r_m(ALU_CMP, EAX, reg(instr.rs2));
+        e.setcc_eax(instr.op == EmuOp::SLT ? CC_L : CC_B);
+      } else {
+        e.alu_r_m(alu_ops[int(instr.op) - int(EmuOp::ADD)], EAX, reg(instr.rs2));
+      }
+      e.mov_m_r(reg(instr.rd), EAX);
+    } break;
+    case EmuOp::SLL: case EmuOp::SRL: case EmuOp::SRA: {
+      // x86 masks the shift amount to 5 bits as well
+      static const X86ShiftOp shift_ops[] = {SHIFT_SHL, SHIFT_SHR, SHIFT_SAR};
+      e.mov_r_m(EAX, reg(instr.rs1));
+      e.mov_r_m(ECX, reg(instr.rs2));
+      e.shift_r_cl(shift_ops[int(instr.op) - int(EmuOp::SLL)], EAX);
+      e.mov_m_r(reg(instr.rd), EAX);
+    } break;
+    case EmuOp::ADDI: case EmuOp::ANDI: case EmuOp::ORI: case EmuOp::XORI:
+    case EmuOp::SLTI: case EmuOp::SLTIU: {
+      e.mov_r_m(EAX, reg(instr.rs1));
+      switch (instr.op) {
+      case EmuOp::ADDI: e.alu_r_imm(ALU_ADD, EAX, instr.imm); break;
+      case EmuOp::ANDI: e.alu_r_imm(ALU_AND, EAX, instr.imm); break;
+      case EmuOp::ORI:  e.alu_r_imm(ALU_OR, EAX, instr.imm); break;
+      case EmuOp::XORI: e.alu_r_imm(ALU_XOR, EAX, instr.imm); break;
+      default:
+        e.alu_r_imm(ALU_CMP, EAX, instr.imm);
+        e.setcc_eax(instr.op == EmuOp::SLTI ? CC_L : CC_B);
+        break;
+      }
+      e.mov_m_r(reg(instr.rd), EAX);
+    } break;
+    case EmuOp::SLLI: case EmuOp::SRLI: case EmuOp::SRAI: {
+      static const X86ShiftOp shift_ops[] = {SHIFT_SHL, SHIFT_SHR, SHIFT_SAR};
+      e.mov_r_m(EAX, reg(instr.rs1));
+      e.shift_r_imm(shift_ops[int(instr.op) - int(EmuOp::SLLI)], EAX, instr.imm & 0x1f);
+      e.mov_m_r(reg(instr.rd), EAX);
+    } break;
+    case EmuOp::LI:
+      e.mov_m_imm(reg(instr.rd), instr.imm);
+      break;
+    case EmuOp::LB: case EmuOp::LH: case EmuOp::LW: case EmuOp::LBU: case EmuOp::LHU:
+    case EmuOp::SB: case EmuOp::SH: case EmuOp::SW: {
+      bool is_store = (instr.op >= EmuOp::SB);
+      uint32_t size = 0, kind = 0;
+      switch (instr.op) {
+      case EmuOp::LB:  size = 1; kind = 0x9; break;
+      case EmuOp::LH:  size = 2; kind = 0xa; break;
+      case EmuOp::LW:  size = 4; kind = 0x4; break;
+      case EmuOp::LBU: size = 1; kind = 0x1; break;
+      case EmuOp::LHU: size = 2; kind = 0x2; break;
+      case EmuOp::SB:  size = 1; break;
+      case EmuOp::SH:  size = 2; break;
+      default:         size = 4; break;
+      }
+      uint32_t tlb = is_store ? CTX_OFF(tlb_write) : CTX_OFF(tlb_read);
+
+      // eax = address, misaligned accesses take the helper
+      e.mov_r_m(EAX, reg(instr.rs1));
+      e.alu_r_imm(ALU_ADD, EAX, instr.imm);
+      uint8_t* misaligned = nullptr;
+      if (size > 1) {
+        e.test_eax_imm(size - 1);
+        misaligned = e.jcc(CC_NE);
+      }
+
+      // TLB lookup: ecx = page, edx = entry offset, rdx = addend
+      e.mov_r_r(ECX, EAX);
+      e.shift_r_imm(SHIFT_SHR, ECX, PAGE_BITS);
+      e.mov_r_r(EDX, ECX);
+      e.alu_r_imm(ALU_AND, EDX, TLB_ENTRIES - 1);
+      e.shift_r_imm(SHIFT_SHL, EDX, 4);
+      e.byte(0x3b); e.byte(0x8c); e.byte(0x13); e.dword(tlb);                   // cmp ecx, [rbx+rdx+tlb]
+      auto miss = e.jcc(CC_NE);
+      e.byte(0x48); e.byte(0x8b); e.byte(0x94); e.byte(0x13); e.dword(tlb + 8); // mov rdx, [rbx+rdx+tlb+8]
+
+      if (is_store) {
+        e.mov_r_m(ECX, reg(instr.rs2));
+        switch (size) {
+        case 1: e.byte(0x88); e.byte(0x0c); e.byte(0x02); break;                // mov [rdx+rax], cl
+        case 2: e.byte(0x66); e.byte(0x89); e.byte(0x0c); e.byte(0x02); break;  // mov [rdx+rax], cx
+        default: e.byte(0x89); e.byte(0x0c); e.byte(0x02); break;               // mov [rdx+rax], ecx
+        }
+      } else {
+        switch (instr.op) {
+        case EmuOp::LB:  e.byte(0x0f); e.byte(0xbe); break;  // movsx eax, byte
+        case EmuOp::LH:  e.byte(0x0f); e.byte(0xbf); break;  // movsx eax, word
+        case EmuOp::LBU: e.byte(0x0f); e.byte(0xb6); break;  // movzx eax, byte
+        case EmuOp::LHU: e.byte(0x0f); e.byte(0xb7); break;  // movzx eax, word
+        default:         e.byte(0x8b); break;                // mov eax, dword
+        }
+        e.byte(0x04); e.byte(0x02);                          // [rdx+rax]
+      }
+      auto done = e.jmp();
+
+      // slow path through the emulator's memory access
+      if (misaligned) {
+        e.bind(misaligned);
+      }
+      e.bind(miss);
+      e.mov_r_r(ESI, EAX);
+      if (is_store) {
+        e.mov_r_m(EDX, reg(instr.rs2));
+        e.mov_r_imm(ECX, size);
+        e.call(reinterpret_cast<const void*>(&Dbt::store_helper));
+
+        // the store overwrote translated code: leave after it
+        --stores_left;
+        e.test_eax_imm(~0u);
+        auto keep = e.jcc(CC_E);
+        uint32_t rest = n - i - 1;
+        if (rest)        e.add64_m_imm(CTX_OFF(budget), rest);
+        if (loads_left)  e.add64_m_imm(CTX_OFF(loads), -int32_t(loads_left));
+        if (stores_left) e.add64_m_imm(CTX_OFF(stores), -int32_t(stores_left));
+        if (branches)    e.add64_m_imm(CTX_OFF(branches), -int32_t(branches));
+        e.mov_m_imm(CTX_OFF(PC), fallthrough);
+        e.jmp(exit_stub_);
+        e.bind(keep);
+        e.bind(done);
+      } else {
+        e.mov_r_imm(EDX, kind);
+        e.call(reinterpret_cast<const void*>(&Dbt::load_helper));
+        --loads_left;
+        e.bind(done);
+        e.mov_m_r(reg(instr.rd), EAX);
+      }
+    } break;
+    case EmuOp::BEQ: case EmuOp::BNE: case EmuOp::BLT:
+    case EmuOp::BGE: case EmuOp::BLTU: case EmuOp::BGEU: {
+      static const X86Cond conds[] = {CC_E, CC_NE, CC_L, CC_GE, CC_B, CC_AE};
+      e.mov_r_m(EAX, reg(instr.rs1));
+      e.alu_r_m(ALU_CMP, EAX, reg(instr.rs2));
+      auto taken = e.jcc(conds[int(instr.op) - int(EmuOp::BEQ)]);
+      chain_exit(fallthrough);
+      e.bind(taken);
+      chain_exit(instr.imm);
+    } break;
+    case EmuOp::JAL:
+      e.mov_m_imm(reg(instr.rd), fallthrough);
+      chain_exit(instr.imm);
+      break;
+    case EmuOp::JALR:
+      e.mov_r_m(EAX, reg(instr.rs1));
+      e.alu_r_imm(ALU_ADD, EAX, instr.imm);
+      e.alu_r_imm(ALU_AND, EAX, ~1u);
+      e.mov_m_imm(reg(instr.rd), fallthrough);
+      e.mov_m_r(CTX_OFF(PC), EAX);
+      e.jmp(exit_stub_);
+      break;
+    default:
+      std::abort();
+    }
+  }
+
+  // blocks cut short continue at the next instruction
+  if (instrs.back().op < EmuOp::BEQ) {
+    chain_exit(next_PC);
+  }
+
+  code_ptr_ = e.ptr();
+  blocks_.push_back({PC, n, entry});
+  ++perf_stats_.blocks;
+
+  DP(2, "DBT: block PC=0x" << std::hex << PC << std::dec << ", instrs=" << n << ", bytes=" << (code_ptr_ - entry));
+
+  return &blocks_.back();
+}
+
+uint64_t Dbt::execute(uint64_t max_instrs) {
+  auto emu = emulator_;
+  memcpy(ctx_.regs, emu->reg_file_.data(), sizeof(ctx_.regs));
+  ctx_.PC = emu->PC_;
+  ctx_.budget = max_instrs;
+  ctx_.loads = 0;
+  ctx_.stores = 0;
+  ctx_.branches = 0;
+  ctx_.last_exit = nullptr;
+
+  for (;;) {
+    auto block = this->lookup(ctx_.PC);
+    if (!block || block->n > ctx_.budget)
+      break;
+    // chain the jump we left through to this block
+    if (ctx_.last_exit) {
+      X86Emitter::bind(ctx_.last_exit + 1, block->code);
+    }
+    ctx_.last_exit = nullptr;
+    enter_(&ctx_, block->code);
+  }
+
+  uint64_t executed = max_instrs - ctx_.budget;
+  memcpy(emu->reg_file_.data(), ctx_.regs, sizeof(ctx_.regs));
+  emu->PC_ = ctx_.PC;
+  emu->perf_stats_.instrs   += executed;
+  emu->perf_stats_.loads    += ctx_.loads;
+  emu->perf_stats_.stores   += ctx_.stores;
+  emu->perf_stats_.branches += ctx_.branches;
+  perf_stats_.instrs += executed;
+
+  return executed;
+}
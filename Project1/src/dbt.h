@@ -0,0 +1,147 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+#include "types.h"
+
+namespace tinyrv {
+
+class Emulator;
+class RAM;
+
+// Dynamic binary translator for the functional emulator.
+// Hot RV32I basic blocks are translated into x86-64 code in an executable
+// code cache. Guest registers live in a context struct, loads and stores
+// take an inlined software TLB path straight into RAM pages and fall back
+// to a helper call on a miss, a misaligned access or MMIO. Blocks are
+// chained by patching their exit jumps, and the whole cache is flushed when
+// a store overwrites a translated instruction. CSR, ECALL and every
+// instruction outside RV32I end a block and are left to the interpreter.
+class Dbt {
+public:
+  struct PerfStats {
+    uint64_t instrs;  // instructions executed in translated code
+    uint64_t blocks;  // blocks translated
+    uint64_t flushes;
+
+    PerfStats()
+      : instrs(0)
+      , blocks(0)
+      , flushes(0)
+    {}
+  };
+
+  Dbt(Emulator* emulator, RAM* ram);
+  ~Dbt();
+
+  // false if no executable code cache could be mapped
+  bool enabled() const {
+    return code_ != nullptr;
+  }
+
+  void reset();
+
+  // execute translated blocks from the emulator's PC, up to max_instrs
+  // instructions, returns the number executed (0 if the block is still cold)
+  uint64_t execute(uint64_t max_instrs);
+
+  // note an instruction decoded at PC, stores to its page leave the fast path
+  void mark_code(Word PC, uint32_t size);
+
+  // a store wrote [addr, addr+size), drop translations it overwrote
+  void invalidate(uint64_t addr, uint32_t size);
+
+  // drop every translation
+  void flush();
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  static constexpr uint32_t PAGE_BITS      = 12;
+  static constexpr uint32_t TLB_ENTRIES    = 256;
+  static constexpr uint32_t JMP_ENTRIES    = 4096;
+  static constexpr uint32_t MAX_BLOCK_SIZE = 64;
+  static constexpr uint32_t CODE_SIZE      = 16 << 20;
+
+  // translated block, n instructions starting at PC
+  struct block_t {
+    Word     PC;
+    uint32_t n;
+    uint8_t* code;
+  };
+
+  // software TLB entry: host address = guest address + addend
+  struct tlb_entry_t {
+    uint32_t tag;  // guest page number, ~0 if invalid
+    uint32_t pad;
+    uint64_t addend;
+  };
+
+  // state shared with the generated code, addressed through rbx
+  struct ctx_t {
+    uint32_t regs[NUM_REGS + 1];
+    uint32_t PC;
+    uint64_t budget;
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t branches;
+    uint8_t* last_exit;  // unpatched exit jump taken to leave the code
+    Dbt*     dbt;
+    tlb_entry_t tlb_read[TLB_ENTRIES];
+    tlb_entry_t tlb_write[TLB_ENTRIES];
+  };
+
+  typedef void (*enter_t)(ctx_t* ctx, const uint8_t* code);
+
+  const block_t* lookup(Word PC);
+
+  const block_t* translate(Word PC);
+
+  void tlb_fill(tlb_entry_t* tlb, uint32_t addr);
+
+  static uint32_t load_helper(ctx_t* ctx, uint32_t addr, uint32_t kind);
+
+  static uint32_t store_helper(ctx_t* ctx, uint32_t addr, uint32_t value, uint32_t size);
+
+  Emulator* emulator_;
+  RAM*      ram_;
+  ctx_t     ctx_;
+
+  uint8_t*  code_;
+  uint8_t*  code_ptr_;
+  uint8_t*  code_start_;  // first block, after the enter/exit stubs
+  uint8_t*  exit_stub_;
+  enter_t   enter_;
+
+  std::deque<block_t> blocks_;
+  std::unordered_map<Word, const block_t*> block_map_;  // nullptr if untranslatable
+  std::vector<std::pair<Word, const block_t*>> jmp_cache_;
+  std::vector<std::pair<Word, uint32_t>> hot_counts_;
+
+  // pages holding decoded instructions, and the halfwords translated on them
+  std::unordered_set<uint32_t> code_pages_;
+  std::unordered_map<uint32_t, std::bitset<(1 << PAGE_BITS) / 2>> translated_;
+
+  PerfStats perf_stats_;
+};
+
+}
@@ -23,6 +23,7 @@
 #include "types.h"
 #include "core.h"
 #include "instr.h"
+#include "rvc.h"
 
 using namespace tinyrv;
 
@@ -120,6 +121,52 @@ static const char* op_string(const Instr &instr) {
   case Opcode::LUI:   return "LUI";
   case Opcode::AUIPC: return "AUIPC";
   case Opcode::R:
+    if (func7 == 0x01) {
+      switch (func3) {
+      case 0: return "MUL";
+      case 1: return "MULH";
+      case 2: return "MULHSU";
+      case 3: return "MULHU";
+      case 4: return "DIV";
+      case 5: return "DIVU";
+      case 6: return "REM";
+      case 7: return "REMU";
+      default:
+        std::abort();
+      }
+    }
+    switch (func7) {
+    case 0x10:
+      switch (func3) {
+      case 2: return "SH1ADD";
+      case 4: return "SH2ADD";
+      case 6: return "SH3ADD";
+      default:
+        std::abort();
+      }
+    case 0x05:
+      switch (func3) {
+      case 4: return "MIN";
+      case 5: return "MINU";
+      case 6: return "MAX";
+      case 7: return "MAXU";
+      default:
+        std::abort();
+      }
+    case 0x04: return "ZEXT.H";
+    case 0x30: return (func3 == 1) ? "ROL" : "ROR";
+    default:
+      break;
+    }
+    if (func7 == 0x20) {
+      switch (func3) {
+      case 4: return "XNOR";
+      case 6: return "ORN";
+      case 7: return "ANDN";
+      default:
+        break;
+      }
+    }
     switch (func3) {
     case 0: return func7 ? "SUB" : "ADD";
     case 1: return "SLL";
@@ -135,11 +182,30 @@ static const char* op_string(const Instr &instr) {
   case Opcode::I:
     switch (func3) {
     case 0: return "ADDI";
-    case 1: return "SLLI";
+    case 1:
+      if (func7 == 0x30) {
+        switch (instr.getRs2()) {
+        case 0: return "CLZ";
+        case 1: return "CTZ";
+        case 2: return "CPOP";
+        case 4: return "SEXT.B";
+        case 5: return "SEXT.H";
+        default:
+          std::abort();
+        }
+      }
+      return "SLLI";
     case 2: return "SLTI";
     case 3: return "SLTIU";
     case 4: return "XORI";
-    case 5: return (func7 & 0x20) ? "SRAI" : "SRLI";
+    case 5:
+      switch (func7) {
+      case 0x30: return "RORI";
+      case 0x34: return "REV8";
+      case 0x14: return "ORC.B";
+      default:
+        return (func7 & 0x20) ? "SRAI" : "SRLI";
+      }
     case 6: return "ORI";
     case 7: return "ANDI";
     default:
@@ -211,6 +277,9 @@ static const char* op_string(const Instr &instr) {
  * Output the complete string representation of an instruction
  */
 std::ostream &operator<<(std::ostream &os, const Instr &instr) {
+  if (instr.getSize() == 2) {
+    os << "C.";
+  }
   os << op_string(instr);
   int sep = 0;
 
@@ -255,6 +324,18 @@ std::ostream &operator<<(std::ostream &os, const Instr &instr) {
 }
 
 std::shared_ptr<Instr> Core::decode(uint32_t instr_code) const {
+  // RV32C: 16-bit instructions are expanded to their 32-bit equivalent
+  uint32_t instr_size = 4;
+  if (is_compressed(instr_code)) {
+    auto expanded = rvc_expand(instr_code);
+    if (expanded == 0) {
+      std::cout << std::hex << "Error: invalid compressed instruction: 0x" << (instr_code & 0xffff) << std::endl;
+      return nullptr;
+    }
+    instr_code = expanded;
+    instr_size = 2;
+  }
+
 
   /*
    * STEP 1: Parallel extraction of various instruction fields. 
@@ -487,6 +568,67 @@ std::shared_ptr<Instr> Core::decode(uint32_t instr_code) const {
     break;
   }
   case Opcode::R: {
+    if (func7 == 0x01) {
+      // RV32M: MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU
+      switch (func3) {
+      case 0: alu_op = AluOp::MUL; break;
+      case 1: alu_op = AluOp::MULH; break;
+      case 2: alu_op = AluOp::MULHSU; break;
+      case 3: alu_op = AluOp::MULHU; break;
+      case 4: alu_op = AluOp::DIV; break;
+      case 5: alu_op = AluOp::DIVU; break;
+      case 6: alu_op = AluOp::REM; break;
+      case 7: alu_op = AluOp::REMU; break;
+      default:
+        std::abort();
+      }
+      break;
+    }
+    if (func7 == 0x10) {
+      // Zba: SH1ADD, SH2ADD, SH3ADD
+      switch (func3) {
+      case 2: alu_op = AluOp::SH1ADD; break;
+      case 4: alu_op = AluOp::SH2ADD; break;
+      case 6: alu_op = AluOp::SH3ADD; break;
+      default:
+        std::abort();
+      }
+      break;
+    }
+    if (func7 == 0x05) {
+      // Zbb: MIN, MINU, MAX, MAXU
+      switch (func3) {
+      case 4: alu_op = AluOp::MIN; break;
+      case 5: alu_op = AluOp::MINU; break;
+      case 6: alu_op = AluOp::MAX; break;
+      case 7: alu_op = AluOp::MAXU; break;
+      default:
+        std::abort();
+      }
+      break;
+    }
+    if (func7 == 0x04) {
+      // Zbb: ZEXT.H
+      alu_op = AluOp::ZEXTH;
+      exe_flags.use_rs2 = 0;
+      break;
+    }
+    if (func7 == 0x30) {
+      // Zbb: ROL, ROR
+      alu_op = (func3 == 1) ? AluOp::ROL : AluOp::ROR;
+      break;
+    }
+    if (func7 == 0x20 && func3 != 0 && func3 != 5) {
+      // Zbb: XNOR, ORN, ANDN
+      switch (func3) {
+      case 4: alu_op = AluOp::XNOR; break;
+      case 6: alu_op = AluOp::ORN; break;
+      case 7: alu_op = AluOp::ANDN; break;
+      default:
+        std::abort();
+      }
+      break;
+    }
     // CHECK:
      switch(func3) {               
       case 0x0:
@@ -526,6 +668,32 @@ std::shared_ptr<Instr> Core::decode(uint32_t instr_code) const {
     } break;
   }
   case Opcode::I: {
+    if (func3 == 1 && func7 == 0x30) {
+      // Zbb: CLZ, CTZ, CPOP, SEXT.B, SEXT.H
+      switch (rs2) {
+      case 0: alu_op = AluOp::CLZ; break;
+      case 1: alu_op = AluOp::CTZ; break;
+      case 2: alu_op = AluOp::CPOP; break;
+      case 4: alu_op = AluOp::SEXTB; break;
+      case 5: alu_op = AluOp::SEXTH; break;
+      default:
+        std::abort();
+      }
+      exe_flags.use_imm = 0;
+      break;
+    }
+    if (func3 == 5 && (func7 == 0x30 || func7 == 0x34 || func7 == 0x14)) {
+      // Zbb: RORI, REV8, ORC.B
+      switch (func7) {
+      case 0x30: alu_op = AluOp::ROR; break;
+      case 0x34: alu_op = AluOp::REV8; break;
+      default:   alu_op = AluOp::ORCB; break;
+      }
+      if (func7 != 0x30) {
+        exe_flags.use_imm = 0;
+      }
+      break;
+    }
     // CHECK:
     switch(func3) {
       case 0x0:
@@ -692,9 +860,12 @@ std::shared_ptr<Instr> Core::decode(uint32_t instr_code) const {
   instr->setImm(imm);
   instr->setFunc3(func3);
   instr->setFunc7(func7);
+  instr->setSize(instr_size);
   instr->setAluOp(alu_op);
   instr->setBrOp(br_op);
   instr->setExeFlags(exe_flags);
+  instr->setAluFunc(get_alu_func(alu_op, exe_flags));
+  instr->setBrFunc(get_br_func(br_op));
 
   return instr;
 }
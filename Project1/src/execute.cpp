@@ -22,94 +22,183 @@
 #include <assert.h>
 #include <util.h>
 #include "core.h"
+#include "processor_impl.h"
 
 using namespace tinyrv;
 
-/*
- * Arithmetic Logic Unit
- * ----------------------------------------------------------------------------
- * Takes instruction, register values, and program counter and performs the
- * given operation.
- */
-uint32_t Core::alu_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t PC) {
-  auto exe_flags  = instr.getExeFlags();
-  auto alu_op     = instr.getAluOp();
+namespace {
+
+// ALU source1 selection
+enum AluSrc1 {
+  ALU_S1_RS1,   // rs1 data
+  ALU_S1_IDX,   // rs1 index (CSR immediates)
+  ALU_S1_PC,    // instruction PC
+};
 
-  uint32_t alu_s1 = exe_flags.alu_s1_PC ? PC : (exe_flags.alu_s1_rs1 ? instr.getRs1() :  rs1_data);
-  uint32_t alu_s2 = exe_flags.alu_s2_imm ? instr.getImm() : rs2_data;
+template <AluOp alu_op>
+inline uint32_t alu_compute(uint32_t alu_s1, uint32_t alu_s2) {
+  switch (alu_op) {
+  case AluOp::NONE: return 0;
+  case AluOp::ADD:  return alu_s1 + alu_s2;
+  case AluOp::SUB:  return alu_s1 - alu_s2;
+  case AluOp::AND:  return alu_s1 & alu_s2;
+  case AluOp::OR:   return alu_s1 | alu_s2;
+  case AluOp::XOR:  return alu_s1 ^ alu_s2;
+  case AluOp::SLL:  return alu_s1 << (alu_s2 & 0x1f);
+  case AluOp::SRL:  return alu_s1 >> (alu_s2 & 0x1f);
+  case AluOp::SRA:  return (int32_t)alu_s1 >> (alu_s2 & 0x1f);
+  case AluOp::LTI:  return (int32_t)alu_s1 < (int32_t)alu_s2;
+  case AluOp::LTU:  return alu_s1 < alu_s2;
+  case AluOp::MUL:  return alu_s1 * alu_s2;
+  case AluOp::MULH: return (int64_t)(int32_t)alu_s1 * (int32_t)alu_s2 >> 32;
+  case AluOp::MULHSU: return (int64_t)(int32_t)alu_s1 * (uint64_t)alu_s2 >> 32;
+  case AluOp::MULHU: return (uint64_t)alu_s1 * alu_s2 >> 32;
+  case AluOp::DIV:
+    if (alu_s2 == 0)
+      return 0xffffffff;
+    if (alu_s1 == 0x80000000 && alu_s2 == 0xffffffff)
+      return alu_s1; // overflow
+    return (int32_t)alu_s1 / (int32_t)alu_s2;
+  case AluOp::DIVU: return alu_s2 ? (alu_s1 / alu_s2) : 0xffffffff;
+  case AluOp::REM:
+    if (alu_s2 == 0)
+      return alu_s1;
+    if (alu_s1 == 0x80000000 && alu_s2 == 0xffffffff)
+      return 0; // overflow
+    return (int32_t)alu_s1 % (int32_t)alu_s2;
+  case AluOp::REMU: return alu_s2 ? (alu_s1 % alu_s2) : alu_s1;
+  case AluOp::SH1ADD: return (alu_s1 << 1) + alu_s2;
+  case AluOp::SH2ADD: return (alu_s1 << 2) + alu_s2;
+  case AluOp::SH3ADD: return (alu_s1 << 3) + alu_s2;
+  case AluOp::ANDN: return alu_s1 & ~alu_s2;
+  case AluOp::ORN:  return alu_s1 | ~alu_s2;
+  case AluOp::XNOR: return ~(alu_s1 ^ alu_s2);
+  case AluOp::CLZ:  return count_leading_zeros(alu_s1);
+  case AluOp::CTZ:  return count_trailing_zeros(alu_s1);
+  case AluOp::CPOP: return count_ones(alu_s1);
+  case AluOp::MIN:  return ((int32_t)alu_s1 < (int32_t)alu_s2) ? alu_s1 : alu_s2;
+  case AluOp::MINU: return (alu_s1 < alu_s2) ? alu_s1 : alu_s2;
+  case AluOp::MAX:  return ((int32_t)alu_s1 < (int32_t)alu_s2) ? alu_s2 : alu_s1;
+  case AluOp::MAXU: return (alu_s1 < alu_s2) ? alu_s2 : alu_s1;
+  case AluOp::SEXTB: return (int32_t)(int8_t)alu_s1;
+  case AluOp::SEXTH: return (int32_t)(int16_t)alu_s1;
+  case AluOp::ZEXTH: return alu_s1 & 0xffff;
+  case AluOp::ROL:  return rotate_left(alu_s1, alu_s2);
+  case AluOp::ROR:  return rotate_right(alu_s1, alu_s2);
+  case AluOp::REV8: return byte_swap(alu_s1);
+  case AluOp::ORCB: return or_combine_bytes(alu_s1);
+  }
+  return 0;
+}
 
-  if (exe_flags.alu_s1_inv) {
+// one kernel per ALU operation and operand sources
+template <AluOp alu_op, int s1_src, bool s1_inv, bool s2_imm>
+uint32_t alu_kernel(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t PC) {
+  uint32_t alu_s1 = (s1_src == ALU_S1_PC) ? PC : ((s1_src == ALU_S1_IDX) ? instr.getRs1() : rs1_data);
+  uint32_t alu_s2 = s2_imm ? instr.getImm() : rs2_data;
+  if (s1_inv) {
     alu_s1 = ~alu_s1;
   }
+  return alu_compute<alu_op>(alu_s1, alu_s2);
+}
+
+template <AluOp alu_op>
+AluFunc alu_func(int s1_src, bool s1_inv, bool s2_imm) {
+  static const AluFunc kernels[3][2][2] = {
+    {{alu_kernel<alu_op, ALU_S1_RS1, false, false>, alu_kernel<alu_op, ALU_S1_RS1, false, true>},
+     {alu_kernel<alu_op, ALU_S1_RS1, true,  false>, alu_kernel<alu_op, ALU_S1_RS1, true,  true>}},
+    {{alu_kernel<alu_op, ALU_S1_IDX, false, false>, alu_kernel<alu_op, ALU_S1_IDX, false, true>},
+     {alu_kernel<alu_op, ALU_S1_IDX, true,  false>, alu_kernel<alu_op, ALU_S1_IDX, true,  true>}},
+    {{alu_kernel<alu_op, ALU_S1_PC,  false, false>, alu_kernel<alu_op, ALU_S1_PC,  false, true>},
+     {alu_kernel<alu_op, ALU_S1_PC,  true,  false>, alu_kernel<alu_op, ALU_S1_PC,  true,  true>}},
+  };
+  return kernels[s1_src][s1_inv][s2_imm];
+}
 
-  uint32_t rd_data = 0;
+bool br_none(uint32_t, uint32_t) { return false; }
+bool br_jump(uint32_t, uint32_t) { return true; }
+bool br_beq(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data == rs2_data; }
+bool br_bne(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data != rs2_data; }
+bool br_blt(uint32_t rs1_data, uint32_t rs2_data) { return (int32_t)rs1_data < (int32_t)rs2_data; }
+bool br_bge(uint32_t rs1_data, uint32_t rs2_data) { return (int32_t)rs1_data >= (int32_t)rs2_data; }
+bool br_bltu(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data < rs2_data; }
+bool br_bgeu(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data >= rs2_data; }
 
+}
+
+AluFunc tinyrv::get_alu_func(AluOp alu_op, ExeFlags exe_flags) {
+  int  s1_src = exe_flags.alu_s1_PC ? ALU_S1_PC : (exe_flags.alu_s1_rs1 ? ALU_S1_IDX : ALU_S1_RS1);
+  bool s1_inv = exe_flags.alu_s1_inv;
+  bool s2_imm = exe_flags.alu_s2_imm;
   switch (alu_op) {
-  case AluOp::NONE:
-    break;
-  case AluOp::ADD: {
-    // CHECK:
-    rd_data = alu_s1 + alu_s2;
-    break;
-  }
-  case AluOp::SUB: {
-    // CHECK:
-    rd_data = alu_s1 - alu_s2;
-    break;
-  }
-  case AluOp::AND: {
-    // CHECK:
-    rd_data = alu_s1 & alu_s2;
-    break;
-  }
-  case AluOp::OR: {
-    // CHECK:
-    rd_data = alu_s1 | alu_s2;
-    break;
-  }
-  case AluOp::XOR: {
-    // CHECK:
-    rd_data = alu_s1 ^ alu_s2;
-    break;
-  }
-  case AluOp::SLL: {
-    // CHECK:
-    rd_data = alu_s1 << alu_s2;
-    break;
-  }
-  case AluOp::SRL: {
-    // CHECK:
-    rd_data = alu_s1 >> alu_s2;
-    break;
-  }
-  case AluOp::SRA: {
-    // CHECK:
-    rd_data = static_cast<int32_t>(alu_s1) >> alu_s2;
-    break;
-  }
-  case AluOp::LTI: {
-    // CHECK:
-    if (static_cast<int32_t>(alu_s1) < static_cast<int32_t>(alu_s2)) {
-      rd_data = 1;
-    } else {
-      rd_data = 0;
-    }
-    break;
-  }
-  case AluOp::LTU: {
-    // CHECK:
-    if (alu_s1 < alu_s2) {
-      rd_data = 1;
-    } else {
-      rd_data = 0;
-    }
-    break;
+  case AluOp::NONE: return alu_func<AluOp::NONE>(s1_src, s1_inv, s2_imm);
+  case AluOp::ADD:  return alu_func<AluOp::ADD>(s1_src, s1_inv, s2_imm);
+  case AluOp::SUB:  return alu_func<AluOp::SUB>(s1_src, s1_inv, s2_imm);
+  case AluOp::AND:  return alu_func<AluOp::AND>(s1_src, s1_inv, s2_imm);
+  case AluOp::OR:   return alu_func<AluOp::OR>(s1_src, s1_inv, s2_imm);
+  case AluOp::XOR:  return alu_func<AluOp::XOR>(s1_src, s1_inv, s2_imm);
+  case AluOp::SLL:  return alu_func<AluOp::SLL>(s1_src, s1_inv, s2_imm);
+  case AluOp::SRL:  return alu_func<AluOp::SRL>(s1_src, s1_inv, s2_imm);
+  case AluOp::SRA:  return alu_func<AluOp::SRA>(s1_src, s1_inv, s2_imm);
+  case AluOp::LTI:  return alu_func<AluOp::LTI>(s1_src, s1_inv, s2_imm);
+  case AluOp::LTU:  return alu_func<AluOp::LTU>(s1_src, s1_inv, s2_imm);
+  case AluOp::MUL:  return alu_func<AluOp::MUL>(s1_src, s1_inv, s2_imm);
+  case AluOp::MULH: return alu_func<AluOp::MULH>(s1_src, s1_inv, s2_imm);
+  case AluOp::MULHSU: return alu_func<AluOp::MULHSU>(s1_src, s1_inv, s2_imm);
+  case AluOp::MULHU: return alu_func<AluOp::MULHU>(s1_src, s1_inv, s2_imm);
+  case AluOp::DIV:  return alu_func<AluOp::DIV>(s1_src, s1_inv, s2_imm);
+  case AluOp::DIVU: return alu_func<AluOp::DIVU>(s1_src, s1_inv, s2_imm);
+  case AluOp::REM:  return alu_func<AluOp::REM>(s1_src, s1_inv, s2_imm);
+  case AluOp::REMU: return alu_func<AluOp::REMU>(s1_src, s1_inv, s2_imm);
+  case AluOp::SH1ADD: return alu_func<AluOp::SH1ADD>(s1_src, s1_inv, s2_imm);
+  case AluOp::SH2ADD: return alu_func<AluOp::SH2ADD>(s1_src, s1_inv, s2_imm);
+  case AluOp::SH3ADD: return alu_func<AluOp::SH3ADD>(s1_src, s1_inv, s2_imm);
+  case AluOp::ANDN: return alu_func<AluOp::ANDN>(s1_src, s1_inv, s2_imm);
+  case AluOp::ORN: return alu_func<AluOp::ORN>(s1_src, s1_inv, s2_imm);
+  case AluOp::XNOR: return alu_func<AluOp::XNOR>(s1_src, s1_inv, s2_imm);
+  case AluOp::CLZ: return alu_func<AluOp::CLZ>(s1_src, s1_inv, s2_imm);
+  case AluOp::CTZ: return alu_func<AluOp::CTZ>(s1_src, s1_inv, s2_imm);
+  case AluOp::CPOP: return alu_func<AluOp::CPOP>(s1_src, s1_inv, s2_imm);
+  case AluOp::MIN: return alu_func<AluOp::MIN>(s1_src, s1_inv, s2_imm);
+  case AluOp::MINU: return alu_func<AluOp::MINU>(s1_src, s1_inv, s2_imm);
+  case AluOp::MAX: return alu_func<AluOp::MAX>(s1_src, s1_inv, s2_imm);
+  case AluOp::MAXU: return alu_func<AluOp::MAXU>(s1_src, s1_inv, s2_imm);
+  case AluOp::SEXTB: return alu_func<AluOp::SEXTB>(s1_src, s1_inv, s2_imm);
+  case AluOp::SEXTH: return alu_func<AluOp::SEXTH>(s1_src, s1_inv, s2_imm);
+  case AluOp::ZEXTH: return alu_func<AluOp::ZEXTH>(s1_src, s1_inv, s2_imm);
+  case AluOp::ROL: return alu_func<AluOp::ROL>(s1_src, s1_inv, s2_imm);
+  case AluOp::ROR: return alu_func<AluOp::ROR>(s1_src, s1_inv, s2_imm);
+  case AluOp::REV8: return alu_func<AluOp::REV8>(s1_src, s1_inv, s2_imm);
+  case AluOp::ORCB: return alu_func<AluOp::ORCB>(s1_src, s1_inv, s2_imm);
+  default:
+    std::abort();
   }
+}
+
+BrFunc tinyrv::get_br_func(BrOp br_op) {
+  switch (br_op) {
+  case BrOp::NONE: return br_none;
+  case BrOp::JAL:
+  case BrOp::JALR: return br_jump;
+  case BrOp::BEQ:  return br_beq;
+  case BrOp::BNE:  return br_bne;
+  case BrOp::BLT:  return br_blt;
+  case BrOp::BGE:  return br_bge;
+  case BrOp::BLTU: return br_bltu;
+  case BrOp::BGEU: return br_bgeu;
   default:
     std::abort();
   }
+}
 
-  return rd_data;
+/*
+ * Arithmetic Logic Unit
+ * ----------------------------------------------------------------------------
+ * Takes instruction, register values, and program counter and performs the
+ * given operation.
+ */
+uint32_t Core::alu_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t PC) {
+  return instr.getAluFunc()(instr, rs1_data, rs2_data, PC);
 }
 
 /*
@@ -121,68 +210,13 @@ uint32_t Core::alu_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data
 uint32_t Core::branch_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t rd_data, uint32_t PC) {
   auto br_op = instr.getBrOp();
 
-  bool br_taken = false;
-
-  switch (br_op) {
-  case BrOp::NONE:
-    break;
-  case BrOp::JAL:
-  case BrOp::JALR: {
-    // CHECK:                 
-    br_taken = true;
-    break;
-  }
-  case BrOp::BEQ: {
-    // CHECK:
-    if (rs1_data == rs2_data) {
-      br_taken = true;
-    }
-    break;
-  }
-  case BrOp::BNE: {
-    // CHECK:
-    if (rs1_data != rs2_data) {
-      br_taken = true;
-    }
-    break;
-  }
-  case BrOp::BLT: {
-    // CHECK:
-    if (static_cast<int32_t>(rs1_data) < static_cast<int32_t>(rs2_data)) {
-      br_taken = true;
-    }
-    break;
-  }
-  case BrOp::BGE: {
-    // CHECK:
-    if (static_cast<int32_t>(rs1_data) >= static_cast<int32_t>(rs2_data)) {
-      br_taken = true;
-    }
-    break;
-  }
-  case BrOp::BLTU: {
-    // CHECK:
-    if (rs1_data < rs2_data) {
-      br_taken = true;
-    }
-    break;
-  }
-  case BrOp::BGEU: {
-    // CHECK:
-    if (rs1_data >= rs2_data) {
-      br_taken = true;
-    }
-    break;
-  }
-  default:
-    std::abort();
-  }
+  bool br_taken = instr.getBrFunc()(rs1_data, rs2_data);
 
   // resolve branches
   if (br_op != BrOp::NONE) {
     auto br_target = rd_data;
     if (br_taken) {
-      uint32_t next_PC = PC + 4;
+      uint32_t next_PC = PC + instr.getSize();
       if (br_op == BrOp::JAL || br_op == BrOp::JALR) {
         // CHECK:
         rd_data = next_PC;  
@@ -203,7 +237,7 @@ uint32_t Core::branch_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_d
   return rd_data;
 }
 
-uint32_t Core::mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_data) {
+uint32_t Core::mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_data, uint64_t uuid) {
   auto exe_flags = instr.getExeFlags();
   auto func3     = instr.getFunc3();
 
@@ -251,7 +285,7 @@ uint32_t Core::mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_dat
   // handle CSR write
   if (exe_flags.is_csr) {
     if (rs2_data != rd_data) {
-      this->set_csr(instr.getImm(), rd_data);
+      this->set_csr(instr.getImm(), rd_data, uuid);
     }
     rd_data = rs2_data;
   }
@@ -262,7 +296,11 @@ uint32_t Core::mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_dat
 void Core::dmem_read(void *data, uint64_t addr, uint32_t size) {
   auto type = get_addr_type(addr);
   __unused (type);
-  mmu_.read(data, addr, size, 0);
+  if (wbuf_) {
+    wbuf_->read(data, addr, size);
+  } else {
+    mmu_.read(data, addr, size, 0);
+  }
   DTH(2, "Mem Read: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
 
@@ -273,7 +311,12 @@ void Core::dmem_write(const void* data, uint64_t addr, uint32_t size) {
    && addr < (uint64_t(IO_COUT_ADDR) + IO_COUT_SIZE)) {
      this->writeToStdOut(data);
   } else {
-    mmu_.write(data, addr, size, 0);
+    fetch_buf_.invalidate(addr, size);
+    if (wbuf_) {
+      wbuf_->write(data, addr, size);
+    } else {
+      mmu_.write(data, addr, size, 0);
+    }
   }
   DTH(2, "Mem Write: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
@@ -301,6 +344,10 @@ uint32_t Core::get_csr(uint32_t addr) {
     return perf_stats_.instrs & 0xffffffff;
   case VX_CSR_MINSTRET_H: // NumInsts
     return (uint32_t)(perf_stats_.instrs >> 32);
+  case VX_CSR_SIM_ROI_BEGIN:
+  case VX_CSR_SIM_ROI_END:
+  case VX_CSR_SIM_MODE:
+    return processor_->get_sim_csr(addr);
   default:
     std::cout << std::hex << "Error: invalid CSR read addr=0x" << addr << std::endl;
     std::abort();
@@ -308,7 +355,7 @@ uint32_t Core::get_csr(uint32_t addr) {
   }
 }
 
-void Core::set_csr(uint32_t addr, uint32_t value) {
+void Core::set_csr(uint32_t addr, uint32_t value, uint64_t uuid) {
   switch (addr) {
   case VX_CSR_SATP:
   case VX_CSR_MSTATUS:
@@ -321,6 +368,11 @@ void Core::set_csr(uint32_t addr, uint32_t value) {
   case VX_CSR_PMPADDR0:
   case VX_CSR_MNSTATUS:
     break;
+  case VX_CSR_SIM_ROI_BEGIN:
+  case VX_CSR_SIM_ROI_END:
+  case VX_CSR_SIM_MODE:
+    processor_->set_sim_csr(uuid, addr, value);
+    break;
   default: {
       std::cout << std::hex << "Error: invalid CSR write addr=0x" << addr << ", value=0x" << value << std::endl;
       std::abort();
@@ -41,6 +41,18 @@ enum class Opcode {
   FENCE = 0x0f,
 };
 
+class Instr;
+
+// execute handlers, bound to each instruction at decode time
+typedef uint32_t (*AluFunc)(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t PC);
+typedef bool (*BrFunc)(uint32_t rs1_data, uint32_t rs2_data);
+
+// select the ALU kernel for the given operation and operand sources
+AluFunc get_alu_func(AluOp alu_op, ExeFlags exe_flags);
+
+// select the branch condition for the given operation
+BrFunc get_br_func(BrOp br_op);
+
 class Instr {
 public:
   Instr()
@@ -51,8 +63,11 @@ public:
     , imm_(0)
     , func3_(0)
     , func7_(0)
+    , size_(4)
     , alu_op_(AluOp::ADD)
     , exe_flags_(ExeFlags{})
+    , alu_func_(get_alu_func(AluOp::ADD, ExeFlags{}))
+    , br_func_(get_br_func(BrOp::NONE))
   {}
 
   void setOpcode(Opcode opcode)  {
@@ -83,6 +98,10 @@ public:
     func7_ = value;
   }
 
+  void setSize(uint32_t value) {
+    size_ = value;
+  }
+
   void setAluOp(AluOp value) {
     alu_op_ = value;
   }
@@ -95,6 +114,14 @@ public:
     exe_flags_ = value;
   }
 
+  void setAluFunc(AluFunc value) {
+    alu_func_ = value;
+  }
+
+  void setBrFunc(BrFunc value) {
+    br_func_ = value;
+  }
+
   Opcode   getOpcode() const { return opcode_; }
   uint32_t getRd() const { return rd_; }
   uint32_t getRs1() const { return rs1_; }
@@ -102,9 +129,12 @@ public:
   uint32_t getImm() const { return imm_; }
   uint32_t getFunc3() const { return func3_; }
   uint32_t getFunc7() const { return func7_; }
+  uint32_t getSize() const { return size_; }
   AluOp    getAluOp() const { return alu_op_; };
   BrOp     getBrOp() const { return br_op_; };
   ExeFlags getExeFlags() const { return exe_flags_; }
+  AluFunc  getAluFunc() const { return alu_func_; }
+  BrFunc   getBrFunc() const { return br_func_; }
 
 private:
 
@@ -115,10 +145,13 @@ private:
   uint32_t  imm_;
   uint32_t  func3_;
   uint32_t  func7_;
+  uint32_t  size_;  // encoding size in bytes, 2 for RV32C
 
   AluOp     alu_op_;
   BrOp      br_op_;
   ExeFlags  exe_flags_;
+  AluFunc   alu_func_;
+  BrFunc    br_func_;
 
   friend std::ostream &operator<<(std::ostream &, const Instr&);
 };
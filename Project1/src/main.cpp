@@ -21,25 +21,104 @@
 #include <sys/stat.h>
 #include <util.h>
 #include "processor.h"
+#include "simpoint.h"
 #include "mem.h"
 #include "core.h"
+#include "core_config.h"
 
 using namespace tinyrv;
 
+// simulation point files are named after the program, in the working directory
+static std::string simpoint_prefix(const char* program) {
+  std::string name(program);
+  auto slash = name.find_last_of('/');
+  if (slash != std::string::npos) {
+    name = name.substr(slash + 1);
+  }
+  auto dot = name.find_last_of('.');
+  if (dot != std::string::npos) {
+    name = name.substr(0, dot);
+  }
+  return name;
+}
+
 static void show_usage() {
-   std::cout << "Usage: [-s: stats] [-h: help] <program>" << std::endl;
+   std::cout << "Usage: [-s: stats] [-f: functional only] [-F <n>: fast-forward n instructions] [-R: functional outside regions of interest] [-S <period>[:<warmup>[:<window>]]: sampled simulation] [-B <interval>[:<max_k>]: pick simulation points] [-P <interval>: run them] [-C <file>: core parameters] [-D <name>=<value>: set one] [-h: help] <program>" << std::endl;
 }
 
 bool showStats = false;
 const char* program = nullptr;
+bool functional = false;
+uint64_t ffwd_instrs = 0;
+uint64_t sample_period = 0;
+uint64_t sample_warmup = SAMPLE_WARMUP;
+uint64_t sample_window = SAMPLE_WINDOW;
+uint64_t bbv_interval = 0;
+uint32_t simpoint_max_k = SIMPOINT_MAX_K;
+uint64_t simpoint_interval = 0;
+CoreConfig core_config;
 
 static void parse_args(int argc, char **argv) {
   	int c;
-  	while ((c = getopt(argc, argv, "sh?")) != -1) {
+  	while ((c = getopt(argc, argv, "sC:D:fF:RS:B:P:h?")) != -1) {
     	switch (c) {
       case 's':
         showStats = true;
         break;
+      case 'C':
+        if (!core_config.load(optarg))
+          exit(-1);
+        break;
+      case 'D':
+        if (!core_config.parse(optarg))
+          exit(-1);
+        break;
+      case 'f':
+        functional = true;
+        break;
+      case 'F':
+        ffwd_instrs = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'R':
+        // until the program switches to detailed mode
+        ffwd_instrs = UINT64_MAX;
+        break;
+      case 'S': {
+        char* end;
+        sample_period = std::strtoull(optarg, &end, 0);
+        if (*end == ':') {
+          sample_warmup = std::strtoull(end + 1, &end, 0);
+          if (*end == ':') {
+            sample_window = std::strtoull(end + 1, &end, 0);
+          }
+        }
+        if (*end != '\0' || sample_period == 0 || sample_window == 0) {
+          show_usage();
+          exit(-1);
+        }
+        // the sampling report is part of the stats
+        showStats = true;
+      } break;
+      case 'B': {
+        char* end;
+        bbv_interval = std::strtoull(optarg, &end, 0);
+        if (*end == ':') {
+          simpoint_max_k = std::strtoul(end + 1, &end, 0);
+        }
+        if (*end != '\0' || bbv_interval == 0 || simpoint_max_k == 0) {
+          show_usage();
+          exit(-1);
+        }
+      } break;
+      case 'P': {
+        char* end;
+        simpoint_interval = std::strtoull(optarg, &end, 0);
+        if (*end != '\0' || simpoint_interval == 0) {
+          show_usage();
+          exit(-1);
+        }
+        showStats = true;
+      } break;
     	case 'h':
     	case '?':
       		show_usage();
@@ -51,6 +130,9 @@ static void parse_args(int argc, char **argv) {
     	}
 	}
 
+  if (!core_config.validate())
+    exit(-1);
+
 	if (optind < argc) {
 		program = argv[optind];
     std::cout << "Running " << program << ".." << std::endl;
@@ -83,13 +165,44 @@ int main(int argc, char **argv) {
     }
 
     // create processor
-    Processor processor;
+    Processor processor(core_config);
 
     // attach memory module
     processor.attach_ram(&ram);
 
     // run simulation
-    exitcode = processor.run(true);
+    if (functional) {
+      exitcode = processor.emulate(true);
+    } else if (sample_period != 0) {
+      exitcode = processor.sample(true, sample_period, sample_warmup, sample_window);
+    } else if (bbv_interval != 0) {
+      SimPoint simpoint(bbv_interval, simpoint_max_k);
+      exitcode = processor.profile(true, &simpoint);
+      auto prefix = simpoint_prefix(program);
+      std::ofstream bb(prefix + ".bb");
+      simpoint.write_bb(bb);
+      std::ofstream simpoints(prefix + ".simpoints");
+      std::ofstream weights(prefix + ".weights");
+      simpoint.write_points(simpoints, weights);
+      std::cout << "SimPoint: intervals=" << simpoint.num_intervals()
+                << ", points=" << simpoint.points().size() << ", written to " << prefix << ".{bb,simpoints,weights}" << std::endl;
+      for (auto& point : simpoint.points()) {
+        std::cout << "SimPoint: interval=" << point.interval << ", cluster=" << point.cluster
+                  << ", weight=" << point.weight << std::endl;
+      }
+    } else if (simpoint_interval != 0) {
+      SimPoint simpoint(simpoint_interval, SIMPOINT_MAX_K);
+      auto prefix = simpoint_prefix(program);
+      std::ifstream simpoints(prefix + ".simpoints");
+      std::ifstream weights(prefix + ".weights");
+      if (!simpoint.read_points(simpoints, weights)) {
+        std::cout << "*** error: cannot read " << prefix << ".simpoints and " << prefix << ".weights" << std::endl;
+        return -1;
+      }
+      exitcode = processor.run_simpoints(true, simpoint);
+    } else {
+      exitcode = processor.run(true, ffwd_instrs);
+    }
     if (exitcode != 0) {
       std::cout << "*** FAILED: exitcode=" << exitcode << std::endl;
     } else {
@@ -0,0 +1,87 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include "types.h"
+
+namespace tinyrv {
+
+// SimPoint-style phase analysis over basic-block vectors.
+// Each fixed-length interval of the run is summarized by the instructions
+// it retired in every basic block. The vectors are normalized, randomly
+// projected down to a few dimensions and clustered with k-means for every
+// k up to max_k; the smallest k whose BIC score reaches 90% of the range
+// seen is kept. Each cluster is represented by the interval closest to its
+// centroid, weighted by the fraction of intervals in the cluster.
+class SimPoint {
+public:
+  // (block id, instructions retired in the block), ids start at 1
+  typedef std::vector<std::pair<uint32_t, uint64_t>> bbv_t;
+
+  struct point_t {
+    uint32_t interval;
+    uint32_t cluster;
+    double   weight;
+  };
+
+  SimPoint(uint64_t interval, uint32_t max_k);
+
+  uint64_t interval() const {
+    return interval_;
+  }
+
+  void add_interval(const bbv_t& bbv);
+
+  uint32_t num_intervals() const {
+    return bbvs_.size();
+  }
+
+  // pick the representative intervals
+  void cluster();
+
+  // representatives, by interval
+  const std::vector<point_t>& points() const {
+    return points_;
+  }
+
+  // one "T:id:count :id:count ..." line per interval
+  void write_bb(std::ostream& os) const;
+
+  // "<interval> <cluster>" and "<weight> <cluster>" lines
+  void write_points(std::ostream& simpoints, std::ostream& weights) const;
+
+  bool read_points(std::istream& simpoints, std::istream& weights);
+
+private:
+
+  static constexpr uint32_t DIMS  = 15;
+  static constexpr uint32_t SEEDS = 5;
+  static constexpr uint32_t MAX_ITERATIONS = 100;
+
+  typedef std::vector<double> vec_t;
+
+  // k-means from a few seeded k-means++ starts, returns the lowest distortion
+  double kmeans(const std::vector<vec_t>& data, uint32_t k, std::vector<uint32_t>* labels, std::vector<vec_t>* centers) const;
+
+  static double bic(const std::vector<vec_t>& data, uint32_t k, double distortion, const std::vector<uint32_t>& labels);
+
+  uint64_t interval_;
+  uint32_t max_k_;
+  std::vector<bbv_t> bbvs_;
+  std::vector<point_t> points_;
+};
+
+}
@@ -65,7 +65,35 @@ enum class AluOp {
   SRL,
   SRA,
   LTI,
-  LTU
+  LTU,
+  MUL,
+  MULH,
+  MULHSU,
+  MULHU,
+  DIV,
+  DIVU,
+  REM,
+  REMU,
+  SH1ADD,
+  SH2ADD,
+  SH3ADD,
+  ANDN,
+  ORN,
+  XNOR,
+  CLZ,
+  CTZ,
+  CPOP,
+  MIN,
+  MINU,
+  MAX,
+  MAXU,
+  SEXTB,
+  SEXTH,
+  ZEXTH,
+  ROL,
+  ROR,
+  REV8,
+  ORCB
 };
 
 inline std::ostream &operator<<(std::ostream &os, const AluOp& op) {
@@ -81,6 +109,34 @@ inline std::ostream &operator<<(std::ostream &os, const AluOp& op) {
   case AluOp::SRA:  os << "SRA"; break;
   case AluOp::LTI:  os << "LTI"; break;
   case AluOp::LTU:  os << "LTU"; break;
+  case AluOp::MUL:  os << "MUL"; break;
+  case AluOp::MULH: os << "MULH"; break;
+  case AluOp::MULHSU: os << "MULHSU"; break;
+  case AluOp::MULHU: os << "MULHU"; break;
+  case AluOp::DIV:  os << "DIV"; break;
+  case AluOp::DIVU: os << "DIVU"; break;
+  case AluOp::REM:  os << "REM"; break;
+  case AluOp::REMU: os << "REMU"; break;
+  case AluOp::SH1ADD: os << "SH1ADD"; break;
+  case AluOp::SH2ADD: os << "SH2ADD"; break;
+  case AluOp::SH3ADD: os << "SH3ADD"; break;
+  case AluOp::ANDN: os << "ANDN"; break;
+  case AluOp::ORN: os << "ORN"; break;
+  case AluOp::XNOR: os << "XNOR"; break;
+  case AluOp::CLZ: os << "CLZ"; break;
+  case AluOp::CTZ: os << "CTZ"; break;
+  case AluOp::CPOP: os << "CPOP"; break;
+  case AluOp::MIN: os << "MIN"; break;
+  case AluOp::MINU: os << "MINU"; break;
+  case AluOp::MAX: os << "MAX"; break;
+  case AluOp::MAXU: os << "MAXU"; break;
+  case AluOp::SEXTB: os << "SEXTB"; break;
+  case AluOp::SEXTH: os << "SEXTH"; break;
+  case AluOp::ZEXTH: os << "ZEXTH"; break;
+  case AluOp::ROL: os << "ROL"; break;
+  case AluOp::ROR: os << "ROR"; break;
+  case AluOp::REV8: os << "REV8"; break;
+  case AluOp::ORCB: os << "ORCB"; break;
   default: assert(false);
   }
   return os;
@@ -24,6 +24,27 @@ constexpr uint32_t count_trailing_zeros(uint32_t value) {
   return value ? __builtin_ctz(value) : 32;
 }
 
+constexpr uint32_t count_ones(uint32_t value) {
+  return __builtin_popcount(value);
+}
+
+constexpr uint32_t rotate_left(uint32_t value, uint32_t shift) {
+  return (value << (shift & 0x1f)) | (value >> ((32 - shift) & 0x1f));
+}
+
+constexpr uint32_t rotate_right(uint32_t value, uint32_t shift) {
+  return (value >> (shift & 0x1f)) | (value << ((32 - shift) & 0x1f));
+}
+
+constexpr uint32_t byte_swap(uint32_t value) {
+  return __builtin_bswap32(value);
+}
+
+// set every non-zero byte to 0xff
+constexpr uint32_t or_combine_bytes(uint32_t value) {
+  return (((((value & 0x7f7f7f7f) + 0x7f7f7f7f) | value) & 0x80808080) >> 7) * 0xff;
+}
+
 constexpr bool ispow2(uint32_t value) {
   return value && !(value & (value - 1));
 }
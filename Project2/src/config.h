@@ -17,8 +17,17 @@
 
 #define NUM_FUS 3
 
+// The branch predictor sizes, and the write buffer and MUL/DIV settings
+// further down, are the defaults of the runtime core parameters
+// (core_config.h); -C <file> and -D <name>=<value> override them per run.
+
+#ifndef BTB_SIZE
 #define BTB_SIZE  256
+#endif
+
+#ifndef BHR_SIZE
 #define BHR_SIZE  8
+#endif
 
 #define ALU_LATENCY 2
 #define LSU_LATENCY 100
@@ -36,6 +45,57 @@
 #define DEBUG_LEVEL 3
 #endif
 
+// functional emulator dispatch, computed goto when the compiler supports it
+// (0 selects the portable switch loop)
+#ifndef EMU_THREADED
+#if defined(__GNUC__)
+#define EMU_THREADED 1
+#else
+#define EMU_THREADED 0
+#endif
+#endif
+
+// sampled simulation (-S): default functional warming and measured window
+// lengths, and the instructions run in detail before each window to refill
+// the pipeline
+#ifndef SAMPLE_WARMUP
+#define SAMPLE_WARMUP 20000
+#endif
+
+#ifndef SAMPLE_WINDOW
+#define SAMPLE_WINDOW 1000
+#endif
+
+#ifndef SAMPLE_DETAIL_WARMUP
+#define SAMPLE_DETAIL_WARMUP 100
+#endif
+
+// largest number of clusters tried when picking simulation points
+#ifndef SIMPOINT_MAX_K
+#define SIMPOINT_MAX_K 10
+#endif
+
+// executions after which an emulator block is extended along its biased
+// successor into a superblock (0 disables superblocks)
+#ifndef EMU_SUPERBLOCK_THRESHOLD
+#define EMU_SUPERBLOCK_THRESHOLD 64
+#endif
+
+// translate hot blocks of the functional emulator into x86-64 code
+// (0 keeps the interpreter only)
+#ifndef EMU_DBT
+#if defined(__x86_64__) && defined(__linux__)
+#define EMU_DBT 1
+#else
+#define EMU_DBT 0
+#endif
+#endif
+
+// times a block is reached before it is translated
+#ifndef DBT_HOT_THRESHOLD
+#define DBT_HOT_THRESHOLD 16
+#endif
+
 #ifndef RAM_PAGE_SIZE
 #define RAM_PAGE_SIZE 4096
 #endif
@@ -52,6 +112,26 @@
 #define MEM_BLOCK_SIZE 64
 #endif
 
+// write buffer entries (0 disables the write buffer)
+#ifndef WBUF_SIZE
+#define WBUF_SIZE 0
+#endif
+
+// write buffer drain latency in cycles
+#ifndef WBUF_LATENCY
+#define WBUF_LATENCY 10
+#endif
+
+// pipelined multiplier latency in cycles
+#ifndef MUL_LATENCY
+#define MUL_LATENCY 3
+#endif
+
+// iterative divider worst-case latency in cycles
+#ifndef DIV_LATENCY
+#define DIV_LATENCY 32
+#endif
+
 #ifndef MEM_ADDR_WIDTH
 #ifdef XLEN_64
 #define MEM_ADDR_WIDTH 48
@@ -111,3 +191,14 @@
 #define VX_CSR_MARCHID                  0xF12
 #define VX_CSR_MIMPID                   0xF13
 #define VX_CSR_MHARTID                  0xF14
+
+// Simulator control CSRs (custom read/write space) ///////////////////////////
+
+// writing 1 begins a region of interest: its stats start there and the
+// simulation switches to detailed timing
+#define VX_CSR_SIM_ROI_BEGIN            0x8C0
+// writing 1 ends it: its stats are recorded and the simulation switches to
+// functional fast-forward
+#define VX_CSR_SIM_ROI_END              0x8C1
+// 0: functional fast-forward, 1: detailed timing
+#define VX_CSR_SIM_MODE                 0x8C2
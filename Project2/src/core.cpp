@@ -25,21 +25,29 @@ using namespace tinyrv;
 
 extern int gshare_enabled;
 
-Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor)
+Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const CoreConfig& config)
     : SimObject(ctx, "core")
     , core_id_(core_id)
     , processor_(processor)
+    , config_(config)
     , reg_file_(NUM_REGS)
     , if_id_(PipelineReg<if_id_t>::Create("if_id"))
     , id_ex_(PipelineReg<id_ex_t>::Create("id_ex"))
     , ex_mem_(PipelineReg<ex_mem_t>::Create("ex_mem"))
     , mem_wb_(PipelineReg<mem_wb_t>::Create("mem_wb"))
 	, bpred_(NULL)
+    , fetch_buf_(&mmu_)
+    , wbuf_(NULL)
+    , mul_unit_(config.mul_latency)
+    , div_unit_(config.div_latency)
 {
+  if (config.wbuf_size != 0) {
+    wbuf_ = new WriteBuffer(WriteBuffer::Config{config.wbuf_size, MEM_BLOCK_SIZE, config.wbuf_latency}, &mmu_);
+  }
   if (gshare_enabled == 1) {
-    bpred_ = new GShare(BTB_SIZE, BHR_SIZE);
+    bpred_ = new GShare(config.btb_size, config.bhr_size);
   } else if (gshare_enabled == 2) {
-    bpred_ = new GSharePlus(BTB_SIZE, BHR_SIZE);
+    bpred_ = new GSharePlus(config.btb_size, config.bhr_size);
   }
   this->reset();
 }
@@ -48,6 +56,9 @@ Core::~Core() {
   if (bpred_) {
     delete bpred_;
   }
+  if (wbuf_) {
+    delete wbuf_;
+  }
 }
 
 void Core::reset() {
@@ -64,13 +75,30 @@ void Core::reset() {
   fetched_instrs_ = 0;
   perf_stats_ = PerfStats();
 
+  fetch_buf_.reset();
+
+  if (wbuf_) {
+    wbuf_->reset();
+  }
+
+  mul_unit_.reset();
+  div_unit_.reset();
+  muldiv_pending_ = false;
+
   fetch_stalled_ = false;
+  draining_ = false;
+  operands_stale_ = false;
   exited_ = false;
 }
 
 void Core::tick() {
   pipeline_stalled_ = false;
 
+  // drain buffered stores
+  if (wbuf_) {
+    wbuf_->tick(perf_stats_.cycles);
+  }
+
   this->wb_stage();
   this->mem_stage();
   this->ex_stage();
@@ -82,16 +110,20 @@ void Core::tick() {
 }
 
 void Core::if_stage() {
-  if (fetch_stalled_ || pipeline_stalled_)
+  if (fetch_stalled_ || draining_ || pipeline_stalled_)
     return;
 
+  // fetch next instruction through the alignment buffer
+  uint32_t instr_code = 0;
+  uint32_t instr_size = 0;
+  if (!fetch_buf_.fetch(PC_, &instr_code, &instr_size)) {
+    DT(3, "*** IF Stall: instruction straddles fetch blocks");
+    return;
+  }
+
   // allocate a new uuid
   uint32_t uuid = uuid_ctr_++;
 
-  // fetch next instruction from memory at PC address
-  uint32_t instr_code = 0;
-  mmu_.read(&instr_code, PC_, sizeof(uint32_t), 0);
-
   DT(2, "IF: instr=0x" << instr_code << ", PC=0x" << std::hex << PC_ << std::dec << " (#" << uuid << ")");
 
   // move instruction data to next stage
@@ -99,9 +131,9 @@ void Core::if_stage() {
 
   // advance program counter
   if (gshare_enabled) {
-    PC_ = bpred_->predict(PC_);
+    PC_ = bpred_->predict(PC_, instr_size);
   } else {
-    PC_ += 4;
+    PC_ += instr_size;
   }
 
   ++fetched_instrs_;
@@ -148,6 +180,17 @@ void Core::ex_stage() {
   auto rs1_data = stage_data.rs1_data;
   auto rs2_data = stage_data.rs2_data;
 
+  // operands may have been written back while the pipeline was stalled
+  if (operands_stale_) {
+    if (instr->getExeFlags().use_rs1 && instr->getRs1() != 0) {
+      rs1_data = reg_file_.at(instr->getRs1());
+    }
+    if (instr->getExeFlags().use_rs2 && instr->getRs2() != 0) {
+      rs2_data = reg_file_.at(instr->getRs2());
+    }
+    operands_stale_ = false;
+  }
+
   // daa forwarding
   if (instr->getExeFlags().use_rs1) {
     rs1_data = this->data_forwarding(instr->getRs1(), rs1_data);
@@ -156,6 +199,14 @@ void Core::ex_stage() {
     rs2_data = this->data_forwarding(instr->getRs2(), rs2_data);
   }
 
+  // multiply/divide operations hold EX until their unit completes
+  if (this->muldiv_stall(*instr, rs1_data, rs2_data, stage_data.uuid)) {
+    DT(3, "*** EX Stall: multiply/divide in progress (#" << stage_data.uuid << ")");
+    pipeline_stalled_ = true;
+    operands_stale_ = true;
+    return;
+  }
+
   // ALU operations
   auto result = this->alu_unit(*instr, rs1_data, rs2_data, stage_data.PC);
 
@@ -176,7 +227,15 @@ void Core::mem_stage() {
   auto& stage_data = ex_mem_->data();
   auto instr = stage_data.instr;
 
-  auto result = this->mem_access(*instr, stage_data.result, stage_data.rs2_data);
+  // stall stores while the write buffer is full
+  if (wbuf_ && !this->wbuf_ready(*instr, stage_data.result)) {
+    DT(3, "*** MEM Stall: write buffer full (#" << stage_data.uuid << ")");
+    pipeline_stalled_ = true;
+    operands_stale_ = true;
+    return;
+  }
+
+  auto result = this->mem_access(*instr, stage_data.result, stage_data.rs2_data, stage_data.uuid);
 
   DT(3, "MEM: result=0x" << std::hex << result << std::dec << " (#" << stage_data.uuid << ")");
 
@@ -200,14 +259,62 @@ void Core::wb_stage() {
   assert(perf_stats_.instrs <= fetched_instrs_);
   ++perf_stats_.instrs;
 
+  // apply guest control CSR writes
+  if (instr->getExeFlags().is_csr) {
+    processor_->commit_sim_csr(stage_data.uuid);
+  }
+
   // handle program termination
   if (instr->getExeFlags().is_exit) {
+    if (wbuf_) {
+      wbuf_->flush();
+    }
     exited_ = true;
   }
 
   mem_wb_->pop();
 }
 
+bool Core::wbuf_ready(const Instr &instr, uint32_t mem_addr) {
+  if (!instr.getExeFlags().is_store)
+    return true;
+  if (mem_addr >= uint32_t(IO_COUT_ADDR)
+   && mem_addr < (uint32_t(IO_COUT_ADDR) + IO_COUT_SIZE))
+    return true;
+  uint32_t data_bytes = 1 << (instr.getFunc3() & 0x3);
+  return wbuf_->can_accept(mem_addr, data_bytes);
+}
+
+bool Core::muldiv_stall(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint64_t uuid) {
+  auto alu_op = instr.getAluOp();
+  bool is_mul = is_mul_op(alu_op);
+  if (!is_mul && !is_div_op(alu_op))
+    return false;
+
+  auto cycle = perf_stats_.cycles;
+  if (!muldiv_pending_ || muldiv_uuid_ != uuid) {
+    // start the operation on its unit
+    if (is_mul) {
+      if (!mul_unit_.can_issue(cycle))
+        return true;
+      muldiv_done_ = mul_unit_.issue(cycle);
+    } else {
+      if (!div_unit_.can_issue(cycle))
+        return true;
+      muldiv_done_ = div_unit_.issue(cycle, alu_op, rs1_data, rs2_data);
+    }
+    muldiv_pending_ = true;
+    muldiv_uuid_ = uuid;
+  }
+
+  // hold EX until the last cycle of the operation
+  if (cycle + 1 < muldiv_done_)
+    return true;
+
+  muldiv_pending_ = false;
+  return false;
+}
+
 bool Core::check_data_hazards(const Instr &instr) {
   auto exe_flags = instr.getExeFlags();
 
@@ -317,6 +424,42 @@ bool Core::check_exit(Word* exitcode, bool riscv_test) const {
   return false;
 }
 
+bool Core::drain() {
+  draining_ = true;
+  if (if_id_->valid() || id_ex_->valid() || ex_mem_->valid() || mem_wb_->valid())
+    return false;
+  if (wbuf_) {
+    wbuf_->flush();
+  }
+  return true;
+}
+
+void Core::warm_branch(Word PC, Word next_PC, bool taken) {
+  if (gshare_enabled) {
+    bpred_->update(PC, next_PC, taken);
+  }
+}
+
+void Core::warm_mem(uint64_t addr, uint32_t size, bool write) {
+  // no cache to fill
+  (void) addr;
+  (void) size;
+  (void) write;
+}
+
+void Core::save_state(StateWriter& writer) const {
+  if (bpred_) {
+    bpred_->save_state(writer, "bpred");
+  }
+}
+
+bool Core::load_state(const StateReader& reader) {
+  if (bpred_) {
+    return bpred_->load_state(reader, "bpred");
+  }
+  return true;
+}
+
 bool Core::running() const {
   return (perf_stats_.instrs != fetched_instrs_) || (fetched_instrs_ == 0);
 }
@@ -329,4 +472,23 @@ void Core::showStats() {
   std::cout << std::dec << "PERF: instrs=" << perf_stats_.instrs << ", cycles=" << perf_stats_.cycles
             << ", bpred=" << (perf_stats_.branches - perf_stats_.bpred_miss) << "/"
             << perf_stats_.branches << std::endl;
+  if (wbuf_) {
+    auto& wbuf_stats = wbuf_->perf_stats();
+    std::cout << std::dec << "WBUF: stores=" << wbuf_stats.stores << ", coalesced=" << wbuf_stats.coalesced
+              << ", forwards=" << wbuf_stats.forwards << ", full_stalls=" << wbuf_stats.full_stalls
+              << ", drains=" << wbuf_stats.drains
+              << ", coalesce_rate=" << (wbuf_stats.stores ? (100 * wbuf_stats.coalesced / wbuf_stats.stores) : 0) << "%" << std::endl;
+  }
+  auto& fetch_stats = fetch_buf_.perf_stats();
+  std::cout << std::dec << "FETCH: instrs=" << fetch_stats.instrs << ", compressed=" << fetch_stats.compressed
+            << " (" << (fetch_stats.instrs ? (100 * fetch_stats.compressed / fetch_stats.instrs) : 0) << "%)"
+            << ", blocks=" << fetch_stats.blocks << ", straddles=" << fetch_stats.straddles
+            << ", block_util=" << (fetch_stats.blocks ? (100 * fetch_stats.used_bytes / (fetch_stats.blocks * FetchBuffer::BLOCK_SIZE)) : 0) << "%" << std::endl;
+  auto& mul_stats = mul_unit_.perf_stats();
+  std::cout << std::dec << "MUL: ops=" << mul_stats.ops << ", busy_cycles=" << mul_stats.busy_cycles
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * mul_stats.stage_cycles / (perf_stats_.cycles * mul_unit_.latency())) : 0) << "%" << std::endl;
+  auto& div_stats = div_unit_.perf_stats();
+  std::cout << std::dec << "DIV: ops=" << div_stats.ops << ", busy_cycles=" << div_stats.busy_cycles
+            << ", early_outs=" << div_stats.early_outs
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * div_stats.busy_cycles / perf_stats_.cycles) : 0) << "%" << std::endl;
 }
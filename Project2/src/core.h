@@ -27,8 +27,12 @@
 #include "debug.h"
 #include "types.h"
 #include "pipeline_reg.h"
+#include "write_buffer.h"
+#include "muldiv.h"
+#include "fetch_buffer.h"
 #include "instr.h"
 #include "gshare.h"
+#include "core_config.h"
 
 namespace tinyrv {
 
@@ -52,9 +56,13 @@ public:
     {}
   };
 
-  Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor);
+  Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const CoreConfig& config);
   ~Core();
 
+  const CoreConfig& config() const {
+    return config_;
+  }
+
   void reset();
 
   void tick();
@@ -67,10 +75,33 @@ public:
 
   void showStats();
 
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  // stop fetching and let the instructions in flight retire, returns true
+  // once the pipeline is empty and buffered stores have reached memory
+  bool drain();
+
+  // functional warming: update the predictor state for instructions
+  // executed outside the pipeline, without timing them
+  void warm_branch(Word PC, Word next_PC, bool taken);
+
+  void warm_mem(uint64_t addr, uint32_t size, bool write);
+
+  // warm-start: the state carried between runs
+  void save_state(StateWriter& writer) const;
+
+  bool load_state(const StateReader& reader);
+
 private:
 
   std::shared_ptr<Instr> decode(uint32_t instr_code) const;
 
+  bool wbuf_ready(const Instr &instr, uint32_t mem_addr);
+
+  bool muldiv_stall(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint64_t uuid);
+
   bool check_data_hazards(const Instr &instr);
 
   uint32_t data_forwarding(uint32_t reg, uint32_t rs_data);
@@ -83,9 +114,9 @@ private:
 
   uint32_t branch_unit(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data, uint32_t rd_data, uint32_t PC);
 
-  uint32_t mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_data);
+  uint32_t mem_access(const Instr &instr, uint32_t rd_data, uint32_t rs2_data, uint64_t uuid);
 
-  void set_csr(uint32_t addr, uint32_t value);
+  void set_csr(uint32_t addr, uint32_t value, uint64_t uuid);
 
   uint32_t get_csr(uint32_t addr);
 
@@ -135,6 +166,7 @@ private:
 
   uint32_t core_id_;
   ProcessorImpl* processor_;
+  CoreConfig config_;
   MemoryUnit mmu_;
 
   std::vector<Word> reg_file_;
@@ -146,7 +178,18 @@ private:
   PipelineReg<mem_wb_t>::Ptr mem_wb_;
   BranchPredictor* bpred_;
 
+  FetchBuffer fetch_buf_;
+
+  WriteBuffer* wbuf_;
+
+  Multiplier mul_unit_;
+  Divider    div_unit_;
+  bool       muldiv_pending_;
+  uint64_t   muldiv_uuid_;
+  uint64_t   muldiv_done_;
+
   bool fetch_stalled_;
+  bool draining_;
   bool exited_;
 
   std::stringstream cout_buf_;
@@ -157,6 +200,7 @@ private:
   uint64_t fetched_instrs_;
 
   bool pipeline_stalled_;
+  bool operands_stale_;
 
   friend class Emulator;
 };
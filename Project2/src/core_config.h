@@ -0,0 +1,54 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+
+namespace tinyrv {
+
+// Runtime microarchitecture parameters.
+// Every field defaults to its config.h value and can be overridden per run
+// by name (the lower-case macro name), from the command line or from a
+// key=value file, so that a design sweep does not need a rebuild.
+struct CoreConfig {
+  uint32_t btb_size;        // BTB entries
+  uint32_t bhr_size;        // BHR bits, the PHT has 2^bhr_size entries
+
+  uint32_t mul_latency;     // pipeline depth
+  uint32_t div_latency;     // worst case
+
+  uint32_t wbuf_size;       // 0 disables the write buffer
+  uint32_t wbuf_latency;
+
+  CoreConfig();
+
+  // set one parameter, returns false on an unknown name or a bad value
+  bool set(const std::string& name, const std::string& value);
+
+  // set a parameter from a "name=value" assignment
+  bool parse(const std::string& assignment);
+
+  // read a file of assignments, one per line, '#' starts a comment
+  bool load(const char* filename);
+
+  // check that the parameters describe a buildable core
+  bool validate() const;
+
+  // print the effective parameters as a single stats line
+  void dump(std::ostream& os) const;
+};
+
+}
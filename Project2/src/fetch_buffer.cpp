@@ -0,0 +1,99 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <simobject.h>
+#include "debug.h"
+#include "rvc.h"
+#include "fetch_buffer.h"
+
+using namespace tinyrv;
+
+FetchBuffer::FetchBuffer(MemoryUnit* mmu)
+  : mmu_(mmu) {
+  this->reset();
+}
+
+FetchBuffer::~FetchBuffer() {
+  //--
+}
+
+void FetchBuffer::reset() {
+  block_addr_ = 0;
+  block_data_ = 0;
+  used_mask_ = 0;
+  valid_ = false;
+  perf_stats_ = PerfStats();
+}
+
+void FetchBuffer::load(uint32_t block_addr) {
+  mmu_->read(&block_data_, block_addr, BLOCK_SIZE, 0);
+  block_addr_ = block_addr;
+  used_mask_ = 0;
+  valid_ = true;
+  ++perf_stats_.blocks;
+}
+
+void FetchBuffer::consume(uint32_t half) {
+  // only count the first use of each halfword of a block
+  if (used_mask_ & (1 << half))
+    return;
+  used_mask_ |= (1 << half);
+  perf_stats_.used_bytes += 2;
+}
+
+bool FetchBuffer::fetch(uint32_t PC, uint32_t* instr_code, uint32_t* instr_size) {
+  assert((PC & 0x1) == 0);
+  uint32_t block_addr = PC & ~(BLOCK_SIZE - 1);
+  bool loaded = false;
+  if (!valid_ || block_addr_ != block_addr) {
+    this->load(block_addr);
+    loaded = true;
+  }
+
+  uint32_t half = (PC >> 1) & 0x1;
+  uint32_t lo = (block_data_ >> (16 * half)) & 0xffff;
+  if (is_compressed(lo)) {
+    this->consume(half);
+    *instr_code = lo;
+    *instr_size = 2;
+    ++perf_stats_.compressed;
+  } else if (half == 0) {
+    this->consume(0);
+    this->consume(1);
+    *instr_code = block_data_;
+    *instr_size = 4;
+  } else {
+    // the upper half is in the next block, which can only be read next cycle
+    // if this block was read in the current one.
+    if (loaded) {
+      ++perf_stats_.straddles;
+      DT(3, "FetchBuffer: straddling instruction, PC=0x" << std::hex << PC << std::dec);
+      return false;
+    }
+    this->consume(1);
+    this->load(block_addr + BLOCK_SIZE);
+    this->consume(0);
+    *instr_code = lo | (block_data_ << 16);
+    *instr_size = 4;
+  }
+  ++perf_stats_.instrs;
+  return true;
+}
+
+void FetchBuffer::invalidate(uint64_t addr, uint32_t size) {
+  if (valid_ && addr < uint64_t(block_addr_) + BLOCK_SIZE && addr + size > block_addr_) {
+    valid_ = false;
+  }
+}
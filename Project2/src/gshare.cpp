@@ -37,8 +37,8 @@ GShare::~GShare() {
   //--
 }
 
-uint32_t GShare::predict(uint32_t PC) {
-  uint32_t next_PC = PC + 4;
+uint32_t GShare::predict(uint32_t PC, uint32_t size) {
+  uint32_t next_PC = PC + size;
   bool predict_taken = false;
 
   // TODO:
@@ -54,8 +54,9 @@ uint32_t GShare::predict(uint32_t PC) {
 
   // STEP 4: Find new PC value if branch is taken
   if (predict_taken) {
-    uint32_t btb_index = (PC >> 2) & BTB_mask_;
-    if (BTB_[btb_index].valid && (BTB_[btb_index].tag == (PC>>2 >> BTB_shift_))) {
+    // halfword-indexed: two compressed instructions can share a word
+    uint32_t btb_index = (PC >> 1) & BTB_mask_;
+    if (BTB_[btb_index].valid && (BTB_[btb_index].tag == (PC>>1 >> BTB_shift_))) {
       next_PC = BTB_[btb_index].br_target;
     } 
   }
@@ -86,14 +87,28 @@ void GShare::update(uint32_t PC, uint32_t next_PC, bool taken) {
 
   // STEP 3: Update Branch Target Buffer
   if (taken) {
-    uint32_t btb_index = (PC >> 2) & BTB_mask_;
-    BTB_[btb_index] = {true, (PC >> 2 >> BTB_shift_), next_PC};
+    uint32_t btb_index = (PC >> 1) & BTB_mask_;
+    BTB_[btb_index] = {true, (PC >> 1 >> BTB_shift_), next_PC};
   }
 }
 
 void GShare::change_default_prediction(uint8_t val) {
   std::fill(PHT_.begin(), PHT_.end(), val);
 }
+
+void GShare::save_state(StateWriter& writer, const std::string& prefix) const {
+  writer.write(prefix + ".btb", BTB_);
+  writer.write(prefix + ".pht", PHT_);
+  writer.write(prefix + ".bhr", &BHR_, sizeof(BHR_));
+}
+
+bool GShare::load_state(const StateReader& reader, const std::string& prefix) {
+  // the table sizes must match this predictor's
+  return reader.read(prefix + ".btb", &BTB_)
+      && reader.read(prefix + ".pht", &PHT_)
+      && reader.read(prefix + ".bhr", &BHR_, sizeof(BHR_));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 GSharePlus::GSharePlus(uint32_t BTB_size, uint32_t BHR_size)
@@ -111,10 +126,10 @@ GSharePlus::~GSharePlus() {
   //--
 }
 
-uint32_t GSharePlus::predict(uint32_t PC) {
-  uint32_t local_prediction = local_predictor.predict(PC);
+uint32_t GSharePlus::predict(uint32_t PC, uint32_t size) {
+  uint32_t local_prediction = local_predictor.predict(PC, size);
 
-  uint32_t global_prediction = global_predictor.predict(PC);
+  uint32_t global_prediction = global_predictor.predict(PC, size);
 
   uint32_t meta_index = (PC >> 2) & meta_mask;
   uint8_t meta_prediction = meta_predictor[meta_index];
@@ -125,7 +140,7 @@ uint32_t GSharePlus::predict(uint32_t PC) {
 
   DT(3, "*** GShare+: predict PC=0x" << std::hex << PC << std::dec
         << ", next_PC=0x" << std::hex << next_PC << std::dec
-        << ", predict_taken=" << predict_taken);
+        << ", use_gshare=" << use_GShare);
   return next_PC;
 }
 
@@ -134,8 +149,8 @@ void GSharePlus::update(uint32_t PC, uint32_t next_PC, bool taken) {
   (void) next_PC;
   (void) taken;
 
-  bool local_prediction = (local_predictor.predict(PC) != PC + 4) ;
-  bool global_prediction = (global_predictor.predict(PC) != PC + 4);
+  bool local_prediction = (local_predictor.predict(PC, 4) != PC + 4) ;
+  bool global_prediction = (global_predictor.predict(PC, 4) != PC + 4);
 
   bool local_correct = (local_prediction == taken);
   bool global_correct = (global_prediction == taken);
@@ -158,4 +173,14 @@ void GSharePlus::update(uint32_t PC, uint32_t next_PC, bool taken) {
 
 }
 
+void GSharePlus::save_state(StateWriter& writer, const std::string& prefix) const {
+  local_predictor.save_state(writer, prefix + ".local");
+  global_predictor.save_state(writer, prefix + ".global");
+  writer.write(prefix + ".meta", meta_predictor);
+}
 
+bool GSharePlus::load_state(const StateReader& reader, const std::string& prefix) {
+  return local_predictor.load_state(reader, prefix + ".local")
+      && global_predictor.load_state(reader, prefix + ".global")
+      && reader.read(prefix + ".meta", &meta_predictor);
+}
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <vector>
+#include "statefile.h"
 
 namespace tinyrv {
 
@@ -21,8 +22,9 @@ class BranchPredictor {
 public:
   virtual ~BranchPredictor() {}
 
-  virtual uint32_t predict(uint32_t PC) {
-      return PC + 4;
+  // predict the next PC, size is the encoding size of the instruction at PC
+  virtual uint32_t predict(uint32_t PC, uint32_t size) {
+      return PC + size;
   };
 
   virtual void update(uint32_t PC, uint32_t next_PC, bool taken) {
@@ -30,6 +32,18 @@ public:
       (void) next_PC;
       (void) taken;
   };
+
+  // warm-start: the predictor tables under the given section prefix
+  virtual void save_state(StateWriter& writer, const std::string& prefix) const {
+      (void) writer;
+      (void) prefix;
+  };
+
+  virtual bool load_state(const StateReader& reader, const std::string& prefix) {
+      (void) reader;
+      (void) prefix;
+      return true;
+  };
 };
 
 class GShare : public BranchPredictor {
@@ -38,9 +52,12 @@ public:
 
   ~GShare() override;
 
-  uint32_t predict(uint32_t PC) override;
+  uint32_t predict(uint32_t PC, uint32_t size) override;
   void update(uint32_t PC, uint32_t next_PC, bool taken) override;
 
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
   void change_default_prediction(uint8_t val);
 
   // TODO: Add your own methods here
@@ -70,9 +87,12 @@ public:
 
   ~GSharePlus() override;
 
-  uint32_t predict(uint32_t PC) override;
+  uint32_t predict(uint32_t PC, uint32_t size) override;
   void update(uint32_t PC, uint32_t next_PC, bool taken) override;
 
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
 private:
 
   GShare local_predictor;
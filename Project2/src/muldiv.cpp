@@ -0,0 +1,96 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <assert.h>
+#include <util.h>
+#include "muldiv.h"
+
+using namespace tinyrv;
+
+Multiplier::Multiplier(uint32_t latency)
+  : latency_(latency) {
+  assert(latency != 0);
+  this->reset();
+}
+
+void Multiplier::reset() {
+  last_issue_ = 0;
+  busy_until_ = 0;
+  issued_ = false;
+  perf_stats_ = PerfStats();
+}
+
+bool Multiplier::can_issue(uint64_t cycle) const {
+  // one new operation per cycle
+  return !issued_ || cycle != last_issue_;
+}
+
+uint64_t Multiplier::issue(uint64_t cycle) {
+  assert(this->can_issue(cycle));
+  uint64_t done = cycle + latency_;
+  perf_stats_.busy_cycles += done - std::max(cycle, busy_until_);
+  perf_stats_.stage_cycles += latency_;
+  ++perf_stats_.ops;
+  busy_until_ = std::max(busy_until_, done);
+  last_issue_ = cycle;
+  issued_ = true;
+  return done;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Divider::Divider(uint32_t latency)
+  : latency_(latency) {
+  assert(latency != 0);
+  this->reset();
+}
+
+void Divider::reset() {
+  busy_until_ = 0;
+  perf_stats_ = PerfStats();
+}
+
+bool Divider::can_issue(uint64_t cycle) const {
+  return cycle >= busy_until_;
+}
+
+uint32_t Divider::op_latency(AluOp alu_op, uint32_t dividend, uint32_t divisor) const {
+  // division by zero and signed overflow are resolved in a single cycle
+  if (divisor == 0)
+    return 1;
+  bool is_signed = (alu_op == AluOp::DIV || alu_op == AluOp::REM);
+  if (is_signed) {
+    if (dividend == 0x80000000 && divisor == 0xffffffff)
+      return 1;
+    dividend = ((int32_t)dividend < 0) ? -dividend : dividend;
+    divisor = ((int32_t)divisor < 0) ? -divisor : divisor;
+  }
+  if (dividend < divisor)
+    return 1;
+  // one cycle per quotient bit, plus one to normalize the operands
+  uint32_t quotient_bits = log2floor(dividend) - log2floor(divisor) + 1;
+  return std::min(quotient_bits + 1, latency_);
+}
+
+uint64_t Divider::issue(uint64_t cycle, AluOp alu_op, uint32_t dividend, uint32_t divisor) {
+  assert(this->can_issue(cycle));
+  uint32_t latency = this->op_latency(alu_op, dividend, divisor);
+  if (latency < latency_) {
+    ++perf_stats_.early_outs;
+  }
+  ++perf_stats_.ops;
+  perf_stats_.busy_cycles += latency;
+  busy_until_ = cycle + latency;
+  return busy_until_;
+}
@@ -0,0 +1,110 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"
+
+namespace tinyrv {
+
+// RV32M operation classes
+inline bool is_mul_op(AluOp alu_op) {
+  return alu_op >= AluOp::MUL && alu_op <= AluOp::MULHU;
+}
+
+inline bool is_div_op(AluOp alu_op) {
+  return alu_op >= AluOp::DIV && alu_op <= AluOp::REMU;
+}
+
+// Pipelined multiplier.
+// Accepts one operation per cycle, each one completes after a fixed latency.
+class Multiplier {
+public:
+  struct PerfStats {
+    uint64_t ops;
+    uint64_t busy_cycles;   // cycles with at least one operation in flight
+    uint64_t stage_cycles;  // sum over all pipeline stages of occupied cycles
+
+    PerfStats()
+      : ops(0)
+      , busy_cycles(0)
+      , stage_cycles(0)
+    {}
+  };
+
+  Multiplier(uint32_t latency);
+
+  void reset();
+
+  bool can_issue(uint64_t cycle) const;
+
+  // start an operation, returns the cycle its result is available
+  uint64_t issue(uint64_t cycle);
+
+  uint32_t latency() const {
+    return latency_;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+  uint32_t  latency_;
+  uint64_t  last_issue_;
+  uint64_t  busy_until_;
+  bool      issued_;
+  PerfStats perf_stats_;
+};
+
+// Iterative divider.
+// Handles one operation at a time and produces one quotient bit per cycle,
+// operations whose quotient needs fewer bits retire early.
+class Divider {
+public:
+  struct PerfStats {
+    uint64_t ops;
+    uint64_t busy_cycles;
+    uint64_t early_outs;
+
+    PerfStats()
+      : ops(0)
+      , busy_cycles(0)
+      , early_outs(0)
+    {}
+  };
+
+  Divider(uint32_t latency);
+
+  void reset();
+
+  bool can_issue(uint64_t cycle) const;
+
+  // start an operation, returns the cycle its result is available
+  uint64_t issue(uint64_t cycle, AluOp alu_op, uint32_t dividend, uint32_t divisor);
+
+  // cycles taken by an operation on the given operands
+  uint32_t op_latency(AluOp alu_op, uint32_t dividend, uint32_t divisor) const;
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+  uint32_t  latency_;
+  uint64_t  busy_until_;
+  PerfStats perf_stats_;
+};
+
+}
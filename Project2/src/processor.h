@@ -19,15 +19,42 @@ namespace tinyrv {
 
 class RAM;
 class ProcessorImpl;
+class SimPoint;
+struct CoreConfig;
 
 class Processor {
 public:
-  Processor();
+  Processor(const CoreConfig& config);
   ~Processor();
 
   void attach_ram(RAM* mem);
 
-  int run(bool riscv_test);
+  // run on the timing core, the first ffwd_instrs instructions are
+  // executed functionally and their state handed off to the core, the
+  // program switches modes with the simulator control CSRs
+  int run(bool riscv_test, uint64_t ffwd_instrs = 0);
+
+  // run on the functional simulator only, warm also trains the
+  // predictor so that its state can be saved
+  int emulate(bool riscv_test, bool warm = false);
+
+  // sampled simulation: every period instructions, fast-forward
+  // functionally, warm the caches and predictors for warmup instructions,
+  // then time a window of instructions on the timing core
+  int sample(bool riscv_test, uint64_t period, uint64_t warmup, uint64_t window);
+
+  // run on the functional simulator only, recording a basic-block vector
+  // per interval into simpoint and clustering them
+  int profile(bool riscv_test, SimPoint* simpoint);
+
+  // run the simulation points in detail and the rest functionally
+  int run_simpoints(bool riscv_test, const SimPoint& simpoint);
+
+  // write the predictor's state to a state file
+  bool save_state(const char* filename) const;
+
+  // start every run from the state saved in a state file
+  bool load_state(const char* filename);
 
   void showStats();
 
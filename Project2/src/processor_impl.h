@@ -14,25 +14,88 @@
 #pragma once
 
 #include "core.h"
+#include "emulator.h"
+#include "simpoint.h"
 
 namespace tinyrv {
 
 class ProcessorImpl {
 public:
 
-  ProcessorImpl();
+  ProcessorImpl(const CoreConfig& config);
   ~ProcessorImpl();
 
   void attach_ram(RAM* mem);
 
-  int run(bool riscv_test);
+  int run(bool riscv_test, uint64_t ffwd_instrs);
+
+  int emulate(bool riscv_test, bool warm);
+
+  int sample(bool riscv_test, uint64_t period, uint64_t warmup, uint64_t window);
+
+  int profile(bool riscv_test, SimPoint* simpoint);
+
+  int run_simpoints(bool riscv_test, const SimPoint& simpoint);
+
+  bool save_state(const char* filename) const;
+
+  bool load_state(const char* filename);
 
   void showStats();
 
+  // simulator control CSRs written by the guest
+  uint32_t get_sim_csr(uint32_t addr) const;
+
+  void set_sim_csr(uint64_t uuid, uint32_t addr, uint32_t value);
+
+  // apply the writes of a CSR instruction as it commits
+  void commit_sim_csr(uint64_t uuid);
+
 private:
+  // a measured detailed window, simulation points are weighted
+  struct sample_t {
+    Word     PC;
+    uint64_t instrs;
+    uint64_t cycles;
+    uint32_t interval;
+    double   weight;
+  };
+
+  // a region of interest, in detailed core time
+  struct roi_t {
+    uint64_t instrs;
+    uint64_t cycles;
+  };
+
+  // a control CSR write made by an in-flight instruction
+  struct sim_csr_t {
+    uint64_t uuid;
+    uint32_t addr;
+    uint32_t value;
+  };
+
   void reset();
 
+  void apply_sim_csr(uint32_t addr, uint32_t value);
+
+  // hand the emulator's state to the core, run refill instructions then a
+  // measured window of instructions, drain the pipeline and take the state
+  // back, returns true once the program has exited
+  bool run_detailed(uint64_t refill, uint64_t window, sample_t* sample, bool riscv_test, Word* exitcode);
+
   Core::Ptr core_;
+  std::unique_ptr<Emulator> emulator_;
+  std::unique_ptr<StateReader> warm_state_;  // applied on every reset
+  bool timing_;
+  std::vector<sample_t> samples_;
+  bool simpoints_;
+  bool sim_control_;    // guest CSR writes switch modes
+  bool detailed_;       // the timing core holds the state
+  bool want_detailed_;  // mode requested by the guest
+  bool in_roi_;
+  roi_t roi_start_;
+  std::vector<roi_t> rois_;
+  std::vector<sim_csr_t> pending_csrs_;  // detailed writes awaiting commit
 };
 
 }
@@ -0,0 +1,29 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+namespace tinyrv {
+
+// 16-bit instructions have their two low bits different from 0b11
+inline bool is_compressed(uint32_t instr_code) {
+  return (instr_code & 0x3) != 0x3;
+}
+
+// expand an RV32C instruction into its 32-bit RV32I equivalent,
+// returns 0 for illegal or reserved encodings
+uint32_t rvc_expand(uint32_t instr_code);
+
+}
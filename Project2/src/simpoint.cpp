@@ -0,0 +1,262 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <map>
+#include "simpoint.h"
+
+using namespace tinyrv;
+
+static double dist2(const std::vector<double>& a, const std::vector<double>& b) {
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    double d = a[i] - b[i];
+    sum += d * d;
+  }
+  return sum;
+}
+
+SimPoint::SimPoint(uint64_t interval, uint32_t max_k)
+  : interval_(interval)
+  , max_k_(max_k)
+{}
+
+void SimPoint::add_interval(const bbv_t& bbv) {
+  bbvs_.push_back(bbv);
+}
+
+void SimPoint::cluster() {
+  points_.clear();
+  uint32_t n = bbvs_.size();
+  if (n == 0)
+    return;
+
+  // normalize each vector and project it onto DIMS random directions,
+  // one fixed uniform [-1, 1] row per block
+  uint32_t max_id = 0;
+  for (auto& bbv : bbvs_) {
+    for (auto& entry : bbv) {
+      max_id = std::max(max_id, entry.first);
+    }
+  }
+  std::mt19937 rng(0x5eed);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::vector<vec_t> projection(max_id + 1, vec_t(DIMS));
+  for (auto& row : projection) {
+    for (auto& x : row) {
+      x = uniform(rng);
+    }
+  }
+  std::vector<vec_t> data(n, vec_t(DIMS, 0.0));
+  for (uint32_t i = 0; i < n; ++i) {
+    uint64_t total = 0;
+    for (auto& entry : bbvs_[i]) {
+      total += entry.second;
+    }
+    for (auto& entry : bbvs_[i]) {
+      double f = double(entry.second) / total;
+      for (uint32_t d = 0; d < DIMS; ++d) {
+        data[i][d] += f * projection[entry.first][d];
+      }
+    }
+  }
+
+  // cluster for every k, keep the smallest one scoring within 90% of the
+  // best BIC over the range seen
+  uint32_t max_k = std::max(1u, std::min(max_k_, (n > 1) ? (n - 1) : 1));
+  std::vector<std::vector<uint32_t>> labels(max_k + 1);
+  std::vector<std::vector<vec_t>> centers(max_k + 1);
+  std::vector<double> scores(max_k + 1);
+  double min_score = std::numeric_limits<double>::infinity();
+  double max_score = -min_score;
+  for (uint32_t k = 1; k <= max_k; ++k) {
+    double distortion = this->kmeans(data, k, &labels[k], &centers[k]);
+    scores[k] = bic(data, k, distortion, labels[k]);
+    min_score = std::min(min_score, scores[k]);
+    max_score = std::max(max_score, scores[k]);
+  }
+  uint32_t best_k = max_k;
+  for (uint32_t k = 1; k <= max_k; ++k) {
+    if (scores[k] >= min_score + 0.9 * (max_score - min_score)) {
+      best_k = k;
+      break;
+    }
+  }
+
+  // the interval closest to each centroid represents its cluster
+  auto& best_labels = labels[best_k];
+  auto& best_centers = centers[best_k];
+  for (uint32_t c = 0; c < best_k; ++c) {
+    uint32_t members = 0;
+    uint32_t closest = 0;
+    double closest_dist = std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < n; ++i) {
+      if (best_labels[i] != c)
+        continue;
+      ++members;
+      double d = dist2(data[i], best_centers[c]);
+      if (d < closest_dist) {
+        closest_dist = d;
+        closest = i;
+      }
+    }
+    if (members != 0) {
+      points_.push_back({closest, uint32_t(points_.size()), double(members) / n});
+    }
+  }
+  std::sort(points_.begin(), points_.end(), [](const point_t& a, const point_t& b) {
+    return a.interval < b.interval;
+  });
+}
+
+double SimPoint::kmeans(const std::vector<vec_t>& data, uint32_t k, std::vector<uint32_t>* labels, std::vector<vec_t>* centers) const {
+  uint32_t n = data.size();
+  double best = std::numeric_limits<double>::infinity();
+  for (uint32_t seed = 1; seed <= SEEDS; ++seed) {
+    std::mt19937 rng(seed);
+
+    // k-means++ seeding: each new center is drawn with probability
+    // proportional to its squared distance from the nearest one
+    std::vector<vec_t> c;
+    c.push_back(data[rng() % n]);
+    std::vector<double> d2(n);
+    while (c.size() < k) {
+      double sum = 0;
+      for (uint32_t i = 0; i < n; ++i) {
+        d2[i] = std::numeric_limits<double>::infinity();
+        for (auto& center : c) {
+          d2[i] = std::min(d2[i], dist2(data[i], center));
+        }
+        sum += d2[i];
+      }
+      uint32_t pick = rng() % n;
+      if (sum > 0) {
+        double r = std::uniform_real_distribution<double>(0, sum)(rng);
+        for (pick = 0; pick + 1 < n && r >= d2[pick]; ++pick) {
+          r -= d2[pick];
+        }
+      }
+      c.push_back(data[pick]);
+    }
+
+    // Lloyd iterations, an empty cluster keeps its center
+    std::vector<uint32_t> l(n, k);
+    for (uint32_t iter = 0; iter < MAX_ITERATIONS; ++iter) {
+      bool changed = false;
+      for (uint32_t i = 0; i < n; ++i) {
+        uint32_t nearest = 0;
+        double nearest_dist = dist2(data[i], c[0]);
+        for (uint32_t j = 1; j < k; ++j) {
+          double d = dist2(data[i], c[j]);
+          if (d < nearest_dist) {
+            nearest_dist = d;
+            nearest = j;
+          }
+        }
+        if (l[i] != nearest) {
+          l[i] = nearest;
+          changed = true;
+        }
+      }
+      if (!changed)
+        break;
+      std::vector<vec_t> sums(k, vec_t(DIMS, 0.0));
+      std::vector<uint32_t> counts(k, 0);
+      for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t d = 0; d < DIMS; ++d) {
+          sums[l[i]][d] += data[i][d];
+        }
+        ++counts[l[i]];
+      }
+      for (uint32_t j = 0; j < k; ++j) {
+        if (counts[j] == 0)
+          continue;
+        for (uint32_t d = 0; d < DIMS; ++d) {
+          c[j][d] = sums[j][d] / counts[j];
+        }
+      }
+    }
+
+    double distortion = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      distortion += dist2(data[i], c[l[i]]);
+    }
+    if (distortion < best) {
+      best = distortion;
+      *labels = l;
+      *centers = c;
+    }
+  }
+  return best;
+}
+
+double SimPoint::bic(const std::vector<vec_t>& data, uint32_t k, double distortion, const std::vector<uint32_t>& labels) {
+  // spherical Gaussian mixture with a pooled variance (Pelleg and Moore)
+  double R = data.size();
+  double d = DIMS;
+  double variance = (R > k) ? (distortion / (d * (R - k))) : 0;
+  variance = std::max(variance, 1e-12);
+  std::vector<uint32_t> sizes(k, 0);
+  for (auto label : labels) {
+    ++sizes[label];
+  }
+  double likelihood = -R * d / 2 * std::log(2 * M_PI * variance) - distortion / (2 * variance);
+  for (auto size : sizes) {
+    if (size != 0) {
+      likelihood += size * std::log(size / R);
+    }
+  }
+  double params = (k - 1) + k * d + 1;
+  return likelihood - params / 2 * std::log(R);
+}
+
+void SimPoint::write_bb(std::ostream& os) const {
+  for (auto& bbv : bbvs_) {
+    os << "T";
+    for (auto& entry : bbv) {
+      os << ":" << entry.first << ":" << entry.second << " ";
+    }
+    os << std::endl;
+  }
+}
+
+void SimPoint::write_points(std::ostream& simpoints, std::ostream& weights) const {
+  for (auto& point : points_) {
+    simpoints << point.interval << " " << point.cluster << std::endl;
+    weights << point.weight << " " << point.cluster << std::endl;
+  }
+}
+
+bool SimPoint::read_points(std::istream& simpoints, std::istream& weights) {
+  std::map<uint32_t, double> cluster_weights;
+  double weight;
+  uint32_t cluster;
+  while (weights >> weight >> cluster) {
+    cluster_weights[cluster] = weight;
+  }
+  points_.clear();
+  uint32_t interval;
+  while (simpoints >> interval >> cluster) {
+    auto it = cluster_weights.find(cluster);
+    if (it == cluster_weights.end())
+      return false;
+    points_.push_back({interval, cluster, it->second});
+  }
+  std::sort(points_.begin(), points_.end(), [](const point_t& a, const point_t& b) {
+    return a.interval < b.interval;
+  });
+  return !points_.empty();
+}
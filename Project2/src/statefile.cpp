@@ -0,0 +1,117 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "statefile.h"
+
+using namespace tinyrv;
+
+static const char STATE_MAGIC[4] = {'T', 'R', 'V', 'S'};
+static const uint32_t STATE_VERSION = 1;
+static const uint32_t STATE_NAME_SIZE = 32;
+
+static uint64_t align8(uint64_t size) {
+  return (size + 7) & ~uint64_t(7);
+}
+
+StateWriter::StateWriter(const char* filename)
+  : os_(filename, std::ios::binary) {
+  os_.write(STATE_MAGIC, sizeof(STATE_MAGIC));
+  os_.write(reinterpret_cast<const char*>(&STATE_VERSION), sizeof(STATE_VERSION));
+}
+
+StateWriter::~StateWriter() {
+  //--
+}
+
+void StateWriter::write(const std::string& name, const void* data, uint64_t size) {
+  char header[STATE_NAME_SIZE] = {};
+  strncpy(header, name.c_str(), STATE_NAME_SIZE - 1);
+  static const char padding[8] = {};
+  os_.write(header, sizeof(header));
+  os_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  os_.write(reinterpret_cast<const char*>(data), size);
+  os_.write(padding, align8(size) - size);
+}
+
+StateReader::StateReader(const char* filename)
+  : base_(nullptr)
+  , size_(0)
+  , good_(false) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      base_ = reinterpret_cast<const uint8_t*>(addr);
+      size_ = st.st_size;
+    }
+  }
+  close(fd);
+  if (!base_)
+    return;
+
+  // header, then index the sections
+  uint32_t version = 0;
+  if (size_ < sizeof(STATE_MAGIC) + sizeof(version)
+   || memcmp(base_, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0)
+    return;
+  memcpy(&version, base_ + sizeof(STATE_MAGIC), sizeof(version));
+  if (version != STATE_VERSION) {
+    std::cout << "*** error: state file version " << version << ", expected " << STATE_VERSION << std::endl;
+    return;
+  }
+  uint64_t offset = sizeof(STATE_MAGIC) + sizeof(version);
+  while (offset < size_) {
+    uint64_t size;
+    if (size_ - offset < STATE_NAME_SIZE + sizeof(size))
+      return;
+    std::string name(reinterpret_cast<const char*>(base_ + offset), strnlen(reinterpret_cast<const char*>(base_ + offset), STATE_NAME_SIZE));
+    memcpy(&size, base_ + offset + STATE_NAME_SIZE, sizeof(size));
+    offset += STATE_NAME_SIZE + sizeof(size);
+    if (size > size_ - offset)
+      return;
+    sections_[name] = {base_ + offset, size};
+    offset += std::min(align8(size), size_ - offset);
+  }
+  good_ = true;
+}
+
+StateReader::~StateReader() {
+  if (base_) {
+    munmap(const_cast<uint8_t*>(base_), size_);
+  }
+}
+
+bool StateReader::read(const std::string& name, void* data, uint64_t size) const {
+  auto it = sections_.find(name);
+  if (it == sections_.end()) {
+    std::cout << "*** error: state file has no " << name << " section" << std::endl;
+    return false;
+  }
+  if (it->second.size != size) {
+    std::cout << "*** error: state section " << name << " holds " << it->second.size
+              << " bytes, expected " << size << std::endl;
+    return false;
+  }
+  memcpy(data, it->second.data, size);
+  return true;
+}
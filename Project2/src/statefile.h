@@ -0,0 +1,86 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace tinyrv {
+
+// Microarchitectural state file.
+// The file starts with a "TRVS" magic and a 32-bit version, then holds
+// named sections: a 32-byte name, a 64-bit payload size and the payload,
+// padded to 8 bytes. Payloads are the components' raw tables, a component
+// checks that a section's size matches its own geometry before copying it.
+class StateWriter {
+public:
+  StateWriter(const char* filename);
+
+  ~StateWriter();
+
+  bool good() const {
+    return os_.good();
+  }
+
+  void write(const std::string& name, const void* data, uint64_t size);
+
+  template <typename T>
+  void write(const std::string& name, const std::vector<T>& values) {
+    this->write(name, values.data(), values.size() * sizeof(T));
+  }
+
+private:
+  std::ofstream os_;
+};
+
+// The file is mapped read-only, sections are read in place.
+class StateReader {
+public:
+  StateReader(const char* filename);
+
+  ~StateReader();
+
+  // the file was mapped and its header and sections are well formed
+  bool good() const {
+    return good_;
+  }
+
+  bool has(const std::string& name) const {
+    return sections_.count(name) != 0;
+  }
+
+  // copy a section whose payload must be exactly size bytes
+  bool read(const std::string& name, void* data, uint64_t size) const;
+
+  template <typename T>
+  bool read(const std::string& name, std::vector<T>* values) const {
+    return this->read(name, values->data(), values->size() * sizeof(T));
+  }
+
+private:
+  struct section_t {
+    const uint8_t* data;
+    uint64_t size;
+  };
+
+  const uint8_t* base_;
+  uint64_t size_;
+  bool good_;
+  std::unordered_map<std::string, section_t> sections_;
+};
+
+}
@@ -0,0 +1,154 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include <simobject.h>
+#include "debug.h"
+#include "write_buffer.h"
+
+using namespace tinyrv;
+
+WriteBuffer::WriteBuffer(const Config& config, MemoryUnit* mmu)
+  : config_(config)
+  , mmu_(mmu) {
+  assert(ispow2(config.block_size));
+  this->reset();
+}
+
+WriteBuffer::~WriteBuffer() {
+  //--
+}
+
+void WriteBuffer::reset() {
+  entries_.clear();
+  perf_stats_ = PerfStats();
+}
+
+WriteBuffer::entry_t* WriteBuffer::find(uint64_t block_addr, bool mergeable) {
+  // search youngest first
+  for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+    if (it->block_addr != block_addr)
+      continue;
+    if (mergeable && it->draining)
+      return nullptr;
+    return &(*it);
+  }
+  return nullptr;
+}
+
+void WriteBuffer::tick(uint64_t cycles) {
+  if (entries_.empty())
+    return;
+  auto& head = entries_.front();
+  if (!head.draining) {
+    head.draining = true;
+    head.done_cycle = cycles + config_.latency;
+  }
+  if (cycles >= head.done_cycle) {
+    this->drain(head);
+    entries_.pop_front();
+  }
+}
+
+bool WriteBuffer::can_accept(uint64_t addr, uint32_t size) {
+  uint32_t needed = 0;
+  uint64_t first = addr & ~uint64_t(config_.block_size - 1);
+  uint64_t last = (addr + size - 1) & ~uint64_t(config_.block_size - 1);
+  for (uint64_t block_addr = first; block_addr <= last; block_addr += config_.block_size) {
+    if (this->find(block_addr, true) == nullptr) {
+      ++needed;
+    }
+  }
+  if (entries_.size() + needed <= config_.size)
+    return true;
+  ++perf_stats_.full_stalls;
+  return false;
+}
+
+void WriteBuffer::write(const void* data, uint64_t addr, uint32_t size) {
+  ++perf_stats_.stores;
+  auto bytes = (const uint8_t*)data;
+  bool coalesced = true;
+  for (uint32_t i = 0; i < size; ++i) {
+    uint64_t byte_addr = addr + i;
+    uint64_t block_addr = byte_addr & ~uint64_t(config_.block_size - 1);
+    auto entry = this->find(block_addr, true);
+    if (entry == nullptr) {
+      assert(entries_.size() < config_.size);
+      entries_.push_back({block_addr,
+                          std::vector<uint8_t>(config_.block_size),
+                          std::vector<bool>(config_.block_size, false),
+                          false, 0});
+      entry = &entries_.back();
+      coalesced = false;
+    }
+    uint32_t offset = byte_addr - block_addr;
+    entry->data[offset] = bytes[i];
+    entry->mask[offset] = true;
+  }
+  if (coalesced) {
+    ++perf_stats_.coalesced;
+  }
+  DT(3, "WBUF: write addr=0x" << std::hex << addr << std::dec << ", size=" << size << ", coalesced=" << coalesced << ", entries=" << entries_.size());
+}
+
+void WriteBuffer::read(void* data, uint64_t addr, uint32_t size) {
+  mmu_->read(data, addr, size, 0);
+  if (entries_.empty())
+    return;
+  // overlay buffered bytes, older entries first so the youngest store wins
+  auto bytes = (uint8_t*)data;
+  bool forwarded = false;
+  for (auto& entry : entries_) {
+    for (uint32_t i = 0; i < size; ++i) {
+      uint64_t byte_addr = addr + i;
+      if ((byte_addr & ~uint64_t(config_.block_size - 1)) != entry.block_addr)
+        continue;
+      uint32_t offset = byte_addr - entry.block_addr;
+      if (entry.mask[offset]) {
+        bytes[i] = entry.data[offset];
+        forwarded = true;
+      }
+    }
+  }
+  if (forwarded) {
+    ++perf_stats_.forwards;
+  }
+}
+
+void WriteBuffer::flush() {
+  for (auto& entry : entries_) {
+    this->drain(entry);
+  }
+  entries_.clear();
+}
+
+void WriteBuffer::drain(const entry_t& entry) {
+  // write each contiguous run of valid bytes
+  uint32_t i = 0;
+  while (i < config_.block_size) {
+    if (!entry.mask[i]) {
+      ++i;
+      continue;
+    }
+    uint32_t start = i;
+    while (i < config_.block_size && entry.mask[i]) {
+      ++i;
+    }
+    mmu_->write(&entry.data[start], entry.block_addr + start, i - start, 0);
+  }
+  ++perf_stats_.drains;
+  DT(3, "WBUF: drain addr=0x" << std::hex << entry.block_addr << std::dec);
+}
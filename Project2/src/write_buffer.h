@@ -0,0 +1,99 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mem.h>
+
+namespace tinyrv {
+
+// Coalescing write buffer.
+// Stores retire into block-sized entries and drain to memory in FIFO order,
+// one entry at a time, each taking a fixed latency. Stores to a block that
+// is already buffered (and not draining) merge into its entry, and loads
+// read memory with the buffered bytes forwarded on top.
+class WriteBuffer {
+public:
+  struct Config {
+    uint32_t size;        // number of entries
+    uint32_t block_size;  // entry size (bytes)
+    uint32_t latency;     // memory write latency (cycles)
+  };
+
+  struct PerfStats {
+    uint64_t stores;
+    uint64_t coalesced;
+    uint64_t forwards;
+    uint64_t full_stalls;
+    uint64_t drains;
+
+    PerfStats()
+      : stores(0)
+      , coalesced(0)
+      , forwards(0)
+      , full_stalls(0)
+      , drains(0)
+    {}
+  };
+
+  WriteBuffer(const Config& config, MemoryUnit* mmu);
+
+  ~WriteBuffer();
+
+  void reset();
+
+  // drain the buffer in the background
+  void tick(uint64_t cycles);
+
+  // check if a store can be buffered, counts a full stall otherwise
+  bool can_accept(uint64_t addr, uint32_t size);
+
+  void write(const void* data, uint64_t addr, uint32_t size);
+
+  // read memory, forwarding buffered bytes
+  void read(void* data, uint64_t addr, uint32_t size);
+
+  // write back all buffered stores immediately
+  void flush();
+
+  bool empty() const {
+    return entries_.empty();
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  struct entry_t {
+    uint64_t block_addr;
+    std::vector<uint8_t> data;
+    std::vector<bool> mask;
+    bool     draining;
+    uint64_t done_cycle;
+  };
+
+  entry_t* find(uint64_t block_addr, bool mergeable);
+
+  void drain(const entry_t& entry);
+
+  Config config_;
+  MemoryUnit* mmu_;
+  std::deque<entry_t> entries_;
+  PerfStats perf_stats_;
+};
+
+}
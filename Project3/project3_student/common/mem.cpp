@@ -13,6 +13,7 @@
 
 #include "mem.h"
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <assert.h>
@@ -194,7 +195,9 @@ RAM::RAM(uint32_t page_size, uint64_t capacity)
   : capacity_(capacity)
   , page_bits_(log2ceil(page_size))
   , last_page_(nullptr)
-  , last_page_index_(0) {    
+  , last_page_index_(0)
+  , image_base_(0)
+  , image_end_(0) {
    assert(ispow2(page_size));
    assert(0 == capacity || ispow2(capacity));
    assert(0 == (capacity % page_size));
@@ -274,6 +277,8 @@ void RAM::loadBinImage(const char* filename, uint64_t destination) {
 
   this->clear();
   this->write(content.data(), destination, size);
+  image_base_ = destination;
+  image_end_ = destination + size;
 }
 
 void RAM::loadHexImage(const char* filename) {
@@ -309,6 +314,8 @@ void RAM::loadHexImage(const char* filename) {
   char *line = content.data();
 
   this->clear();
+  image_base_ = ~uint64_t(0);
+  image_end_ = 0;
 
   while (true) {
     if (line[0] == ':') {
@@ -322,6 +329,8 @@ void RAM::loadHexImage(const char* filename) {
           uint32_t value = hToI(line + 9 + i * 2, 2);
           *this->get(addr) = value;
         }
+        image_base_ = std::min<uint64_t>(image_base_, nextAddr);
+        image_end_ = std::max<uint64_t>(image_end_, nextAddr + byteCount);
         break;
       case 2:
         offset = hToI(line + 9, 4) << 4;
@@ -342,4 +351,8 @@ void RAM::loadHexImage(const char* filename) {
     ++line;
     --size;
   }
+
+  if (image_base_ > image_end_) {
+    image_base_ = image_end_ = 0;
+  }
 }
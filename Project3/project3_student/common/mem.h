@@ -171,6 +171,15 @@ public:
   void loadBinImage(const char* filename, uint64_t destination);
   void loadHexImage(const char* filename);
 
+  // address range covered by the last loaded image
+  uint64_t image_base() const {
+    return image_base_;
+  }
+
+  uint64_t image_end() const {
+    return image_end_;
+  }
+
   uint8_t& operator[](uint64_t address) {
     return *this->get(address);
   }
@@ -188,6 +197,8 @@ private:
   mutable std::unordered_map<uint64_t, uint8_t*> pages_;
   mutable uint8_t* last_page_;
   mutable uint64_t last_page_index_;
+  uint64_t image_base_;
+  uint64_t image_end_;
 };
 
 } // namespace tinyrv
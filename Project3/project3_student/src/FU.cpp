@@ -12,6 +12,7 @@
 // limitations under the License.
 
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 #include <util.h>
 #include "FU.h"
@@ -19,143 +20,236 @@
 
 using namespace tinyrv;
 
-static uint32_t execute_alu_op(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data) {
-  auto exe_flags  = instr.getExeFlags();
-  auto alu_op     = instr.getAluOp();
+namespace {
 
-  uint32_t alu_s1 = exe_flags.alu_s1_PC ? instr.getPC() : (exe_flags.alu_s1_rs1 ? instr.getRs1() :  rs1_data);
-  uint32_t alu_s2 = exe_flags.alu_s2_imm ? instr.getImm() : rs2_data;
+typedef uint32_t (*AluKernel)(const StaticInstr &instr, uint32_t rs1_data, uint32_t rs2_data);
+typedef bool (*BrKernel)(uint32_t rs1_data, uint32_t rs2_data);
 
-  if (exe_flags.alu_s1_inv) {
+template <AluOp alu_op>
+inline uint32_t alu_compute(uint32_t alu_s1, uint32_t alu_s2) {
+  switch (alu_op) {
+  case AluOp::NONE: return 0;
+  case AluOp::ADD:  return alu_s1 + alu_s2;
+  case AluOp::SUB:  return alu_s1 - alu_s2;
+  case AluOp::AND:  return alu_s1 & alu_s2;
+  case AluOp::OR:   return alu_s1 | alu_s2;
+  case AluOp::XOR:  return alu_s1 ^ alu_s2;
+  case AluOp::SLL:  return alu_s1 << (alu_s2 & 0x1f);
+  case AluOp::SRL:  return alu_s1 >> (alu_s2 & 0x1f);
+  case AluOp::SRA:  return (int32_t)alu_s1 >> (alu_s2 & 0x1f);
+  case AluOp::LTI:  return (int32_t)alu_s1 < (int32_t)alu_s2;
+  case AluOp::LTU:  return alu_s1 < alu_s2;
+  case AluOp::MUL:  return alu_s1 * alu_s2;
+  case AluOp::MULH: return (int64_t)(int32_t)alu_s1 * (int32_t)alu_s2 >> 32;
+  case AluOp::MULHSU: return (int64_t)(int32_t)alu_s1 * (uint64_t)alu_s2 >> 32;
+  case AluOp::MULHU: return (uint64_t)alu_s1 * alu_s2 >> 32;
+  case AluOp::DIV:
+    if (alu_s2 == 0)
+      return 0xffffffff;
+    if (alu_s1 == 0x80000000 && alu_s2 == 0xffffffff)
+      return alu_s1; // overflow
+    return (int32_t)alu_s1 / (int32_t)alu_s2;
+  case AluOp::DIVU: return alu_s2 ? (alu_s1 / alu_s2) : 0xffffffff;
+  case AluOp::REM:
+    if (alu_s2 == 0)
+      return alu_s1;
+    if (alu_s1 == 0x80000000 && alu_s2 == 0xffffffff)
+      return 0; // overflow
+    return (int32_t)alu_s1 % (int32_t)alu_s2;
+  case AluOp::REMU: return alu_s2 ? (alu_s1 % alu_s2) : alu_s1;
+  case AluOp::SH1ADD: return (alu_s1 << 1) + alu_s2;
+  case AluOp::SH2ADD: return (alu_s1 << 2) + alu_s2;
+  case AluOp::SH3ADD: return (alu_s1 << 3) + alu_s2;
+  case AluOp::ANDN: return alu_s1 & ~alu_s2;
+  case AluOp::ORN:  return alu_s1 | ~alu_s2;
+  case AluOp::XNOR: return ~(alu_s1 ^ alu_s2);
+  case AluOp::CLZ:  return count_leading_zeros(alu_s1);
+  case AluOp::CTZ:  return count_trailing_zeros(alu_s1);
+  case AluOp::CPOP: return count_ones(alu_s1);
+  case AluOp::MIN:  return ((int32_t)alu_s1 < (int32_t)alu_s2) ? alu_s1 : alu_s2;
+  case AluOp::MINU: return (alu_s1 < alu_s2) ? alu_s1 : alu_s2;
+  case AluOp::MAX:  return ((int32_t)alu_s1 < (int32_t)alu_s2) ? alu_s2 : alu_s1;
+  case AluOp::MAXU: return (alu_s1 < alu_s2) ? alu_s2 : alu_s1;
+  case AluOp::SEXTB: return (int32_t)(int8_t)alu_s1;
+  case AluOp::SEXTH: return (int32_t)(int16_t)alu_s1;
+  case AluOp::ZEXTH: return alu_s1 & 0xffff;
+  case AluOp::ROL:  return rotate_left(alu_s1, alu_s2);
+  case AluOp::ROR:  return rotate_right(alu_s1, alu_s2);
+  case AluOp::REV8: return byte_swap(alu_s1);
+  case AluOp::ORCB: return or_combine_bytes(alu_s1);
+  }
+  return 0;
+}
+
+// one kernel per ALU operation and operand sources,
+// alu_src holds the ALU_SRC_* bits resolved at decode time.
+template <AluOp alu_op, uint32_t alu_src>
+uint32_t alu_kernel(const StaticInstr &instr, uint32_t rs1_data, uint32_t rs2_data) {
+  uint32_t alu_s1 = (alu_src & ALU_SRC_S1_PC) ? instr.getPC() : ((alu_src & ALU_SRC_S1_RS1) ? instr.getRs1() : rs1_data);
+  uint32_t alu_s2 = (alu_src & ALU_SRC_S2_IMM) ? instr.getImm() : rs2_data;
+  if (alu_src & ALU_SRC_S1_INV) {
     alu_s1 = ~alu_s1;
   }
+  return alu_compute<alu_op>(alu_s1, alu_s2);
+}
 
-  uint32_t rd_data = 0;
+struct AluKernelTable {
+  AluKernel kernels[ALU_KERNELS];
 
-  switch (alu_op) {
-  case AluOp::NONE:
-    break;
-  case AluOp::ADD: {
-    rd_data = alu_s1 + alu_s2;
-    break;
-  }
-  case AluOp::SUB: {
-    rd_data = alu_s1 - alu_s2;
-    break;
-  }
-  case AluOp::AND: {
-    rd_data = alu_s1 & alu_s2;
-    break;
-  }
-  case AluOp::OR: {
-    rd_data = alu_s1 | alu_s2;
-    break;
+  template <AluOp alu_op>
+  void add() {
+    static const AluKernel op_kernels[ALU_SRC_COMBOS] = {
+      alu_kernel<alu_op, 0>,  alu_kernel<alu_op, 1>,  alu_kernel<alu_op, 2>,  alu_kernel<alu_op, 3>,
+      alu_kernel<alu_op, 4>,  alu_kernel<alu_op, 5>,  alu_kernel<alu_op, 6>,  alu_kernel<alu_op, 7>,
+      alu_kernel<alu_op, 8>,  alu_kernel<alu_op, 9>,  alu_kernel<alu_op, 10>, alu_kernel<alu_op, 11>,
+      alu_kernel<alu_op, 12>, alu_kernel<alu_op, 13>, alu_kernel<alu_op, 14>, alu_kernel<alu_op, 15>,
+    };
+    std::copy(op_kernels, op_kernels + ALU_SRC_COMBOS, kernels + alu_kernel_index(alu_op, 0));
   }
-  case AluOp::XOR: {
-    rd_data = alu_s1 ^ alu_s2;
-    break;
-  }
-  case AluOp::SLL: {
-    rd_data = alu_s1 << alu_s2;
-    break;
-  }
-  case AluOp::SRL: {
-    rd_data = alu_s1 >> alu_s2;
-    break;
-  }
-  case AluOp::SRA: {
-    rd_data = (int32_t)alu_s1 >> alu_s2;
-    break;
-  }
-  case AluOp::LTI: {
-    rd_data = (int32_t)alu_s1 < (int32_t)alu_s2;
-    break;
-  }
-  case AluOp::LTU: {
-    rd_data = alu_s1 < alu_s2;
-    break;
-  }
-  default:
-    std::abort();
+
+  AluKernelTable() {
+    std::fill(kernels, kernels + ALU_KERNELS, nullptr);
+    this->add<AluOp::NONE>();
+    this->add<AluOp::ADD>();
+    this->add<AluOp::SUB>();
+    this->add<AluOp::AND>();
+    this->add<AluOp::OR>();
+    this->add<AluOp::XOR>();
+    this->add<AluOp::SLL>();
+    this->add<AluOp::SRL>();
+    this->add<AluOp::SRA>();
+    this->add<AluOp::LTI>();
+    this->add<AluOp::LTU>();
+    this->add<AluOp::MUL>();
+    this->add<AluOp::MULH>();
+    this->add<AluOp::MULHSU>();
+    this->add<AluOp::MULHU>();
+    this->add<AluOp::DIV>();
+    this->add<AluOp::DIVU>();
+    this->add<AluOp::REM>();
+    this->add<AluOp::REMU>();
+    this->add<AluOp::SH1ADD>();
+    this->add<AluOp::SH2ADD>();
+    this->add<AluOp::SH3ADD>();
+    this->add<AluOp::ANDN>();
+    this->add<AluOp::ORN>();
+    this->add<AluOp::XNOR>();
+    this->add<AluOp::CLZ>();
+    this->add<AluOp::CTZ>();
+    this->add<AluOp::CPOP>();
+    this->add<AluOp::MIN>();
+    this->add<AluOp::MINU>();
+    this->add<AluOp::MAX>();
+    this->add<AluOp::MAXU>();
+    this->add<AluOp::SEXTB>();
+    this->add<AluOp::SEXTH>();
+    this->add<AluOp::ZEXTH>();
+    this->add<AluOp::ROL>();
+    this->add<AluOp::ROR>();
+    this->add<AluOp::REV8>();
+    this->add<AluOp::ORCB>();
   }
+};
 
-  return rd_data;
-}
+const AluKernelTable sc_aluKernels;
 
-///////////////////////////////////////////////////////////////////////////////
+bool br_none(uint32_t, uint32_t) { return false; }
+bool br_jump(uint32_t, uint32_t) { return true; }
+bool br_beq(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data == rs2_data; }
+bool br_bne(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data != rs2_data; }
+bool br_blt(uint32_t rs1_data, uint32_t rs2_data) { return (int32_t)rs1_data < (int32_t)rs2_data; }
+bool br_bge(uint32_t rs1_data, uint32_t rs2_data) { return (int32_t)rs1_data >= (int32_t)rs2_data; }
+bool br_bltu(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data < rs2_data; }
+bool br_bgeu(uint32_t rs1_data, uint32_t rs2_data) { return rs1_data >= rs2_data; }
 
-static uint32_t execute_br_op(BrOp br_op, uint32_t rs1_data, uint32_t rs2_data) {
-  bool br_taken = false;
+// indexed by BrOp
+const BrKernel sc_brKernels[] = {
+  br_none, br_jump, br_jump, br_beq, br_bne, br_blt, br_bge, br_bltu, br_bgeu
+};
 
-  switch (br_op) {
-  case BrOp::NONE:
-    break;
-  case BrOp::JAL:
-  case BrOp::JALR: {
-    br_taken = true;
-    break;
-  }
-  case BrOp::BEQ: {
-    br_taken = (rs1_data == rs2_data);
-    break;
-  }
-  case BrOp::BNE: {
-    br_taken = (rs1_data != rs2_data);
-    break;
-  }
-  case BrOp::BLT: {
-    br_taken = ((int32_t)rs1_data < (int32_t)rs2_data);
-    break;
-  }
-  case BrOp::BGE: {
-    br_taken = ((int32_t)rs1_data >= (int32_t)rs2_data);
-    break;
-  }
-  case BrOp::BLTU: {
-    br_taken = (rs1_data < rs2_data);
-    break;
-  }
-  case BrOp::BGEU: {
-    br_taken = (rs1_data >= rs2_data);
-    break;
-  }
-  default:
-    std::abort();
-  }
+}
 
-  return br_taken;
+uint32_t tinyrv::execute_alu_op(const StaticInstr &instr, uint32_t rs1_data, uint32_t rs2_data) {
+  return sc_aluKernels.kernels[instr.getAluKernel()](instr, rs1_data, rs2_data);
+}
+
+bool tinyrv::execute_br_op(BrOp br_op, uint32_t rs1_data, uint32_t rs2_data) {
+  return sc_brKernels[uint32_t(br_op)](rs1_data, rs2_data);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void ALU::do_execute() {
-  result_ = execute_alu_op(*instr_, rs1_value_, rs2_value_);
+  result_ = execute_alu_op(instr_, rs1_value_, rs2_value_);
 }
 
 void BRU::do_execute() {
-  auto br_op = instr_->getBrOp();
+  auto br_op = instr_.getBrOp();
   auto br_taken = execute_br_op(br_op, rs1_value_, rs2_value_);
   if (br_taken) {
-    auto br_target = execute_alu_op(*instr_, rs1_value_, rs2_value_);
+    auto br_target = execute_alu_op(instr_, rs1_value_, rs2_value_);
     core_->PC_ = br_target;
     if (br_op == BrOp::JAL || br_op == BrOp::JALR) {
-      result_ = instr_->getPC() + 4; // return PC + 4
+      result_ = instr_.getPC() + instr_.getSize(); // return address
     }
   }
-  DT(2, "Branch: " << (br_taken ? "taken" : "not-taken") << ", target=0x" << std::hex << core_->PC_ << std::dec << " (#" << instr_->getId() << ")");
+  DT(2, "Branch: " << (br_taken ? "taken" : "not-taken") << ", target=0x" << std::hex << core_->PC_ << std::dec << " (#" << instr_.getId() << ")");
   core_->fetch_stalled_->write(false); // release fetch stage
 }
 
+LSU::LSU(Core* core, uint32_t latency)
+  : FunctionalUnit(latency)
+  , MemReqPort(core)
+  , MemRspPort(core)
+  , core_(core)
+  , mem_pending_(false)
+{}
+
+bool LSU::do_complete(uint32_t cycles) {
+  if (cycles == 1) {
+    // send the memory request on the first cycle
+    uint64_t mem_addr = execute_alu_op(instr_, rs1_value_, rs2_value_);
+    if (get_addr_type(mem_addr) == AddrType::IO) {
+      mem_pending_ = false;
+    } else {
+      MemReqPort.send(MemReq{mem_addr, (bool)instr_.getExeFlags().is_store, (uint32_t)instr_.getId()}, 1);
+      mem_pending_ = true;
+    }
+  }
+
+  if (!mem_pending_)
+    return FunctionalUnit::do_complete(cycles);
+
+  // drop late responses to requests cleared before they returned
+  while (!MemRspPort.empty() && MemRspPort.front().tag != (uint32_t)instr_.getId()) {
+    MemRspPort.pop();
+  }
+  if (MemRspPort.empty())
+    return false;
+
+  MemRspPort.pop();
+  mem_pending_ = false;
+  return true;
+}
+
+void LSU::clear() {
+  FunctionalUnit::clear();
+  mem_pending_ = false;
+  while (!MemRspPort.empty()) {
+    MemRspPort.pop();
+  }
+}
+
 void LSU::do_execute() {
-  auto exe_flags = instr_->getExeFlags();
-  auto func3 = instr_->getFunc3();
+  auto exe_flags = instr_.getExeFlags();
+  auto func3 = instr_.getFunc3();
 
   if (exe_flags.is_load) {
-    uint64_t mem_addr = execute_alu_op(*instr_, rs1_value_, rs2_value_);
+    uint64_t mem_addr = execute_alu_op(instr_, rs1_value_, rs2_value_);
     uint32_t data_bytes = 1 << (func3 & 0x3);
     uint32_t data_width = 8 * data_bytes;
     uint32_t read_data = 0;
-    core_->dmem_read(&read_data, mem_addr, data_bytes);
+    core_->dmem_read(&read_data, mem_addr, data_bytes, instr_.getPC());
     switch (func3) {
     case 0: // RV32I: LB
     case 1: // RV32I: LH
@@ -172,13 +266,13 @@ void LSU::do_execute() {
       std::abort();
     }
   } else if (exe_flags.is_store) {
-    uint64_t mem_addr = execute_alu_op(*instr_, rs1_value_, rs2_value_);
+    uint64_t mem_addr = execute_alu_op(instr_, rs1_value_, rs2_value_);
     uint32_t data_bytes = 1 << (func3 & 0x3);
     switch (func3) {
     case 0:
     case 1:
     case 2:
-      core_->dmem_write(&rs2_value_, mem_addr, data_bytes);
+      core_->dmem_write(&rs2_value_, mem_addr, data_bytes, instr_.getPC(), instr_.getId());
       break;
     default:
       std::abort();
@@ -187,10 +281,91 @@ void LSU::do_execute() {
 }
 
 void SFU::do_execute() {
-  auto csr_data = core_->get_csr(instr_->getImm());
-  auto rd_data = execute_alu_op(*instr_, rs1_value_, csr_data);
+  auto csr_data = core_->get_csr(instr_.getImm());
+  auto rd_data = execute_alu_op(instr_, rs1_value_, csr_data);
   if (rd_data != csr_data) {
-    core_->set_csr(instr_->getImm(), rd_data);
+    core_->set_csr(instr_.getImm(), rd_data, instr_.getId());
   }
   result_ = csr_data;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MUL::execute() {
+  issued_ = false;
+  if (ops_.empty())
+    return;
+
+  ++perf_stats_.busy_cycles;
+  perf_stats_.stage_cycles += ops_.size();
+
+  // advance every operation in flight, completed ones wait for the CDB
+  for (auto& op : ops_) {
+    if (op.cycles < this->latency() && ++op.cycles == this->latency()) {
+      op.result = execute_alu_op(op.instr, op.rs1_value, op.rs2_value);
+    }
+  }
+}
+
+bool MUL::busy() const {
+  return issued_ || ops_.size() >= this->latency();
+}
+
+bool MUL::done() const {
+  return !ops_.empty() && ops_.front().cycles == this->latency();
+}
+
+FunctionalUnit::data_out_t MUL::get_output() const {
+  auto& op = ops_.front();
+  return {op.rob_index, op.rs_index, op.result};
+}
+
+void MUL::issue(const Instr& instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
+  assert(!this->busy());
+  ops_.push_back({instr, rob_index, rs_index, rs1_value, rs2_value, 0, 0});
+  issued_ = true;
+  ++perf_stats_.ops;
+}
+
+void MUL::clear() {
+  assert(this->done());
+  ops_.pop_front();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t DIV::op_latency() const {
+  uint32_t dividend = rs1_value_;
+  uint32_t divisor = rs2_value_;
+  // division by zero and signed overflow are resolved in a single cycle
+  if (divisor == 0)
+    return 1;
+  auto alu_op = instr_.getAluOp();
+  if (alu_op == AluOp::DIV || alu_op == AluOp::REM) {
+    if (dividend == 0x80000000 && divisor == 0xffffffff)
+      return 1;
+    dividend = ((int32_t)dividend < 0) ? -dividend : dividend;
+    divisor = ((int32_t)divisor < 0) ? -divisor : divisor;
+  }
+  if (dividend < divisor)
+    return 1;
+  // one cycle per quotient bit, plus one to normalize the operands
+  uint32_t quotient_bits = log2floor(dividend) - log2floor(divisor) + 1;
+  return std::min<uint32_t>(quotient_bits + 1, this->latency());
+}
+
+bool DIV::do_complete(uint32_t cycles) {
+  if (cycles == 1) {
+    op_latency_ = this->op_latency();
+    if (op_latency_ < this->latency()) {
+      ++perf_stats_.early_outs;
+    }
+    ++perf_stats_.ops;
+  }
+  ++perf_stats_.busy_cycles;
+  return (cycles == op_latency_);
+}
+
+void DIV::do_execute() {
+  result_ = execute_alu_op(instr_, rs1_value_, rs2_value_);
+}
@@ -13,12 +13,23 @@
 
 #pragma once
 
+#include <deque>
 #include "instr.h"
 
 namespace tinyrv {
 
 class Core;
 
+// ALU operation of a decoded instruction, dispatched to its execute kernel
+uint32_t execute_alu_op(const StaticInstr &instr, uint32_t rs1_data, uint32_t rs2_data);
+
+inline uint32_t execute_alu_op(const Instr &instr, uint32_t rs1_data, uint32_t rs2_data) {
+  return execute_alu_op(instr.getStatic(), rs1_data, rs2_data);
+}
+
+// branch condition
+bool execute_br_op(BrOp br_op, uint32_t rs1_data, uint32_t rs2_data);
+
 class FunctionalUnit {
 public:
   typedef std::shared_ptr<FunctionalUnit> Ptr;
@@ -38,29 +49,29 @@ public:
 
   virtual ~FunctionalUnit() {}
 
-  void execute() {
+  virtual void execute() {
     if (!busy_ || done_)
       return;
 
-    if (++cycles_ == latency_) {
+    if (this->do_complete(++cycles_)) {
       this->do_execute();
       done_ = true;
     }
   }
 
-  bool busy() const {
+  virtual bool busy() const {
     return busy_;
   }
 
-  bool done() const {
+  virtual bool done() const {
     return done_;
   }
 
-  data_out_t get_output() const {
+  virtual data_out_t get_output() const {
     return {rob_index_, rs_index_, result_};
   }
 
-  void issue(Instr::Ptr instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
+  virtual void issue(const Instr& instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) {
     instr_     = instr;
     rob_index_ = rob_index;
     rs_index_  = rs_index;
@@ -71,7 +82,7 @@ public:
     cycles_    = 0;
   }
 
-  void clear() {
+  virtual void clear() {
     busy_ = false;
     done_ = false;
   }
@@ -80,7 +91,16 @@ protected:
 
   virtual void do_execute() = 0;
 
-  Instr::Ptr instr_;
+  // check whether the instruction in flight has completed
+  virtual bool do_complete(uint32_t cycles) {
+    return (cycles == latency_);
+  }
+
+  uint32_t latency() const {
+    return latency_;
+  }
+
+  Instr     instr_;
   uint32_t  rs1_value_;
   uint32_t  rs2_value_;
   uint32_t  result_;
@@ -100,8 +120,8 @@ private:
 
 class ALU : public FunctionalUnit {
 public:
-  ALU(Core* core)
-    : FunctionalUnit(ALU_LATENCY)
+  ALU(Core* core, uint32_t latency)
+    : FunctionalUnit(latency)
     , core_(core)
   {}
 
@@ -115,8 +135,8 @@ private:
 
 class BRU : public FunctionalUnit {
 public:
-  BRU(Core* core)
-    : FunctionalUnit(BRU_LATENCY)
+  BRU(Core* core, uint32_t latency)
+    : FunctionalUnit(latency)
     , core_(core)
   {}
 
@@ -128,25 +148,35 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Load/store unit.
+// Memory requests are sent to the DRAM controller and the unit completes
+// when the response returns; IO accesses complete after a fixed latency.
 class LSU : public FunctionalUnit {
 public:
-  LSU(Core* core)
-    : FunctionalUnit(LSU_LATENCY)
-    , core_(core)
-  {}
+  SimPort<MemReq> MemReqPort;
+  SimPort<MemRsp> MemRspPort;
+
+  LSU(Core* core, uint32_t latency);
 
   void do_execute();
 
+  void clear() override;
+
+protected:
+
+  bool do_complete(uint32_t cycles) override;
+
 private:
   Core* core_;
+  bool  mem_pending_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
 class SFU : public FunctionalUnit {
 public:
-  SFU(Core* core)
-    : FunctionalUnit(SFU_LATENCY)
+  SFU(Core* core, uint32_t latency)
+    : FunctionalUnit(latency)
     , core_(core)
   {}
 
@@ -156,4 +186,110 @@ private:
   Core* core_;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+
+// Pipelined multiplier.
+// Accepts one new operation per cycle and holds one operation in flight
+// per cycle of latency, results leave in issue order.
+class MUL : public FunctionalUnit {
+public:
+  struct PerfStats {
+    uint64_t ops;
+    uint64_t busy_cycles;   // cycles with at least one operation in flight
+    uint64_t stage_cycles;  // sum over all pipeline stages of occupied cycles
+
+    PerfStats()
+      : ops(0)
+      , busy_cycles(0)
+      , stage_cycles(0)
+    {}
+  };
+
+  MUL(Core* core, uint32_t latency)
+    : FunctionalUnit(latency)
+    , core_(core)
+    , issued_(false)
+  {}
+
+  void execute() override;
+
+  bool busy() const override;
+
+  bool done() const override;
+
+  data_out_t get_output() const override;
+
+  void issue(const Instr& instr, int rob_index, int rs_index, uint32_t rs1_value, uint32_t rs2_value) override;
+
+  void clear() override;
+
+  void do_execute() {}
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  struct op_t {
+    Instr      instr;
+    int        rob_index;
+    int        rs_index;
+    uint32_t   rs1_value;
+    uint32_t   rs2_value;
+    uint32_t   result;
+    uint32_t   cycles;
+  };
+
+  Core* core_;
+  std::deque<op_t> ops_;
+  bool  issued_;
+  PerfStats perf_stats_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Iterative divider.
+// Handles one operation at a time and produces one quotient bit per cycle,
+// operations whose quotient needs fewer bits retire early.
+class DIV : public FunctionalUnit {
+public:
+  struct PerfStats {
+    uint64_t ops;
+    uint64_t busy_cycles;
+    uint64_t early_outs;
+
+    PerfStats()
+      : ops(0)
+      , busy_cycles(0)
+      , early_outs(0)
+    {}
+  };
+
+  DIV(Core* core, uint32_t latency)
+    : FunctionalUnit(latency)
+    , core_(core)
+    , op_latency_(latency)
+  {}
+
+  void do_execute();
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+protected:
+
+  bool do_complete(uint32_t cycles) override;
+
+private:
+
+  // cycles taken by the operation in flight
+  uint32_t op_latency() const;
+
+  Core*     core_;
+  uint32_t  op_latency_;
+  PerfStats perf_stats_;
+};
+
 }
\ No newline at end of file
@@ -36,7 +36,7 @@ ReorderBuffer::~ReorderBuffer() {
   //--
 }
 
-int ReorderBuffer::allocate(Instr::Ptr instr) {
+int ReorderBuffer::allocate(const Instr& instr) {
   assert(!this->full());
   int index = tail_index_;
   store_[index] = {true, false, 0, instr};
@@ -55,10 +55,10 @@ void ReorderBuffer::update(const CommonDataBus::data_t& data) {
   entry.result = data.result;
   entry.ready = true;
 
-  if (entry.instr->getExeFlags().use_rd) {
-    DT(2, "Writeback: value=0x" << std::hex << data.result << std::dec << ", " << *entry.instr);
+  if (entry.instr.getExeFlags().use_rd) {
+    DT(2, "Writeback: value=0x" << std::hex << data.result << std::dec << ", " << entry.instr);
   } else {
-    DT(2, "Writeback: " << *entry.instr);
+    DT(2, "Writeback: " << entry.instr);
   }
 }
 
@@ -77,7 +77,7 @@ void ReorderBuffer::dump() {
   for (int i = 0; i < (int)store_.size(); ++i) {
     auto& entry = store_[i];
     if (entry.valid) {
-      DT(4, "ROB[" << i << "] ready=" << entry.ready << ", head=" << (i == head_index_) << " (#" << entry.instr->getId() << ")");
+      DT(4, "ROB[" << i << "] ready=" << entry.ready << ", head=" << (i == head_index_) << " (#" << entry.instr.getId() << ")");
     }
   }
 }
@@ -26,7 +26,7 @@ public:
     bool       valid;   // valid entry
     bool       ready;   // completed
     uint32_t   result;  // result data
-    Instr::Ptr instr;   // instruction data
+    Instr      instr;   // instruction data, by value for the per-cycle scans
   };
 
   ReorderBuffer( uint32_t size);
@@ -41,7 +41,7 @@ public:
     return count_ == 0;
   }
 
-  int allocate(Instr::Ptr instr);
+  int allocate(const Instr& instr);
 
   int pop();
 
@@ -32,11 +32,11 @@ ReservationStation::ReservationStation(uint32_t size)
 
 ReservationStation::~ReservationStation() {}
 
-int ReservationStation::issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, Instr::Ptr instr) {
+int ReservationStation::issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, const Instr& instr) {
     assert(!this->full());
     int index = indices_[next_index_++];
     uint32_t barrier_id = 0;
-    if (instr->getFUType() == FUType::LSU) {
+    if (instr.getFUType() == FUType::LSU) {
       barrier_id = lsu_barrier_.tick();
     }
     store_[index] = {true, false, rob_index, rs1_index, rs2_index, rs1_data, rs2_data, barrier_id, instr};
@@ -50,7 +50,7 @@ int ReservationStation::issue(int rob_index, int rs1_index, int rs2_index, uint3
     auto& entry = store_.at(index);
     entry.valid = false;
     entry.running = false;
-    if (entry.instr->getFUType() == FUType::LSU) {
+    if (entry.instr.getFUType() == FUType::LSU) {
       lsu_barrier_.tock();
     }
     indices_[--next_index_] = index;
@@ -58,7 +58,7 @@ int ReservationStation::issue(int rob_index, int rs1_index, int rs2_index, uint3
 
   bool ReservationStation::locked(uint32_t index) const {
     auto& entry = store_.at(index);
-    if (!entry.valid || entry.instr->getFUType() != FUType::LSU)
+    if (!entry.valid || entry.instr.getFUType() != FUType::LSU)
       return false;
     return !lsu_barrier_.ready(entry.barrier_id);
   }
@@ -30,7 +30,7 @@ public:
     uint32_t rs1_data; // rs1 data
     uint32_t rs2_data; // rs2 data
     uint32_t barrier_id; // barrier id to enforce ordering fo LSU instructions
-    Instr::Ptr instr; // instruction data
+    Instr instr;      // instruction data, by value for the per-cycle scans
 
     bool operands_ready() const {
       return rs1_index == -1 && rs2_index == -1;
@@ -72,7 +72,7 @@ public:
     return store_.at(index);
   }
 
-  int issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, Instr::Ptr instr);
+  int issue(int rob_index, int rs1_index, int rs2_index, uint32_t rs1_data, uint32_t rs2_data, const Instr& instr);
 
   void release(uint32_t index);
 
@@ -94,7 +94,7 @@ public:
     for (uint32_t i = 0; i < store_.size(); ++i) {
       auto& entry = store_[i];
       if (entry.valid) {
-        DT(4, "RS[" << i << "] rob=" << entry.rob_index << ", running=" << entry.running << ", rs1=" << entry.rs1_index << ", rs2=" << entry.rs2_index << " (#" << entry.instr->getId() << ")");
+        DT(4, "RS[" << i << "] rob=" << entry.rob_index << ", running=" << entry.running << ", rs1=" << entry.rs1_index << ", rs2=" << entry.rs2_index << " (#" << entry.instr.getId() << ")");
       }
     }
   }
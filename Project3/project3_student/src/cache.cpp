@@ -0,0 +1,272 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "cache.h"
+
+using namespace tinyrv;
+
+CacheArray::CacheArray(const Config& config)
+  : config_(config)
+  , num_sets_(config.size / (config.block_size * config.ways))
+  , block_shift_(log2ceil(config.block_size))
+  , lines_(num_sets_ * config.ways)
+  , repl_(ReplacementPolicy::Create(config.repl, num_sets_, config.ways)) {
+  assert(ispow2(config.block_size));
+  assert(num_sets_ != 0 && ispow2(num_sets_));
+  this->reset();
+}
+
+CacheArray::~CacheArray() {
+  //--
+}
+
+void CacheArray::reset() {
+  for (auto& line : lines_) {
+    line = {0, false, false};
+  }
+  repl_->reset();
+}
+
+int CacheArray::find(uint32_t set, uint64_t tag) const {
+  auto lines = &lines_[set * config_.ways];
+  for (uint32_t w = 0; w < config_.ways; ++w) {
+    if (lines[w].valid && lines[w].tag == tag)
+      return w;
+  }
+  return -1;
+}
+
+bool CacheArray::lookup(uint64_t addr, bool write) {
+  uint64_t tag = addr >> block_shift_;
+  uint32_t set = tag & (num_sets_ - 1);
+  int way = this->find(set, tag);
+  if (way < 0)
+    return false;
+  auto& line = lines_[set * config_.ways + way];
+  line.dirty |= write;
+  repl_->touch(set, way);
+  return true;
+}
+
+CacheArray::evict_t CacheArray::fill(uint64_t addr, bool dirty) {
+  uint64_t tag = addr >> block_shift_;
+  uint32_t set = tag & (num_sets_ - 1);
+  auto lines = &lines_[set * config_.ways];
+
+  // use a free way first, otherwise ask the replacement policy
+  int way = -1;
+  for (uint32_t w = 0; w < config_.ways; ++w) {
+    if (!lines[w].valid) {
+      way = w;
+      break;
+    }
+  }
+  if (way < 0) {
+    way = repl_->victim(set);
+  }
+
+  auto& line = lines[way];
+  evict_t evicted{line.valid, line.valid && line.dirty, line.tag << block_shift_};
+  line = {tag, true, dirty};
+  repl_->insert(set, way);
+  return evicted;
+}
+
+bool CacheArray::invalidate(uint64_t addr, bool* dirty) {
+  uint64_t tag = addr >> block_shift_;
+  uint32_t set = tag & (num_sets_ - 1);
+  int way = this->find(set, tag);
+  if (way < 0)
+    return false;
+  auto& line = lines_[set * config_.ways + way];
+  *dirty = line.dirty;
+  line.valid = false;
+  line.dirty = false;
+  return true;
+}
+
+void CacheArray::save_state(StateWriter& writer, const std::string& prefix) const {
+  uint32_t config[4] = {config_.size, config_.block_size, config_.ways, uint32_t(config_.repl)};
+  writer.write(prefix + ".config", config, sizeof(config));
+  writer.write(prefix + ".lines", lines_);
+  repl_->save_state(writer, prefix + ".repl");
+}
+
+bool CacheArray::load_state(const StateReader& reader, const std::string& prefix) {
+  uint32_t config[4];
+  if (!reader.read(prefix + ".config", config, sizeof(config)))
+    return false;
+  if (config[0] != config_.size
+   || config[1] != config_.block_size
+   || config[2] != config_.ways
+   || config[3] != uint32_t(config_.repl)) {
+    std::cout << "*** error: " << prefix << " was saved with size=" << config[0]
+              << ", block_size=" << config[1] << ", ways=" << config[2]
+              << ", repl=" << ReplPolicy(config[3]) << std::endl;
+    return false;
+  }
+  return reader.read(prefix + ".lines", &lines_)
+      && repl_->load_state(reader, prefix + ".repl");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Cache::Cache(const SimContext& ctx, const char* name, const Config& config)
+  : SimObject(ctx, name)
+  , CoreReqPort(this)
+  , CoreRspPort(this)
+  , MemReqPort(this)
+  , MemRspPort(this)
+  , config_(config)
+  , tags_(config.array) {
+  if (config.victim_entries != 0) {
+    // fully-associative: a single set holding all entries
+    victims_ = std::make_shared<CacheArray>(CacheArray::Config{
+      config.victim_entries * config.array.block_size,
+      config.array.block_size,
+      config.victim_entries,
+      ReplPolicy::LRU
+    });
+  }
+  this->reset();
+}
+
+Cache::~Cache() {
+  //--
+}
+
+void Cache::reset() {
+  tags_.reset();
+  if (victims_) {
+    victims_->reset();
+  }
+  while (!CoreReqPort.empty()) {
+    CoreReqPort.pop();
+  }
+  while (!MemRspPort.empty()) {
+    MemRspPort.pop();
+  }
+  pending_ = false;
+  mem_tag_ = 0;
+  perf_stats_ = PerfStats();
+}
+
+void Cache::tick() {
+  // process memory responses
+  while (!MemRspPort.empty()) {
+    auto& mem_rsp = MemRspPort.front();
+    if (pending_ && mem_rsp.tag == mem_tag_) {
+      // fill the missing block and release the requester
+      auto evicted = tags_.fill(pending_req_.addr, pending_req_.write);
+      this->evict(evicted);
+      DT(3, this->name() << "-fill: " << pending_req_);
+      CoreRspPort.send(MemRsp{pending_req_.tag}, 1);
+      pending_ = false;
+    }
+    // writeback acknowledgements need no action
+    MemRspPort.pop();
+  }
+
+  // process a core request, the cache blocks while a miss is pending
+  if (pending_ || CoreReqPort.empty())
+    return;
+
+  auto& core_req = CoreReqPort.front();
+  if (core_req.write) {
+    ++perf_stats_.writes;
+  } else {
+    ++perf_stats_.reads;
+  }
+
+  if (tags_.lookup(core_req.addr, core_req.write)) {
+    DT(3, this->name() << "-hit: " << core_req);
+    CoreRspPort.send(MemRsp{core_req.tag}, config_.latency);
+  } else {
+    if (core_req.write) {
+      ++perf_stats_.write_misses;
+    } else {
+      ++perf_stats_.read_misses;
+    }
+    bool dirty = false;
+    if (victims_ && victims_->invalidate(core_req.addr, &dirty)) {
+      // swap the block back from the victim cache
+      ++perf_stats_.victim_hits;
+      auto evicted = tags_.fill(core_req.addr, dirty || core_req.write);
+      this->evict(evicted);
+      DT(3, this->name() << "-victim-hit: " << core_req);
+      CoreRspPort.send(MemRsp{core_req.tag}, config_.latency + 1);
+    } else {
+      // fetch the block from the next level
+      DT(3, this->name() << "-miss: " << core_req);
+      pending_ = true;
+      pending_req_ = core_req;
+      MemReqPort.send(MemReq{tags_.block_addr(core_req.addr), false, ++mem_tag_}, config_.latency);
+    }
+  }
+  CoreReqPort.pop();
+}
+
+void Cache::warm(uint64_t addr, bool write) {
+  if (tags_.lookup(addr, write))
+    return;
+  bool dirty = false;
+  if (victims_ && victims_->invalidate(addr, &dirty)) {
+    write |= dirty;
+  }
+  // writebacks take no time while warming, only the victim cache keeps them
+  auto evicted = tags_.fill(addr, write);
+  if (victims_ && evicted.valid) {
+    victims_->fill(evicted.addr, evicted.dirty);
+  }
+}
+
+void Cache::save_state(StateWriter& writer) const {
+  tags_.save_state(writer, this->name());
+  if (victims_) {
+    victims_->save_state(writer, this->name() + ".victims");
+  }
+}
+
+bool Cache::load_state(const StateReader& reader) {
+  if (!tags_.load_state(reader, this->name()))
+    return false;
+  if (victims_) {
+    return victims_->load_state(reader, this->name() + ".victims");
+  }
+  return true;
+}
+
+void Cache::evict(const CacheArray::evict_t& block) {
+  if (!block.valid)
+    return;
+  ++perf_stats_.evictions;
+  if (victims_) {
+    auto evicted = victims_->fill(block.addr, block.dirty);
+    if (evicted.dirty) {
+      this->writeback(evicted.addr);
+    }
+  } else if (block.dirty) {
+    this->writeback(block.addr);
+  }
+}
+
+void Cache::writeback(uint64_t addr) {
+  ++perf_stats_.writebacks;
+  DT(3, this->name() << "-writeback: addr=0x" << std::hex << addr << std::dec);
+  MemReqPort.send(MemReq{addr, true, 0}, 1);
+}
@@ -0,0 +1,157 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <simobject.h>
+#include "types.h"
+#include "replacement.h"
+
+namespace tinyrv {
+
+// Set-associative tag array.
+// Only tags and state bits are modeled, the data stays in RAM.
+class CacheArray {
+public:
+  struct Config {
+    uint32_t   size;        // capacity (bytes)
+    uint32_t   block_size;  // block size (bytes)
+    uint32_t   ways;        // associativity
+    ReplPolicy repl;        // replacement policy
+  };
+
+  struct evict_t {
+    bool     valid;   // a block was evicted
+    bool     dirty;   // the evicted block needs a writeback
+    uint64_t addr;    // evicted block address
+  };
+
+  CacheArray(const Config& config);
+
+  ~CacheArray();
+
+  void reset();
+
+  // lookup a block and update its replacement state on hit
+  bool lookup(uint64_t addr, bool write);
+
+  // install a block, returns the block it replaced
+  evict_t fill(uint64_t addr, bool dirty);
+
+  // remove a block if present
+  bool invalidate(uint64_t addr, bool* dirty);
+
+  // warm-start: tags and replacement state under the given section prefix,
+  // loading fails if the saved geometry or policy differs
+  void save_state(StateWriter& writer, const std::string& prefix) const;
+  bool load_state(const StateReader& reader, const std::string& prefix);
+
+  const Config& config() const {
+    return config_;
+  }
+
+  uint64_t block_addr(uint64_t addr) const {
+    return (addr >> block_shift_) << block_shift_;
+  }
+
+private:
+
+  struct line_t {
+    uint64_t tag;
+    bool     valid;
+    bool     dirty;
+  };
+
+  int find(uint32_t set, uint64_t tag) const;
+
+  Config config_;
+  uint32_t num_sets_;
+  uint32_t block_shift_;
+  std::vector<line_t> lines_;
+  ReplacementPolicy::Ptr repl_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Blocking write-back, write-allocate cache with an optional
+// fully-associative victim cache between it and the next level.
+class Cache : public SimObject<Cache> {
+public:
+  struct Config {
+    CacheArray::Config array;   // tag array geometry
+    uint32_t latency;           // tag lookup latency
+    uint32_t victim_entries;    // victim cache entries (0 = disabled)
+  };
+
+  struct PerfStats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_misses;
+    uint64_t write_misses;
+    uint64_t victim_hits;
+    uint64_t evictions;
+    uint64_t writebacks;
+
+    PerfStats()
+      : reads(0)
+      , writes(0)
+      , read_misses(0)
+      , write_misses(0)
+      , victim_hits(0)
+      , evictions(0)
+      , writebacks(0)
+    {}
+  };
+
+  SimPort<MemReq> CoreReqPort;
+  SimPort<MemRsp> CoreRspPort;
+
+  SimPort<MemReq> MemReqPort;
+  SimPort<MemRsp> MemRspPort;
+
+  Cache(const SimContext& ctx, const char* name, const Config& config);
+
+  ~Cache();
+
+  void reset();
+
+  void tick();
+
+  // functional warming: update the tags as the access would, without
+  // timing it or counting it in the stats
+  void warm(uint64_t addr, bool write);
+
+  void save_state(StateWriter& writer) const;
+  bool load_state(const StateReader& reader);
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  void evict(const CacheArray::evict_t& block);
+
+  void writeback(uint64_t addr);
+
+  Config config_;
+  CacheArray tags_;
+  std::shared_ptr<CacheArray> victims_;
+  bool     pending_;
+  MemReq   pending_req_;
+  uint32_t mem_tag_;
+  PerfStats perf_stats_;
+};
+
+}
@@ -0,0 +1,172 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+#include <util.h>
+#include "checker.h"
+#include "FU.h"
+#include "config.h"
+
+using namespace tinyrv;
+
+Checker::Checker(RAM* ram)
+  : ram_(ram)
+  , reg_file_(NUM_REGS, 0)
+  , PC_(STARTUP_ADDR)
+  , steps_(0)
+{}
+
+void Checker::sync(uint64_t instrs, Word PC, const std::vector<Word>& reg_file) {
+  assert(instrs >= steps_);
+  while (steps_ < instrs) {
+    step_t result;
+    this->step(&result);
+  }
+  // the registers may differ on CSR counter reads only
+  if (PC_ != PC) {
+    std::cout << std::hex << "*** COSIM: functional handoff at PC=0x" << PC
+              << ", expected PC=0x" << PC_ << std::dec << " after " << instrs << " instructions" << std::endl;
+    std::abort();
+  }
+  std::copy(reg_file.begin(), reg_file.begin() + NUM_REGS, reg_file_.begin());
+}
+
+void Checker::store(uint64_t uuid, uint64_t addr, uint32_t size, const void* data) {
+  uint32_t value = 0;
+  memcpy(&value, data, size);
+  stores_.push_back({uuid, {addr, size, value}});
+}
+
+void Checker::commit(const Instr& instr, const std::vector<Word>& reg_file, uint64_t cycle) {
+  if (instr.getPC() != PC_) {
+    this->diverge(instr, cycle, "PC", PC_, instr.getPC());
+  }
+
+  // the LSU may perform stores out of program order,
+  // so they are matched by instruction id rather than by arrival
+  auto uuid = instr.getId();
+  auto match = [uuid](const store_t& store) { return store.uuid == uuid; };
+
+  // a fused operation retires both of its instructions
+  step_t results[2];
+  uint32_t count = instr.getCount();
+  for (uint32_t i = 0; i < count; ++i) {
+    auto& result = results[i];
+    this->step(&result);
+    if (result.is_csr && result.rd != 0) {
+      reg_file_[result.rd] = reg_file[result.rd];
+    }
+    if (result.is_store) {
+      auto it = std::find_if(stores_.begin(), stores_.end(), match);
+      if (it == stores_.end()) {
+        this->diverge(instr, cycle, "missing store to", result.store.addr, 0);
+      }
+      auto& store = it->write;
+      if (store.addr != result.store.addr) {
+        this->diverge(instr, cycle, "store address", result.store.addr, store.addr);
+      }
+      if (store.size != result.store.size) {
+        this->diverge(instr, cycle, "store size", result.store.size, store.size);
+      }
+      if (store.data != result.store.data) {
+        this->diverge(instr, cycle, "store data", result.store.data, store.data);
+      }
+      stores_.erase(it);
+      ++perf_stats_.stores;
+    }
+  }
+  auto extra = std::find_if(stores_.begin(), stores_.end(), match);
+  if (extra != stores_.end()) {
+    this->diverge(instr, cycle, "unexpected store to", 0, extra->write.addr);
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    auto rd = results[i].rd;
+    if (rd != 0 && reg_file.at(rd) != reg_file_[rd]) {
+      this->diverge(instr, cycle, "rd value", reg_file_[rd], reg_file.at(rd));
+    }
+  }
+  perf_stats_.instrs += count;
+}
+
+void Checker::step(step_t* result) {
+  // 16-bit instructions only use the low half
+  uint32_t instr_code = 0;
+  ram_->read(&instr_code, PC_, sizeof(instr_code));
+  StaticInstr instr;
+  if (!decode_instr(instr_code, PC_, &instr)) {
+    std::cout << std::hex << "*** COSIM: invalid instruction: 0x" << instr_code << ", PC=0x" << PC_ << std::dec << std::endl;
+    std::abort();
+  }
+
+  auto exe_flags = instr.getExeFlags();
+  auto br_op = instr.getBrOp();
+  Word rs1_data = exe_flags.use_rs1 ? reg_file_[instr.getRs1()] : 0;
+  Word rs2_data = exe_flags.use_rs2 ? reg_file_[instr.getRs2()] : 0;
+  Word next_PC = PC_ + instr.getSize();
+  Word rd_data = 0;
+
+  result->PC = PC_;
+  result->rd = exe_flags.use_rd ? instr.getRd() : 0;
+  result->is_csr = exe_flags.is_csr;
+  result->is_store = false;
+
+  if (exe_flags.is_load) {
+    uint64_t addr = execute_alu_op(instr, rs1_data, rs2_data);
+    uint32_t func3 = instr.getFunc3();
+    uint32_t data_bytes = 1 << (func3 & 0x3);
+    uint32_t data = 0;
+    ram_->read(&data, addr, data_bytes);
+    rd_data = (func3 & 0x4) ? data : sext(data, 8 * data_bytes);
+  } else if (exe_flags.is_store) {
+    uint64_t addr = execute_alu_op(instr, rs1_data, rs2_data);
+    uint32_t data_bytes = 1 << (instr.getFunc3() & 0x3);
+    uint32_t data = rs2_data;
+    if (data_bytes < 4) {
+      data &= (1u << (8 * data_bytes)) - 1;
+    }
+    if (!(addr >= uint64_t(IO_COUT_ADDR)
+       && addr < (uint64_t(IO_COUT_ADDR) + IO_COUT_SIZE))) {
+      ram_->write(&data, addr, data_bytes);
+    }
+    result->is_store = true;
+    result->store = {addr, data_bytes, data};
+  } else if (br_op != BrOp::NONE) {
+    if (execute_br_op(br_op, rs1_data, rs2_data)) {
+      next_PC = execute_alu_op(instr, rs1_data, rs2_data);
+      if (br_op == BrOp::JALR) {
+        next_PC &= ~Word(1);
+      }
+    }
+    rd_data = PC_ + instr.getSize();
+  } else if (!exe_flags.is_csr) {
+    rd_data = execute_alu_op(instr, rs1_data, rs2_data);
+  }
+
+  if (result->rd != 0) {
+    reg_file_[result->rd] = rd_data;
+  }
+  PC_ = next_PC;
+  ++steps_;
+}
+
+void Checker::diverge(const Instr& instr, uint64_t cycle, const char* what, uint64_t expected, uint64_t actual) const {
+  std::cout << "*** COSIM: divergence after " << perf_stats_.instrs << " instructions, cycle=" << cycle << std::endl;
+  std::cout << "*** COSIM: " << instr << std::endl;
+  std::cout << std::hex << "*** COSIM: " << what << " expected=0x" << expected << ", actual=0x" << actual << std::dec << std::endl;
+  std::abort();
+}
@@ -0,0 +1,97 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mem.h>
+#include "types.h"
+#include "instr.h"
+
+namespace tinyrv {
+
+// Lockstep co-simulation checker.
+// A golden functional model with its own registers, PC and memory image
+// steps once per instruction committed by the core and compares the
+// committed PC, the destination register values and the stores the core
+// performed for it. CSR reads take the core's value, the counters depend on
+// timing. The first divergence stops the simulation with a report.
+class Checker {
+public:
+  struct PerfStats {
+    uint64_t instrs;  // instructions checked
+    uint64_t stores;
+
+    PerfStats()
+      : instrs(0)
+      , stores(0)
+    {}
+  };
+
+  // ram holds a private copy of the program image
+  Checker(RAM* ram);
+
+  // catch up with the functional simulator handing off after instrs
+  // instructions, then take its registers
+  void sync(uint64_t instrs, Word PC, const std::vector<Word>& reg_file);
+
+  // a store performed by the core for instruction uuid,
+  // checked when that instruction commits
+  void store(uint64_t uuid, uint64_t addr, uint32_t size, const void* data);
+
+  // step over the committed instruction and compare against the core's
+  // register file
+  void commit(const Instr& instr, const std::vector<Word>& reg_file, uint64_t cycle);
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  struct mem_write_t {
+    uint64_t addr;
+    uint32_t size;
+    uint32_t data;
+  };
+
+  // a store performed by the core
+  struct store_t {
+    uint64_t    uuid;
+    mem_write_t write;
+  };
+
+  // architectural effects of one instruction
+  struct step_t {
+    Word     PC;
+    uint32_t rd;      // 0 if none
+    bool     is_csr;
+    bool     is_store;
+    mem_write_t store;
+  };
+
+  // execute the instruction at PC_
+  void step(step_t* result);
+
+  void diverge(const Instr& instr, uint64_t cycle, const char* what, uint64_t expected, uint64_t actual) const;
+
+  RAM* ram_;
+  std::vector<Word> reg_file_;
+  Word PC_;
+  uint64_t steps_;
+  std::deque<store_t> stores_;  // performed by the core, in LSU order, not yet committed
+  PerfStats perf_stats_;
+};
+
+}
@@ -15,18 +15,49 @@
 
 #define XLEN 32
 
-#define NUM_FUS 4
+// functional units, one per FUType
+#define NUM_FUS 6
 
+// The latencies and sizes below, and the fusion, data cache and DRAM
+// settings further down, are the defaults of the runtime core parameters
+// (core_config.h); -C <file> and -D <name>=<value> override them per run.
+
+#ifndef ALU_LATENCY
 #define ALU_LATENCY 2
+#endif
+
+#ifndef BRU_LATENCY
 #define BRU_LATENCY 2
+#endif
+
+// IO accesses, memory accesses go through the data cache
+#ifndef LSU_LATENCY
 #define LSU_LATENCY 50
+#endif
+
+#ifndef SFU_LATENCY
 #define SFU_LATENCY 3
+#endif
+
+// pipelined multiplier latency in cycles
+#ifndef MUL_LATENCY
+#define MUL_LATENCY 3
+#endif
+
+// iterative divider worst-case latency in cycles
+#ifndef DIV_LATENCY
+#define DIV_LATENCY 32
+#endif
 
 #define CDB_LATENCY 2
 
+#ifndef NUM_RSS
 #define NUM_RSS 8
+#endif
 
+#ifndef ROB_SIZE
 #define ROB_SIZE 16
+#endif
 
 #define NUM_REGS 32
 
@@ -34,6 +65,57 @@
 #define DEBUG_LEVEL 3
 #endif
 
+// functional emulator dispatch, computed goto when the compiler supports it
+// (0 selects the portable switch loop)
+#ifndef EMU_THREADED
+#if defined(__GNUC__)
+#define EMU_THREADED 1
+#else
+#define EMU_THREADED 0
+#endif
+#endif
+
+// sampled simulation (-S): default functional warming and measured window
+// lengths, and the instructions run in detail before each window to refill
+// the pipeline
+#ifndef SAMPLE_WARMUP
+#define SAMPLE_WARMUP 20000
+#endif
+
+#ifndef SAMPLE_WINDOW
+#define SAMPLE_WINDOW 1000
+#endif
+
+#ifndef SAMPLE_DETAIL_WARMUP
+#define SAMPLE_DETAIL_WARMUP 100
+#endif
+
+// largest number of clusters tried when picking simulation points
+#ifndef SIMPOINT_MAX_K
+#define SIMPOINT_MAX_K 10
+#endif
+
+// executions after which an emulator block is extended along its biased
+// successor into a superblock (0 disables superblocks)
+#ifndef EMU_SUPERBLOCK_THRESHOLD
+#define EMU_SUPERBLOCK_THRESHOLD 64
+#endif
+
+// translate hot blocks of the functional emulator into x86-64 code
+// (0 keeps the interpreter only)
+#ifndef EMU_DBT
+#if defined(__x86_64__) && defined(__linux__)
+#define EMU_DBT 1
+#else
+#define EMU_DBT 0
+#endif
+#endif
+
+// times a block is reached before it is translated
+#ifndef DBT_HOT_THRESHOLD
+#define DBT_HOT_THRESHOLD 16
+#endif
+
 #ifndef RAM_PAGE_SIZE
 #define RAM_PAGE_SIZE 4096
 #endif
@@ -50,6 +132,76 @@
 #define MEM_BLOCK_SIZE 64
 #endif
 
+// decoded-instruction cache entries
+#ifndef DECODE_CACHE_SIZE
+#define DECODE_CACHE_SIZE 1024
+#endif
+
+// predecode the whole program image at load time
+#ifndef PREDECODE
+#define PREDECODE 1
+#endif
+
+// largest image span predecoded from the entry point (bytes),
+// code beyond it goes through the decode cache
+#ifndef PREDECODE_SIZE
+#define PREDECODE_SIZE (256 * 1024)
+#endif
+
+// macro-op fusion idioms
+#define FUSE_LUI_ADDI   (1 << 0)  // lui/auipc rd + addi rd, rd
+#define FUSE_AUIPC_JALR (1 << 1)  // auipc rd + jalr rd, rd
+#define FUSE_SLLI_ADD   (1 << 2)  // slli rd, 1..3 + add rd, rd
+#define FUSE_LOAD       (1 << 3)  // lui/auipc/addi/add rd + load rd, (rd)
+
+// idioms fused by the decoder (0 disables fusion)
+#ifndef FUSION
+#define FUSION (FUSE_LUI_ADDI | FUSE_AUIPC_JALR | FUSE_SLLI_ADD | FUSE_LOAD)
+#endif
+
+#ifndef DCACHE_SIZE
+#define DCACHE_SIZE 8192
+#endif
+
+#ifndef DCACHE_WAYS
+#define DCACHE_WAYS 4
+#endif
+
+#ifndef DCACHE_LATENCY
+#define DCACHE_LATENCY 2
+#endif
+
+// 0: LRU, 1: PLRU, 2: RANDOM, 3: SRRIP, 4: BRRIP
+#ifndef DCACHE_REPL
+#define DCACHE_REPL 0
+#endif
+
+// victim cache entries (0 disables the victim cache)
+#ifndef VCACHE_ENTRIES
+#define VCACHE_ENTRIES 0
+#endif
+
+#ifndef DRAM_ROW_SIZE
+#define DRAM_ROW_SIZE 2048
+#endif
+
+#ifndef DRAM_QUEUE_SIZE
+#define DRAM_QUEUE_SIZE 16
+#endif
+
+// DRAM command latencies in core cycles
+#ifndef DRAM_TCAS
+#define DRAM_TCAS 16
+#endif
+
+#ifndef DRAM_TRCD
+#define DRAM_TRCD 16
+#endif
+
+#ifndef DRAM_TRP
+#define DRAM_TRP 16
+#endif
+
 #ifndef MEM_ADDR_WIDTH
 #ifdef XLEN_64
 #define MEM_ADDR_WIDTH 48
@@ -109,3 +261,14 @@
 #define VX_CSR_MARCHID                  0xF12
 #define VX_CSR_MIMPID                   0xF13
 #define VX_CSR_MHARTID                  0xF14
+
+// Simulator control CSRs (custom read/write space) ///////////////////////////
+
+// writing 1 begins a region of interest: its stats start there and the
+// simulation switches to detailed timing
+#define VX_CSR_SIM_ROI_BEGIN            0x8C0
+// writing 1 ends it: its stats are recorded and the simulation switches to
+// functional fast-forward
+#define VX_CSR_SIM_ROI_END              0x8C1
+// 0: functional fast-forward, 1: detailed timing
+#define VX_CSR_SIM_MODE                 0x8C2
@@ -13,6 +13,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <string.h>
 #include <assert.h>
 #include <util.h>
@@ -20,28 +21,52 @@
 #include "core.h"
 #include "debug.h"
 #include "processor_impl.h"
+#include "checker.h"
 
 using namespace tinyrv;
 
-Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor)
+Core::Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const CoreConfig& config)
     : SimObject(ctx, "core")
     , core_id_(core_id)
     , processor_(processor)
+    , config_(config)
     , reg_file_(NUM_REGS)
+    , fetch_buf_(&mmu_)
+    , decode_cache_(DECODE_CACHE_SIZE, RAM_PAGE_SIZE)
     , decode_queue_(FiFoReg<id_data_t>::Create("idq"))
     , issue_queue_(FiFoReg<is_data_t>::Create("isq"))
     , fetch_stalled_(ValReg<bool>::Create("fetch_stalled", false))
-    , ROB_(/*TODO: untested*/ ROB_SIZE) // USED VALUES FROM config.h
+    , ROB_(/*TODO: untested*/ config.rob_size)
     , RAT_(/*TODO: untested*/ NUM_REGS)
-    , RS_(/*TODO: untested*/ NUM_RSS)
+    , RS_(/*TODO: untested*/ config.num_rss)
     , RST_(/*TODO: untested*/ NUM_REGS)
     , FUs_(/*TODO: untested*/ NUM_FUS)
+    , dcache_(Cache::Create("dcache", Cache::Config{
+        {config.dcache_size, MEM_BLOCK_SIZE, config.dcache_ways, ReplPolicy(config.dcache_repl)},
+        config.dcache_latency, config.vcache_entries}))
+    , dram_(DramController::Create("dram", DramController::Config{
+        config.memory_banks, MEM_BLOCK_SIZE, config.dram_row_size, config.dram_queue_size,
+        config.dram_tcas, config.dram_trcd, config.dram_trp}))
+    , trace_(nullptr)
+    , reuse_(nullptr)
+    , checker_(nullptr)
 {
   // create functional units
-  FUs_.at((int)FUType::ALU) = std::make_shared<ALU>(this);
-  FUs_.at((int)FUType::LSU) = std::make_shared<LSU>(this);
-  FUs_.at((int)FUType::BRU) = std::make_shared<BRU>(this);
-  FUs_.at((int)FUType::SFU) = std::make_shared<SFU>(this);
+  auto lsu = std::make_shared<LSU>(this, config.lsu_latency);
+  FUs_.at((int)FUType::ALU) = std::make_shared<ALU>(this, config.alu_latency);
+  FUs_.at((int)FUType::LSU) = lsu;
+  FUs_.at((int)FUType::BRU) = std::make_shared<BRU>(this, config.bru_latency);
+  FUs_.at((int)FUType::SFU) = std::make_shared<SFU>(this, config.sfu_latency);
+  FUs_.at((int)FUType::MUL) = std::make_shared<MUL>(this, config.mul_latency);
+  FUs_.at((int)FUType::DIV) = std::make_shared<DIV>(this, config.div_latency);
+
+  // connect the LSU to the data cache
+  lsu->MemReqPort.bind(&dcache_->CoreReqPort);
+  dcache_->CoreRspPort.bind(&lsu->MemRspPort);
+
+  // connect the data cache to the DRAM controller
+  dcache_->MemReqPort.bind(&dram_->MemReqPort);
+  dram_->MemRspPort.bind(&dcache_->MemRspPort);
 
   // initialize register file at x0
   reg_file_.at(0) = 0;
@@ -57,12 +82,18 @@ void Core::reset() {
 
   PC_ = STARTUP_ADDR;
 
+  fetch_buf_.reset();
+  decode_cache_.reset();
+  predecode_.reset_stats();
+
   uuid_ctr_ = 0;
 
   fetched_instrs_ = 0;
   perf_stats_ = PerfStats();
 
   fetch_stalled_->reset();
+  fuse_held_ = false;
+  draining_ = false;
   exited_ = false;
 }
 
@@ -79,23 +110,28 @@ void Core::tick() {
 }
 
 void Core::fetch() {
-  if (fetch_stalled_->read() || decode_queue_->full())
+  if (fetch_stalled_->read() || draining_ || decode_queue_->full())
     return;
 
+  // fetch next instruction through the alignment buffer
+  uint32_t instr_code = 0;
+  uint32_t instr_size = 0;
+  if (!fetch_buf_.fetch(PC_, &instr_code, &instr_size)) {
+    DT(3, "*** Fetch Stall: instruction straddles fetch blocks");
+    return;
+  }
+  this->trace_ref({MemRefType::FETCH, PC_, PC_, instr_size});
+
   // allocate a new uuid
   uint32_t uuid = uuid_ctr_++;
 
-  // fetch next instruction from memory at PC address
-  uint32_t instr_code = 0;
-  mmu_.read(&instr_code, PC_, sizeof(uint32_t), 0);
-
   DT(2, "Fetch: instr=0x" << instr_code << ", PC=0x" << std::hex << PC_ << std::dec << " (#" << uuid << ")");
 
   // move instruction data to next stage
   decode_queue_->push({instr_code, PC_, uuid});
 
   // advance program counter
-  PC_ += 4;
+  PC_ += instr_size;
 
   ++fetched_instrs_;
 
@@ -105,7 +141,18 @@ void Core::fetch() {
 }
 
 void Core::decode() {
-  if (decode_queue_->empty() || issue_queue_->full())
+  if (issue_queue_->full())
+    return;
+
+  // a drain fetches no partner for the held instruction, release it alone
+  if (draining_ && fuse_held_ && decode_queue_->empty()) {
+    DT(2, "Decode: " << fuse_slot_);
+    issue_queue_->push({fuse_slot_});
+    fuse_held_ = false;
+    return;
+  }
+
+  if (decode_queue_->empty())
     return;
 
   auto& id_data = decode_queue_->data();
@@ -113,12 +160,35 @@ void Core::decode() {
   // instruction decode
   auto instr = this->decode(id_data.instr_code, id_data.PC, id_data.uuid);
 
-  DT(2, "Decode: " << *instr);
+  // macro-op fusion
+  if (fuse_held_) {
+    Instr fused;
+    if (!this->fuse(fuse_slot_, instr, &fused)) {
+      // the pair was modified since it was peeked, release the held
+      // instruction alone and decode this one again next cycle
+      DT(2, "Decode: " << fuse_slot_);
+      issue_queue_->push({fuse_slot_});
+      fuse_held_ = false;
+      return;
+    }
+    fuse_held_ = false;
+    instr = fused;
+  } else if (this->fusible(instr)) {
+    // hold the instruction until the rest of the pair is fetched
+    DT(2, "Decode: " << instr << " (held for fusion)");
+    fuse_slot_ = instr;
+    fuse_held_ = true;
+    fetch_stalled_->write(false);
+    decode_queue_->pop();
+    return;
+  }
+
+  DT(2, "Decode: " << instr);
 
   // release fetch stage if not a branch
   // keep fetch stage locked if exiting program
-  if (instr->getBrOp() == BrOp::NONE
-   && !instr->getExeFlags().is_exit) {
+  if (instr.getBrOp() == BrOp::NONE
+   && !instr.getExeFlags().is_exit) {
     fetch_stalled_->write(false); // unlock fetch stage
   }
 
@@ -127,25 +197,98 @@ void Core::decode() {
   decode_queue_->pop();
 }
 
-void Core::dmem_read(void *data, uint64_t addr, uint32_t size) {
+const StaticInstr* Core::decode_static(uint32_t instr_code, uint32_t PC) {
+  // use the predecoded image first, then the decode cache
+  auto code = canonical_code(instr_code);
+  auto sinstr = predecode_.lookup(PC, code);
+  if (!sinstr) {
+    sinstr = decode_cache_.lookup(PC, code);
+  }
+  if (!sinstr) {
+    StaticInstr new_sinstr;
+    if (!decode_instr(instr_code, PC, &new_sinstr))
+      return nullptr;
+    sinstr = decode_cache_.insert(new_sinstr);
+  }
+  return sinstr;
+}
+
+Instr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) {
+  auto sinstr = this->decode_static(instr_code, PC);
+  if (!sinstr) {
+    std::cout << std::hex << "Error: invalid instruction: 0x" << instr_code << ", PC=0x" << PC << std::dec << std::endl;
+    std::abort();
+  }
+  return Instr(uuid, *sinstr);
+}
+
+bool Core::fusible(const Instr& instr) {
+  if (config_.fusion == 0
+   || !instr.getExeFlags().use_rd
+   || instr.getBrOp() != BrOp::NONE)
+    return false;
+
+  // the decoder sees the next instruction of the fetch packet,
+  // only wait for it if the pair is known to fuse.
+  uint32_t next_PC = instr.getPC() + instr.getSize();
+  uint32_t next_code = 0;
+  mmu_.read(&next_code, next_PC, sizeof(next_code), 0);
+  auto next = this->decode_static(next_code, next_PC);
+  if (!next)
+    return false;
+
+  StaticInstr fused;
+  FuseType type;
+  return fuse_instrs(instr.getStatic(), *next, config_.fusion, &fused, &type);
+}
+
+bool Core::fuse(const Instr& first, const Instr& second, Instr* fused) {
+  StaticInstr sinstr;
+  FuseType type;
+  if (second.getPC() != first.getPC() + first.getSize()
+   || !fuse_instrs(first.getStatic(), second.getStatic(), config_.fusion, &sinstr, &type))
+    return false;
+  *fused = Instr(first.getId(), sinstr);
+  fused->setFused(type, first.getSize() + second.getSize());
+  ++perf_stats_.fusions[int(type)];
+  return true;
+}
+
+void Core::dmem_read(void *data, uint64_t addr, uint32_t size, Word PC) {
   auto type = get_addr_type(addr);
   __unused (type);
   mmu_.read(data, addr, size, 0);
+  this->trace_ref({MemRefType::LOAD, PC, addr, size});
   DT(2, "Mem Read: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
 
-void Core::dmem_write(const void* data, uint64_t addr, uint32_t size) {
+void Core::dmem_write(const void* data, uint64_t addr, uint32_t size, Word PC, uint64_t uuid) {
   auto type = get_addr_type(addr);
   __unused (type);
+  if (checker_) {
+    checker_->store(uuid, addr, size, data);
+  }
   if (addr >= uint64_t(IO_COUT_ADDR)
    && addr < (uint64_t(IO_COUT_ADDR) + IO_COUT_SIZE)) {
      this->writeToStdOut(data);
   } else {
     mmu_.write(data, addr, size, 0);
+    decode_cache_.invalidate(addr, size);
+    fetch_buf_.invalidate(addr, size);
+    this->trace_ref({MemRefType::STORE, PC, addr, size});
   }
   DT(2, "Mem Write: addr=0x" << std::hex << addr << ", data=0x" << ByteStream(data, size) << " (size=" << size << ", type=" << type << ")");
 }
 
+void Core::trace_ref(const MemRef& ref) {
+  if (trace_) {
+    trace_->write(ref);
+  }
+  if (reuse_) {
+    reuse_->access(ref);
+  }
+}
+
 uint32_t Core::get_csr(uint32_t addr) {
   // stall-independent mcycle workaround for software timing consistency
   uint64_t ideal_mcycles = (perf_stats_.instrs-1) + 5;
@@ -171,6 +314,10 @@ uint32_t Core::get_csr(uint32_t addr) {
     return perf_stats_.instrs & 0xffffffff;
   case VX_CSR_MINSTRET_H: // NumInsts
     return (uint32_t)(perf_stats_.instrs >> 32);
+  case VX_CSR_SIM_ROI_BEGIN:
+  case VX_CSR_SIM_ROI_END:
+  case VX_CSR_SIM_MODE:
+    return processor_->get_sim_csr(addr);
   default:
     std::cout << std::hex << "Error: invalid CSR read addr=0x" << addr << std::endl;
     std::abort();
@@ -178,7 +325,7 @@ uint32_t Core::get_csr(uint32_t addr) {
   }
 }
 
-void Core::set_csr(uint32_t addr, uint32_t value) {
+void Core::set_csr(uint32_t addr, uint32_t value, uint64_t uuid) {
   switch (addr) {
   case VX_CSR_SATP:
   case VX_CSR_MSTATUS:
@@ -191,6 +338,11 @@ void Core::set_csr(uint32_t addr, uint32_t value) {
   case VX_CSR_PMPADDR0:
   case VX_CSR_MNSTATUS:
     break;
+  case VX_CSR_SIM_ROI_BEGIN:
+  case VX_CSR_SIM_ROI_END:
+  case VX_CSR_SIM_MODE:
+    processor_->set_sim_csr(uuid, addr, value);
+    break;
   default: {
       std::cout << std::hex << "Error: invalid CSR write addr=0x" << addr << ", value=0x" << value << std::endl;
       std::abort();
@@ -227,14 +379,101 @@ bool Core::check_exit(Word* exitcode, bool riscv_test) const {
   return false;
 }
 
+bool Core::drain() {
+  draining_ = true;
+  return perf_stats_.instrs == fetched_instrs_;
+}
+
+void Core::warm_branch(Word PC, Word next_PC, bool taken) {
+  // fetch stalls on branches, no predictor to train
+  (void) PC;
+  (void) next_PC;
+  (void) taken;
+}
+
+void Core::warm_mem(uint64_t addr, uint32_t size, bool write) {
+  (void) size;
+  if (get_addr_type(addr) != AddrType::IO) {
+    dcache_->warm(addr, write);
+  }
+}
+
+void Core::save_state(StateWriter& writer) const {
+  dcache_->save_state(writer);
+}
+
+bool Core::load_state(const StateReader& reader) {
+  return dcache_->load_state(reader);
+}
+
 bool Core::running() const {
   return (perf_stats_.instrs != fetched_instrs_) || (fetched_instrs_ == 0);
 }
 
 void Core::attach_ram(RAM* ram) {
   mmu_.attach(*ram, 0, 0xFFFFFFFF);
+#if PREDECODE
+  // start at the entry point, data loaded below or far above it is not code
+  uint64_t base = ram->image_base();
+  if (STARTUP_ADDR >= base && STARTUP_ADDR < ram->image_end()) {
+    base = STARTUP_ADDR;
+  }
+  uint64_t end = std::min<uint64_t>(ram->image_end(), base + PREDECODE_SIZE);
+  predecode_.load(*ram, base, end);
+#endif
+}
+
+void Core::attach_trace(MemTraceWriter* trace) {
+  trace_ = trace;
+}
+
+void Core::attach_reuse(ReuseProfiler* reuse) {
+  reuse_ = reuse;
+}
+
+void Core::attach_checker(Checker* checker) {
+  checker_ = checker;
 }
 
 void Core::showStats() {
   std::cout << std::dec << "PERF: instrs=" << perf_stats_.instrs << ", cycles=" << perf_stats_.cycles << std::endl;
+  auto& fetch_stats = fetch_buf_.perf_stats();
+  std::cout << std::dec << "FETCH: instrs=" << fetch_stats.instrs << ", compressed=" << fetch_stats.compressed
+            << " (" << (fetch_stats.instrs ? (100 * fetch_stats.compressed / fetch_stats.instrs) : 0) << "%)"
+            << ", blocks=" << fetch_stats.blocks << ", straddles=" << fetch_stats.straddles
+            << ", block_util=" << (fetch_stats.blocks ? (100 * fetch_stats.used_bytes / (fetch_stats.blocks * FetchBuffer::BLOCK_SIZE)) : 0) << "%" << std::endl;
+  auto& decode_stats = decode_cache_.perf_stats();
+  std::cout << std::dec << "DECODE: hits=" << decode_stats.hits << ", misses=" << decode_stats.misses
+            << ", invalidations=" << decode_stats.invalidations << std::endl;
+  auto& predecode_stats = predecode_.perf_stats();
+  std::cout << std::dec << "PREDECODE: decoded=" << predecode_.decoded() << ", hits=" << predecode_stats.hits
+            << ", misses=" << predecode_stats.misses << std::endl;
+  uint64_t fused_pairs = 0;
+  for (auto count : perf_stats_.fusions) {
+    fused_pairs += count;
+  }
+  std::cout << std::dec << "FUSION: pairs=" << fused_pairs
+            << " (" << (perf_stats_.instrs ? (100 * 2 * fused_pairs / perf_stats_.instrs) : 0) << "% of instrs)"
+            << ", lui_addi=" << perf_stats_.fusions[int(FuseType::LUI_ADDI)]
+            << ", auipc_jalr=" << perf_stats_.fusions[int(FuseType::AUIPC_JALR)]
+            << ", slli_add=" << perf_stats_.fusions[int(FuseType::SLLI_ADD)]
+            << ", load=" << perf_stats_.fusions[int(FuseType::LOAD)] << std::endl;
+  auto& dcache_stats = dcache_->perf_stats();
+  std::cout << std::dec << "DCACHE: reads=" << dcache_stats.reads << ", writes=" << dcache_stats.writes
+            << ", read_misses=" << dcache_stats.read_misses << ", write_misses=" << dcache_stats.write_misses
+            << ", victim_hits=" << dcache_stats.victim_hits << ", evictions=" << dcache_stats.evictions
+            << ", writebacks=" << dcache_stats.writebacks << std::endl;
+  auto& dram_stats = dram_->perf_stats();
+  uint64_t dram_reqs = dram_stats.reads + dram_stats.writes;
+  std::cout << std::dec << "DRAM: reads=" << dram_stats.reads << ", writes=" << dram_stats.writes
+            << ", row_hits=" << dram_stats.row_hits << ", row_misses=" << dram_stats.row_misses
+            << ", row_conflicts=" << dram_stats.row_conflicts << ", queue_full=" << dram_stats.queue_full
+            << ", avg_latency=" << (dram_reqs ? (dram_stats.total_latency / dram_reqs) : 0) << std::endl;
+  auto& mul_stats = std::static_pointer_cast<MUL>(FUs_.at((int)FUType::MUL))->perf_stats();
+  std::cout << std::dec << "MUL: ops=" << mul_stats.ops << ", busy_cycles=" << mul_stats.busy_cycles
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * mul_stats.stage_cycles / (perf_stats_.cycles * config_.mul_latency)) : 0) << "%" << std::endl;
+  auto& div_stats = std::static_pointer_cast<DIV>(FUs_.at((int)FUType::DIV))->perf_stats();
+  std::cout << std::dec << "DIV: ops=" << div_stats.ops << ", busy_cycles=" << div_stats.busy_cycles
+            << ", early_outs=" << div_stats.early_outs
+            << ", occupancy=" << (perf_stats_.cycles ? (100 * div_stats.busy_cycles / perf_stats_.cycles) : 0) << "%" << std::endl;
 }
@@ -29,55 +29,102 @@
 #include "val_reg.h"
 #include "fifo_reg.h"
 #include "instr.h"
+#include "decode_cache.h"
 #include "RAT.h"
 #include "RS.h"
 #include "RST.h"
 #include "ROB.h"
 #include "FU.h"
+#include "fetch_buffer.h"
 #include "CDB.h"
+#include "cache.h"
+#include "dram.h"
+#include "memtrace.h"
+#include "reuse.h"
+#include "core_config.h"
 
 namespace tinyrv {
 
 class ProcessorImpl;
 class Instr;
 class RAM;
+class Checker;
 
 class Core : public SimObject<Core> {
 public:
   struct PerfStats {
     uint64_t cycles;
     uint64_t instrs;
+    uint64_t fusions[int(FuseType::COUNT)];
 
     PerfStats()
       : cycles(0)
       , instrs(0)
+      , fusions()
     {}
   };
 
-  Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor);
+  Core(const SimContext& ctx, uint32_t core_id, ProcessorImpl* processor, const CoreConfig& config);
   ~Core();
 
+  const CoreConfig& config() const {
+    return config_;
+  }
+
   void reset();
 
   void tick();
 
   void attach_ram(RAM* ram);
 
+  void attach_trace(MemTraceWriter* trace);
+
+  void attach_reuse(ReuseProfiler* reuse);
+
+  void attach_checker(Checker* checker);
+
   bool running() const;
 
   bool check_exit(Word* exitcode, bool riscv_test) const;
 
   void showStats();
 
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  // stop fetching and let the instructions in flight retire, returns true
+  // once all of them have committed
+  bool drain();
+
+  // functional warming: update the cache state for instructions executed
+  // outside the pipeline, without timing them
+  void warm_branch(Word PC, Word next_PC, bool taken);
+
+  void warm_mem(uint64_t addr, uint32_t size, bool write);
+
+  // warm-start: the state carried between runs
+  void save_state(StateWriter& writer) const;
+
+  bool load_state(const StateReader& reader);
+
 private:
 
-  Instr::Ptr decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const;
+  const StaticInstr* decode_static(uint32_t instr_code, uint32_t PC);
+
+  Instr decode(uint32_t instr_code, uint32_t PC, uint64_t uuid);
+
+  bool fusible(const Instr& instr);
 
-  void dmem_read(void* data, uint64_t addr, uint32_t size);
+  bool fuse(const Instr& first, const Instr& second, Instr* fused);
 
-  void dmem_write(const void* data, uint64_t addr, uint32_t size);
+  void dmem_read(void* data, uint64_t addr, uint32_t size, Word PC);
 
-  void set_csr(uint32_t addr, uint32_t value);
+  void dmem_write(const void* data, uint64_t addr, uint32_t size, Word PC, uint64_t uuid);
+
+  void trace_ref(const MemRef& ref);
+
+  void set_csr(uint32_t addr, uint32_t value, uint64_t uuid);
 
   uint32_t get_csr(uint32_t addr);
 
@@ -92,11 +139,11 @@ private:
   };
 
   struct is_data_t {
-    Instr::Ptr instr;
+    Instr instr;
   };
 
   struct ex_data_t {
-    Instr::Ptr instr;
+    Instr instr;
     uint32_t rs1_data;
     uint32_t rs2_data;
   };
@@ -110,14 +157,21 @@ private:
 
   uint32_t core_id_;
   ProcessorImpl* processor_;
+  CoreConfig config_;
   MemoryUnit mmu_;
 
   std::vector<Word> reg_file_;
   Word PC_;
 
+  FetchBuffer fetch_buf_;
+  DecodeCache decode_cache_;
+  PredecodeTable predecode_;
+
   FiFoReg<id_data_t>::Ptr decode_queue_;
   FiFoReg<is_data_t>::Ptr issue_queue_;
   ValReg<bool>::Ptr fetch_stalled_;
+  Instr fuse_slot_;
+  bool  fuse_held_;  // fuse_slot_ holds an instruction waiting for its pair
 
   ReorderBuffer       ROB_;
   RegisterAliasTable  RAT_;
@@ -125,6 +179,12 @@ private:
   RegisterStatusTable RST_;
   CommonDataBus       CDB_;
   std::vector<FunctionalUnit::Ptr> FUs_;
+  Cache::Ptr dcache_;
+  DramController::Ptr dram_;
+  MemTraceWriter* trace_;
+  ReuseProfiler* reuse_;
+  Checker* checker_;
+  bool draining_;
   bool exited_;
 
   std::stringstream cout_buf_;
@@ -138,6 +198,7 @@ private:
   friend class BRU;
   friend class LSU;
   friend class SFU;
+  friend class Emulator;
 };
 
 } // namespace tinyrv
@@ -0,0 +1,156 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <stdlib.h>
+#include <util.h>
+#include "core_config.h"
+#include "replacement.h"
+#include "config.h"
+
+using namespace tinyrv;
+
+static const struct {
+  const char* name;
+  uint32_t CoreConfig::*field;
+} core_params[] = {
+  {"rob_size",        &CoreConfig::rob_size},
+  {"num_rss",         &CoreConfig::num_rss},
+  {"alu_latency",     &CoreConfig::alu_latency},
+  {"bru_latency",     &CoreConfig::bru_latency},
+  {"lsu_latency",     &CoreConfig::lsu_latency},
+  {"sfu_latency",     &CoreConfig::sfu_latency},
+  {"mul_latency",     &CoreConfig::mul_latency},
+  {"div_latency",     &CoreConfig::div_latency},
+  {"fusion",          &CoreConfig::fusion},
+  {"dcache_size",     &CoreConfig::dcache_size},
+  {"dcache_ways",     &CoreConfig::dcache_ways},
+  {"dcache_latency",  &CoreConfig::dcache_latency},
+  {"dcache_repl",     &CoreConfig::dcache_repl},
+  {"vcache_entries",  &CoreConfig::vcache_entries},
+  {"memory_banks",    &CoreConfig::memory_banks},
+  {"dram_row_size",   &CoreConfig::dram_row_size},
+  {"dram_queue_size", &CoreConfig::dram_queue_size},
+  {"dram_tcas",       &CoreConfig::dram_tcas},
+  {"dram_trcd",       &CoreConfig::dram_trcd},
+  {"dram_trp",        &CoreConfig::dram_trp},
+};
+
+static std::string trim(const std::string& str) {
+  auto first = str.find_first_not_of(" \t\r");
+  if (first == std::string::npos)
+    return "";
+  auto last = str.find_last_not_of(" \t\r");
+  return str.substr(first, last - first + 1);
+}
+
+CoreConfig::CoreConfig()
+  : rob_size(ROB_SIZE)
+  , num_rss(NUM_RSS)
+  , alu_latency(ALU_LATENCY)
+  , bru_latency(BRU_LATENCY)
+  , lsu_latency(LSU_LATENCY)
+  , sfu_latency(SFU_LATENCY)
+  , mul_latency(MUL_LATENCY)
+  , div_latency(DIV_LATENCY)
+  , fusion(FUSION)
+  , dcache_size(DCACHE_SIZE)
+  , dcache_ways(DCACHE_WAYS)
+  , dcache_latency(DCACHE_LATENCY)
+  , dcache_repl(DCACHE_REPL)
+  , vcache_entries(VCACHE_ENTRIES)
+  , memory_banks(MEMORY_BANKS)
+  , dram_row_size(DRAM_ROW_SIZE)
+  , dram_queue_size(DRAM_QUEUE_SIZE)
+  , dram_tcas(DRAM_TCAS)
+  , dram_trcd(DRAM_TRCD)
+  , dram_trp(DRAM_TRP)
+{}
+
+bool CoreConfig::set(const std::string& name, const std::string& value) {
+  for (auto& param : core_params) {
+    if (name != param.name)
+      continue;
+    char* end;
+    auto number = std::strtoul(value.c_str(), &end, 0);
+    if (value.empty() || *end != '\0' || number > UINT32_MAX) {
+      std::cout << "*** error: invalid value for " << name << ": " << value << std::endl;
+      return false;
+    }
+    this->*param.field = number;
+    return true;
+  }
+  std::cout << "*** error: unknown core parameter: " << name << std::endl;
+  return false;
+}
+
+bool CoreConfig::parse(const std::string& assignment) {
+  auto eq = assignment.find('=');
+  if (eq == std::string::npos) {
+    std::cout << "*** error: expected name=value: " << assignment << std::endl;
+    return false;
+  }
+  return this->set(trim(assignment.substr(0, eq)), trim(assignment.substr(eq + 1)));
+}
+
+bool CoreConfig::load(const char* filename) {
+  std::ifstream ifs(filename);
+  if (!ifs) {
+    std::cout << "*** error: cannot open " << filename << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(ifs, line)) {
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    if (!this->parse(line))
+      return false;
+  }
+  return true;
+}
+
+bool CoreConfig::validate() const {
+  const char* error = nullptr;
+  uint32_t dcache_sets = dcache_ways ? (dcache_size / (MEM_BLOCK_SIZE * dcache_ways)) : 0;
+  if (rob_size == 0 || num_rss == 0) {
+    error = "rob_size and num_rss must be nonzero";
+  } else if (alu_latency == 0 || bru_latency == 0 || lsu_latency == 0
+          || sfu_latency == 0 || mul_latency == 0 || div_latency == 0) {
+    error = "functional unit latencies must be nonzero";
+  } else if (dcache_sets == 0 || !ispow2(dcache_sets)
+          || dcache_size != dcache_sets * MEM_BLOCK_SIZE * dcache_ways) {
+    error = "dcache_size must be a power-of-two number of sets of dcache_ways blocks";
+  } else if (dcache_repl > uint32_t(ReplPolicy::BRRIP)
+          || (ReplPolicy(dcache_repl) == ReplPolicy::PLRU && !ispow2(dcache_ways))) {
+    error = "dcache_repl must be 0..4, PLRU needs power-of-two dcache_ways";
+  } else if (memory_banks == 0 || !ispow2(memory_banks)
+          || !ispow2(dram_row_size) || dram_row_size < MEM_BLOCK_SIZE || dram_queue_size == 0) {
+    error = "memory_banks and dram_row_size must be powers of two, with a nonzero dram_queue_size";
+  }
+  if (error) {
+    std::cout << "*** error: invalid core config: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void CoreConfig::dump(std::ostream& os) const {
+  os << std::dec << "CONFIG:";
+  const char* sep = " ";
+  for (auto& param : core_params) {
+    os << sep << param.name << "=" << this->*param.field;
+    sep = ", ";
+  }
+  os << std::endl;
+}
@@ -16,32 +16,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <iomanip>
-#include <vector>
-#include <unordered_map>
+#include <array>
 #include <util.h>
 #include "debug.h"
 #include "types.h"
-#include "core.h"
 #include "instr.h"
 
 using namespace tinyrv;
 
 namespace tinyrv {
 
-static const std::unordered_map<Opcode, InstType> sc_instTable = {
-  {Opcode::R,     InstType::R},
-  {Opcode::L,     InstType::I},
-  {Opcode::I,     InstType::I},
-  {Opcode::S,     InstType::S},
-  {Opcode::B,     InstType::B},
-  {Opcode::LUI,   InstType::U},
-  {Opcode::AUIPC, InstType::U},
-  {Opcode::JAL,   InstType::J},
-  {Opcode::JALR,  InstType::I},
-  {Opcode::SYS,   InstType::I},
-  {Opcode::FENCE, InstType::I},
-};
-
 enum Constants {
   width_opcode= 7,
   width_reg   = 5,
@@ -66,104 +50,353 @@ enum Constants {
   mask_j_imm  = (1 << width_j_imm) - 1,
 };
 
+namespace {
+
+// Immediate encodings, each one has its own extractor
+enum class ImmType {
+  NONE,
+  I,      // sign-extended imm[11:0]
+  SHAMT,  // shift amount
+  CSR,    // zero-extended imm[11:0]
+  S,
+  B,
+  U,
+  J,
+  COUNT
+};
+
+// Encoding variants of an {opcode, func3} group.
+// The R and I opcodes tell them apart by func7 and, for the Zbb unary
+// operations, by the rs2 field; every other opcode only has the base one.
+enum class Variant {
+  BASE,    // func7 = 0x00
+  ALT,     // func7 = 0x20: SUB, SRA, XNOR, ORN, ANDN
+  M,       // func7 = 0x01: RV32M
+  SHADD,   // func7 = 0x10: Zba
+  MINMAX,  // func7 = 0x05
+  ZEXTH,   // func7 = 0x04, rs2 = 0x00
+  ROT,     // func7 = 0x30: ROL, ROR, RORI
+  CLZ,     // func7 = 0x30, rs2 = 0x00
+  CTZ,     // func7 = 0x30, rs2 = 0x01
+  CPOP,    // func7 = 0x30, rs2 = 0x02
+  SEXTB,   // func7 = 0x30, rs2 = 0x04
+  SEXTH,   // func7 = 0x30, rs2 = 0x05
+  REV8,    // func7 = 0x34, rs2 = 0x18
+  ORCB,    // func7 = 0x14, rs2 = 0x07
+  INVALID,
+  COUNT
+};
+
+// Decode table entry, everything known from opcode, func3 and the encoding variant
+struct DecodeEntry {
+  bool        valid;
+  InstType    format;
+  ImmType     imm_type;
+  AluOp       alu_op;
+  BrOp        br_op;
+  FUType      fu_type;
+  ExeFlags    exe_flags;
+  const char* mnemonic;
+};
+
+// The table is indexed by {opcode[6:2], func3, variant},
+// opcode[1:0] is always 0b11 for 32-bit instructions.
+constexpr uint32_t DECODE_TABLE_SIZE = 32 * 8 * 16;
+
+static_assert(uint32_t(Variant::COUNT) <= 16, "encoding variants must fit in 4 bits");
+
+constexpr Variant unary_variant(uint32_t rs2) {
+  return (rs2 == 0) ? Variant::CLZ :
+         (rs2 == 1) ? Variant::CTZ :
+         (rs2 == 2) ? Variant::CPOP :
+         (rs2 == 4) ? Variant::SEXTB :
+         (rs2 == 5) ? Variant::SEXTH : Variant::INVALID;
+}
+
+constexpr Variant variant_of(uint32_t opcode, uint32_t func3, uint32_t func7, uint32_t rs2) {
+  return (Opcode(opcode) == Opcode::R) ?
+           ((func7 == 0x00) ? Variant::BASE :
+            (func7 == 0x20) ? Variant::ALT :
+            (func7 == 0x01) ? Variant::M :
+            (func7 == 0x10) ? Variant::SHADD :
+            (func7 == 0x05) ? Variant::MINMAX :
+            (func7 == 0x04 && rs2 == 0) ? Variant::ZEXTH :
+            (func7 == 0x30) ? Variant::ROT : Variant::INVALID) :
+         // the I opcode only uses func7 for shifts, it is immediate bits otherwise
+         (Opcode(opcode) == Opcode::I && (func3 == 1 || func3 == 5)) ?
+           ((func7 == 0x00) ? Variant::BASE :
+            (func7 == 0x20) ? Variant::ALT :
+            (func7 == 0x30) ? ((func3 == 5) ? Variant::ROT : unary_variant(rs2)) :
+            (func7 == 0x34 && rs2 == 0x18) ? Variant::REV8 :
+            (func7 == 0x14 && rs2 == 0x07) ? Variant::ORCB : Variant::INVALID) :
+         Variant::BASE;
+}
+
+constexpr uint32_t decode_index(uint32_t opcode, uint32_t func3, uint32_t func7, uint32_t rs2) {
+  return ((opcode >> 2) << 7) | (func3 << 4) | uint32_t(variant_of(opcode, func3, func7, rs2));
+}
+
+// operations without a second source
+constexpr bool is_unary(Variant v) {
+  return v == Variant::ZEXTH || (v >= Variant::CLZ && v <= Variant::ORCB);
+}
+
+constexpr AluOp sc_aluOps[8] = {
+  AluOp::ADD, AluOp::SLL, AluOp::LTI, AluOp::LTU, AluOp::XOR, AluOp::SRL, AluOp::OR, AluOp::AND
+};
+
+constexpr AluOp sc_altOps[8] = {
+  AluOp::SUB, AluOp::NONE, AluOp::NONE, AluOp::NONE, AluOp::XNOR, AluOp::SRA, AluOp::ORN, AluOp::ANDN
+};
+
+constexpr AluOp sc_csrAluOps[8] = {
+  AluOp::ADD, AluOp::ADD, AluOp::OR, AluOp::AND, AluOp::NONE, AluOp::ADD, AluOp::OR, AluOp::AND
+};
+
+constexpr AluOp sc_mulDivOps[8] = {
+  AluOp::MUL, AluOp::MULH, AluOp::MULHSU, AluOp::MULHU, AluOp::DIV, AluOp::DIVU, AluOp::REM, AluOp::REMU
+};
+
+constexpr AluOp sc_shAddOps[8] = {
+  AluOp::NONE, AluOp::NONE, AluOp::SH1ADD, AluOp::NONE, AluOp::SH2ADD, AluOp::NONE, AluOp::SH3ADD, AluOp::NONE
+};
+
+constexpr AluOp sc_minMaxOps[8] = {
+  AluOp::NONE, AluOp::NONE, AluOp::NONE, AluOp::NONE, AluOp::MIN, AluOp::MINU, AluOp::MAX, AluOp::MAXU
+};
+
+constexpr BrOp sc_brOps[8] = {
+  BrOp::BEQ, BrOp::BNE, BrOp::NONE, BrOp::NONE, BrOp::BLT, BrOp::BGE, BrOp::BLTU, BrOp::BGEU
+};
+
+constexpr const char* sc_rNames[8]     = {"ADD", "SLL", "SLT", "SLTU", "XOR", "SRL", "OR", "AND"};
+constexpr const char* sc_altNames[8]   = {"SUB", nullptr, nullptr, nullptr, "XNOR", "SRA", "ORN", "ANDN"};
+constexpr const char* sc_mNames[8]     = {"MUL", "MULH", "MULHSU", "MULHU", "DIV", "DIVU", "REM", "REMU"};
+constexpr const char* sc_shAddNames[8] = {nullptr, nullptr, "SH1ADD", nullptr, "SH2ADD", nullptr, "SH3ADD", nullptr};
+constexpr const char* sc_minMaxNames[8] = {nullptr, nullptr, nullptr, nullptr, "MIN", "MINU", "MAX", "MAXU"};
+constexpr const char* sc_iNames[8]     = {"ADDI", "SLLI", "SLTI", "SLTIU", "XORI", "SRLI", "ORI", "ANDI"};
+constexpr const char* sc_bNames[8]     = {"BEQ", "BNE", nullptr, nullptr, "BLT", "BGE", "BLTU", "BGEU"};
+constexpr const char* sc_lNames[8]     = {"LB", "LH", "LW", nullptr, "LBU", "LHU", nullptr, nullptr};
+constexpr const char* sc_sNames[8]     = {"SB", "SH", "SW", nullptr, nullptr, nullptr, nullptr, nullptr};
+constexpr const char* sc_sysNames[8]   = {"ECALL", "CSRRW", "CSRRS", "CSRRC", nullptr, "CSRRWI", "CSRRSI", "CSRRCI"};
+
+// integer operations of the R and I opcodes, NONE if the encoding is invalid
+constexpr AluOp int_alu_op_of(Opcode op, uint32_t f3, Variant v) {
+  return (v == Variant::BASE) ? sc_aluOps[f3] :
+         (v == Variant::ALT) ? ((op == Opcode::R) ? sc_altOps[f3] : (f3 == 5) ? AluOp::SRA : AluOp::NONE) :
+         (op == Opcode::R && v == Variant::M) ? sc_mulDivOps[f3] :
+         (op == Opcode::R && v == Variant::SHADD) ? sc_shAddOps[f3] :
+         (op == Opcode::R && v == Variant::MINMAX) ? sc_minMaxOps[f3] :
+         (op == Opcode::R && v == Variant::ZEXTH) ? ((f3 == 4) ? AluOp::ZEXTH : AluOp::NONE) :
+         (v == Variant::ROT) ? ((f3 == 5) ? AluOp::ROR : (op == Opcode::R && f3 == 1) ? AluOp::ROL : AluOp::NONE) :
+         (op == Opcode::R) ? AluOp::NONE :
+         (v == Variant::CLZ) ? AluOp::CLZ :
+         (v == Variant::CTZ) ? AluOp::CTZ :
+         (v == Variant::CPOP) ? AluOp::CPOP :
+         (v == Variant::SEXTB) ? AluOp::SEXTB :
+         (v == Variant::SEXTH) ? AluOp::SEXTH :
+         (v == Variant::REV8) ? AluOp::REV8 :
+         (v == Variant::ORCB) ? AluOp::ORCB : AluOp::NONE;
+}
+
+constexpr AluOp alu_op_of(Opcode op, uint32_t f3, Variant v) {
+  return (op == Opcode::R || op == Opcode::I) ? int_alu_op_of(op, f3, v) :
+         (op == Opcode::SYS) ? sc_csrAluOps[f3] :
+         (op == Opcode::FENCE) ? AluOp::NONE : AluOp::ADD;
+}
+
+constexpr bool valid_of(Opcode op, uint32_t f3, Variant v) {
+  return ((op == Opcode::R || op == Opcode::I) && int_alu_op_of(op, f3, v) != AluOp::NONE)
+      || (v == Variant::BASE
+       && ((op == Opcode::LUI || op == Opcode::AUIPC || op == Opcode::JAL
+         || op == Opcode::JALR || op == Opcode::FENCE)
+        || (op == Opcode::B && sc_bNames[f3] != nullptr)
+        || (op == Opcode::L && sc_lNames[f3] != nullptr)
+        || (op == Opcode::S && sc_sNames[f3] != nullptr)
+        || (op == Opcode::SYS && sc_sysNames[f3] != nullptr)));
+}
+
+constexpr InstType format_of(Opcode op) {
+  return (op == Opcode::S) ? InstType::S :
+         (op == Opcode::B) ? InstType::B :
+         (op == Opcode::LUI || op == Opcode::AUIPC) ? InstType::U :
+         (op == Opcode::JAL) ? InstType::J :
+         (op == Opcode::R) ? InstType::R : InstType::I;
+}
+
+constexpr ImmType imm_type_of(Opcode op, uint32_t f3) {
+  return (op == Opcode::I) ? ((f3 == 1 || f3 == 5) ? ImmType::SHAMT : ImmType::I) :
+         (op == Opcode::L || op == Opcode::JALR) ? ImmType::I :
+         (op == Opcode::SYS) ? ImmType::CSR :
+         (op == Opcode::S) ? ImmType::S :
+         (op == Opcode::B) ? ImmType::B :
+         (op == Opcode::LUI || op == Opcode::AUIPC) ? ImmType::U :
+         (op == Opcode::JAL) ? ImmType::J : ImmType::NONE;
+}
+
+constexpr BrOp br_op_of(Opcode op, uint32_t f3) {
+  return (op == Opcode::B) ? sc_brOps[f3] :
+         (op == Opcode::JAL) ? BrOp::JAL :
+         (op == Opcode::JALR) ? BrOp::JALR : BrOp::NONE;
+}
+
+constexpr FUType fu_type_of(Opcode op, uint32_t f3, Variant v) {
+  return (op == Opcode::R && v == Variant::M) ? ((f3 < 4) ? FUType::MUL : FUType::DIV) :
+         (op == Opcode::SYS && f3 != 0) ? FUType::SFU :
+         (op == Opcode::L || op == Opcode::S) ? FUType::LSU :
+         (op == Opcode::B || op == Opcode::JAL || op == Opcode::JALR) ? FUType::BRU : FUType::ALU;
+}
+
+constexpr ExeFlags exe_flags_of(Opcode op, uint32_t f3, Variant v) {
+  return ExeFlags{
+    // use_rd
+    (op == Opcode::R || op == Opcode::I || op == Opcode::L || op == Opcode::JALR
+  || op == Opcode::LUI || op == Opcode::AUIPC || op == Opcode::JAL
+  || (op == Opcode::SYS && f3 != 0)),
+    // use_rs1
+    (op == Opcode::R || op == Opcode::I || op == Opcode::L || op == Opcode::JALR
+  || op == Opcode::S || op == Opcode::B || (op == Opcode::SYS && f3 != 0 && f3 < 5)),
+    // use_rs2
+    ((op == Opcode::R && !is_unary(v)) || op == Opcode::S || op == Opcode::B),
+    // use_imm
+    (op != Opcode::R && op != Opcode::FENCE && !is_unary(v)),
+    // is_load
+    (op == Opcode::L),
+    // is_store
+    (op == Opcode::S),
+    // is_csr
+    (op == Opcode::SYS && f3 != 0),
+    // is_exit (resolved from the immediate)
+    0,
+    // alu_s1_inv
+    (op == Opcode::SYS && (f3 == 3 || f3 == 7)),
+    // alu_s1_rs1
+    (op == Opcode::SYS && f3 >= 5),
+    // alu_s1_PC
+    (op == Opcode::AUIPC || op == Opcode::B || op == Opcode::JAL),
+    // alu_s2_imm
+    (op != Opcode::R && op != Opcode::SYS && op != Opcode::FENCE),
+    // alu_s2_csr
+    (op == Opcode::SYS && f3 != 0)
+  };
+}
+
+constexpr const char* r_mnemonic_of(uint32_t f3, Variant v) {
+  return (v == Variant::BASE) ? sc_rNames[f3] :
+         (v == Variant::ALT) ? sc_altNames[f3] :
+         (v == Variant::M) ? sc_mNames[f3] :
+         (v == Variant::SHADD) ? sc_shAddNames[f3] :
+         (v == Variant::MINMAX) ? sc_minMaxNames[f3] :
+         (v == Variant::ZEXTH) ? "ZEXT.H" :
+         (v == Variant::ROT) ? ((f3 == 1) ? "ROL" : "ROR") : nullptr;
+}
+
+constexpr const char* i_mnemonic_of(uint32_t f3, Variant v) {
+  return (v == Variant::BASE) ? sc_iNames[f3] :
+         (v == Variant::ALT) ? "SRAI" :
+         (v == Variant::ROT) ? "RORI" :
+         (v == Variant::CLZ) ? "CLZ" :
+         (v == Variant::CTZ) ? "CTZ" :
+         (v == Variant::CPOP) ? "CPOP" :
+         (v == Variant::SEXTB) ? "SEXT.B" :
+         (v == Variant::SEXTH) ? "SEXT.H" :
+         (v == Variant::REV8) ? "REV8" :
+         (v == Variant::ORCB) ? "ORC.B" : nullptr;
+}
+
+constexpr const char* mnemonic_of(Opcode op, uint32_t f3, Variant v) {
+  return (op == Opcode::R) ? r_mnemonic_of(f3, v) :
+         (op == Opcode::I) ? i_mnemonic_of(f3, v) :
+         (op == Opcode::B) ? sc_bNames[f3] :
+         (op == Opcode::L) ? sc_lNames[f3] :
+         (op == Opcode::S) ? sc_sNames[f3] :
+         (op == Opcode::SYS) ? sc_sysNames[f3] :
+         (op == Opcode::LUI) ? "LUI" :
+         (op == Opcode::AUIPC) ? "AUIPC" :
+         (op == Opcode::JAL) ? "JAL" :
+         (op == Opcode::JALR) ? "JALR" :
+         (op == Opcode::FENCE) ? "FENCE" : nullptr;
+}
+
+constexpr DecodeEntry make_entry(Opcode op, uint32_t f3, Variant v) {
+  return valid_of(op, f3, v)
+    ? DecodeEntry{true, format_of(op), imm_type_of(op, f3), alu_op_of(op, f3, v),
+                  br_op_of(op, f3), fu_type_of(op, f3, v), exe_flags_of(op, f3, v), mnemonic_of(op, f3, v)}
+    : DecodeEntry{false, InstType::R, ImmType::NONE, AluOp::NONE,
+                  BrOp::NONE, FUType::NONE, ExeFlags{}, nullptr};
+}
+
+constexpr DecodeEntry make_entry(uint32_t index) {
+  return make_entry(Opcode(((index >> 7) << 2) | 0x3), (index >> 4) & 0x7, Variant(index & 0xf));
+}
+
+template <uint32_t... Is>
+struct index_seq {};
+
+template <typename S1, typename S2>
+struct concat_index_seq;
+
+template <uint32_t... I1, uint32_t... I2>
+struct concat_index_seq<index_seq<I1...>, index_seq<I2...>> {
+  typedef index_seq<I1..., uint32_t(sizeof...(I1) + I2)...> type;
+};
+
+// built by halving to keep the template recursion depth logarithmic
+template <uint32_t N>
+struct make_index_seq : concat_index_seq<typename make_index_seq<N / 2>::type,
+                                         typename make_index_seq<N - N / 2>::type> {};
+
+template <>
+struct make_index_seq<0> {
+  typedef index_seq<> type;
+};
+
+template <>
+struct make_index_seq<1> {
+  typedef index_seq<0> type;
+};
+
+template <uint32_t... Is>
+constexpr std::array<DecodeEntry, sizeof...(Is)> make_decode_table(index_seq<Is...>) {
+  return {{ make_entry(Is)... }};
+}
+
+constexpr std::array<DecodeEntry, DECODE_TABLE_SIZE> sc_decodeTable =
+  make_decode_table(make_index_seq<DECODE_TABLE_SIZE>::type());
+
+}
+
 static const char* op_string(const Instr &instr) {
-  auto opcode = instr.getOpcode();
+  auto opcode = uint32_t(instr.getOpcode());
   auto func3  = instr.getFunc3();
   auto func7  = instr.getFunc7();
   auto imm    = instr.getImm();
 
-  switch (opcode) {
-  case Opcode::LUI:   return "LUI";
-  case Opcode::AUIPC: return "AUIPC";
-  case Opcode::R:
-    switch (func3) {
-    case 0: return func7 ? "SUB" : "ADD";
-    case 1: return "SLL";
-    case 2: return "SLT";
-    case 3: return "SLTU";
-    case 4: return "XOR";
-    case 5: return (func7 & 0x20) ? "SRA" : "SRL";
-    case 6: return "OR";
-    case 7: return "AND";
-    default:
-      std::abort();
-    }
-  case Opcode::I:
-    switch (func3) {
-    case 0: return "ADDI";
-    case 1: return "SLLI";
-    case 2: return "SLTI";
-    case 3: return "SLTIU";
-    case 4: return "XORI";
-    case 5: return (func7 & 0x20) ? "SRAI" : "SRLI";
-    case 6: return "ORI";
-    case 7: return "ANDI";
-    default:
-      std::abort();
-    }
-  case Opcode::B:
-    switch (func3) {
-    case 0: return "BEQ";
-    case 1: return "BNE";
-    case 4: return "BLT";
-    case 5: return "BGE";
-    case 6: return "BLTU";
-    case 7: return "BGEU";
+  if (instr.getOpcode() == Opcode::SYS && func3 == 0) {
+    switch (imm) {
+    case 0x000: return "ECALL";
+    case 0x001: return "EBREAK";
+    case 0x002: return "URET";
+    case 0x102: return "SRET";
+    case 0x302: return "MRET";
     default:
       std::abort();
     }
-  case Opcode::JAL:  return "JAL";
-  case Opcode::JALR: return "JALR";
-  case Opcode::L:
-    switch (func3) {
-    case 0: return "LB";
-    case 1: return "LH";
-    case 2: return "LW";
-    case 3: return "LD";
-    case 4: return "LBU";
-    case 5: return "LHU";
-    case 6: return "LWU";
-    default:
-      std::abort();
-    }
-  case Opcode::S:
-    switch (func3) {
-    case 0: return "SB";
-    case 1: return "SH";
-    case 2: return "SW";
-    case 3: return "SD";
-    default:
-      std::abort();
-    }
-  case Opcode::SYS:
-    switch (func3) {
-    case 0:
-      switch (imm) {
-      case 0x000: return "ECALL";
-      case 0x001: return "EBREAK";
-      case 0x002: return "URET";
-      case 0x102: return "SRET";
-      case 0x302: return "MRET";
-      default:
-        std::abort();
-      }
-    case 1: return "CSRRW";
-    case 2: return "CSRRS";
-    case 3: return "CSRRC";
-    case 5: return "CSRRWI";
-    case 6: return "CSRRSI";
-    case 7: return "CSRRCI";
-    default:
-      std::abort();
-    }
-  case Opcode::FENCE:
-    return "FENCE";
-  default:
+  }
+
+  auto mnemonic = sc_decodeTable[decode_index(opcode, func3, func7, instr.getRs2())].mnemonic;
+  if (mnemonic == nullptr) {
     std::abort();
   }
+  return mnemonic;
 }
 
 std::ostream &operator<<(std::ostream &os, const Instr &instr) {
+  if (instr.getFuseType() != FuseType::NONE) {
+    os << "F.";
+  } else if (instr.getSize() == 2) {
+    os << "C.";
+  }
   os << op_string(instr);
   int sep = 0;
 
@@ -196,127 +429,56 @@ std::ostream &operator<<(std::ostream &os, const Instr &instr) {
   return os;
 }
 
-}
+bool decode_instr(uint32_t instr_code, uint32_t PC, StaticInstr* instr) {
+  // RV32C instructions are decoded from their 32-bit expansion
+  auto canonical = canonical_code(instr_code);
+  if (canonical == 0)
+    return false;
+  instr_code = canonical | 0x3;
 
-Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const {
-  auto instr = std::make_shared<Instr>(uuid, PC);
-  auto opcode = Opcode((instr_code >> shift_opcode) & mask_opcode);
+  auto opcode = (instr_code >> shift_opcode) & mask_opcode;
 
   auto func3 = (instr_code >> shift_func3) & mask_func3;
   auto func7 = (instr_code >> shift_func7) & mask_func7;
 
   auto rd  = (instr_code >> shift_rd)  & mask_reg;
-  auto rs1 = (instr_code >> shift_rs1) & mask_reg;
   auto rs2 = (instr_code >> shift_rs2) & mask_reg;
 
-  auto op_it = sc_instTable.find(opcode);
-  if (op_it == sc_instTable.end()) {
-    std::cout << std::hex << "Error: invalid opcode: 0x" << static_cast<int>(opcode) << std::endl;
-    return nullptr;
-  }
-
-  ExeFlags exe_flags;
-  memset(&exe_flags, 0, sizeof(ExeFlags));
-  uint32_t imm = 0x0;
-
-  // instruction type decoding
-
-  auto inst_type = op_it->second;
-  switch (inst_type) {
-  case InstType::R:
-    exe_flags.use_rd  = 1;
-    exe_flags.use_rs1 = 1;
-    exe_flags.use_rs2 = 1;
-    break;
-
-  case InstType::I: {
-    switch (opcode) {
-    case Opcode::I:
-      exe_flags.use_rd  = 1;
-      exe_flags.use_rs1 = 1;
-      exe_flags.use_imm = 1;
-      exe_flags.alu_s2_imm = 1;
-      if (func3 == 0x1 || func3 == 0x5) {
-        // Shift instructions
-        imm = rs2;
-      } else {
-        auto imm12 = instr_code >> shift_rs2;
-        imm = sext(imm12, width_i_imm);
-      }
+  auto& entry = sc_decodeTable[decode_index(opcode, func3, func7, rs2)];
+  if ((opcode & 0x3) != 0x3 || !entry.valid)
+    return false;
+
+  // extract every immediate encoding and select by format
+  auto code = int32_t(instr_code);
+  uint32_t sign = uint32_t(code >> 31);
+  const uint32_t imms[int(ImmType::COUNT)] = {
+    0,
+    uint32_t(code >> 20),
+    rs2,
+    instr_code >> 20,
+    (uint32_t(code >> 20) & ~0x1fu) | rd,
+    (sign << 12) | ((instr_code >> 20) & 0x7e0) | ((instr_code >> 7) & 0x1e) | ((instr_code << 4) & 0x800),
+    instr_code & 0xfffff000,
+    (sign << 20) | ((instr_code >> 20) & 0x7fe) | ((instr_code >> 9) & 0x800) | (instr_code & 0xff000),
+  };
+  uint32_t imm = imms[int(entry.imm_type)];
+
+  auto exe_flags = entry.exe_flags;
+
+  // system instructions are told apart by their immediate
+  if (Opcode(opcode) == Opcode::SYS && func3 == 0) {
+    switch (imm) {
+    case 0x000: // RV32I: ECALL
+    case 0x001: // RV32I: EBREAK
+      exe_flags.is_exit = 1;
       break;
-    case Opcode::L:
-    case Opcode::JALR: {
-      exe_flags.use_rd  = 1;
-      exe_flags.use_rs1 = 1;
-      exe_flags.use_imm = 1;
-      exe_flags.alu_s2_imm = 1;
-      auto imm12 = instr_code >> shift_rs2;
-      imm = sext(imm12, width_i_imm);
-    } break;
-    case Opcode::SYS: {
-      exe_flags.use_imm = 1;
-      auto imm12 = instr_code >> shift_rs2;
-      if (func3 != 0) {
-        // CSR instructions
-        exe_flags.use_rd = 1;
-        if (func3 < 5) {
-          exe_flags.use_rs1 = 1;
-        }
-      }
-      imm = imm12;
-    } break;
-    case Opcode::FENCE:
+    case 0x002: // RV32I: URET
+    case 0x102: // RV32I: SRET
+    case 0x302: // RV32I: MRET
       break;
     default:
-      std::abort();
-      break;
+      return false;
     }
-  } break;
-  case InstType::S: {
-    exe_flags.use_rs1 = 1;
-    exe_flags.use_rs2 = 1;
-    exe_flags.use_imm = 1;
-    exe_flags.alu_s2_imm = 1;
-    auto imm12 = (func7 << width_reg) | rd;
-    imm = sext(imm12, width_i_imm);
-  } break;
-
-  case InstType::B: {
-    exe_flags.use_rs1 = 1;
-    exe_flags.use_rs2 = 1;
-    exe_flags.use_imm = 1;
-    exe_flags.alu_s2_imm = 1;
-    auto bit_11   = rd & 0x1;
-    auto bits_4_1 = rd >> 1;
-    auto bit_10_5 = func7 & 0x3f;
-    auto bit_12   = func7 >> 6;
-    auto imm12 = (bits_4_1 << 1) | (bit_10_5 << 5) | (bit_11 << 11) | (bit_12 << 12);
-    imm = sext(imm12, width_i_imm+1);
-  } break;
-
-  case InstType::U: {
-    exe_flags.use_rd  = 1;
-    exe_flags.use_imm = 1;
-    exe_flags.alu_s2_imm = 1;
-    auto imm20 = instr_code >> shift_func3;
-    imm = imm20 << shift_func3;
-  } break;
-
-  case InstType::J: {
-    exe_flags.use_rd  = 1;
-    exe_flags.use_imm = 1;
-    exe_flags.alu_s2_imm = 1;
-    auto unordered  = instr_code >> shift_func3;
-    auto bits_19_12 = unordered & 0xff;
-    auto bit_11     = (unordered >> 8) & 0x1;
-    auto bits_10_1  = (unordered >> 9) & 0x3ff;
-    auto bit_20     = (unordered >> 19) & 0x1;
-    auto imm20 = (bits_10_1 << 1) | (bit_11 << 11) | (bits_19_12 << 12) | (bit_20 << 20);
-    imm = sext(imm20, width_j_imm+1);
-  } break;
-
-  default:
-    std::abort();
   }
 
   // prevent write to x0
@@ -324,224 +486,94 @@ Instr::Ptr Core::decode(uint32_t instr_code, uint32_t PC, uint64_t uuid) const {
     exe_flags.use_rd = 0;
   }
 
-  // instruction opcode decoding
+  *instr = StaticInstr(PC, canonical);
+  instr->setImm(imm);
+  instr->setAluOp(entry.alu_op);
+  instr->setBrOp(entry.br_op);
+  instr->setExeFlags(exe_flags);
+  instr->setFUType(entry.fu_type);
 
-  AluOp alu_op = AluOp::NONE;
-  BrOp br_op = BrOp::NONE;
-  FUType fu_type = FUType::NONE;
+  return true;
+}
 
-  switch (opcode) {
-  case Opcode::LUI: {
-    // RV32I: LUI
-    alu_op = AluOp::ADD;
-    break;
-  }
-  case Opcode::AUIPC: {
-    // RV32I: AUIPC
-    alu_op = AluOp::ADD;
-    exe_flags.alu_s1_PC = 1;
-    break;
+bool fuse_instrs(const StaticInstr& first, const StaticInstr& second, uint32_t idioms,
+                 StaticInstr* fused, FuseType* type) {
+  // the second instruction must overwrite the first one's result,
+  // the intermediate value is then dead and a single write-back is enough.
+  auto rd = first.getRd();
+  if (!first.getExeFlags().use_rd
+   || !second.getExeFlags().use_rd
+   || second.getRd() != rd)
+    return false;
+
+  auto first_op  = first.getOpcode();
+  auto second_op = second.getOpcode();
+  auto code      = second.getCode();
+  auto imm       = second.getImm();
+  auto alu_op    = second.getAluOp();
+  auto exe_flags = second.getExeFlags();
+
+  bool first_upper = (first_op == Opcode::LUI || first_op == Opcode::AUIPC);
+  bool first_addi  = (first_op == Opcode::I && first.getAluOp() == AluOp::ADD);
+  bool first_add   = (first_op == Opcode::R && first.getAluOp() == AluOp::ADD);
+  bool first_slli  = (first_op == Opcode::I && first.getAluOp() == AluOp::SLL);
+  bool second_addi = (second_op == Opcode::I && alu_op == AluOp::ADD);
+  bool second_add  = (second_op == Opcode::R && alu_op == AluOp::ADD);
+  bool rs1_is_rd   = exe_flags.use_rs1 && second.getRs1() == rd;
+  bool rs2_is_rd   = exe_flags.use_rs2 && second.getRs2() == rd;
+
+  auto fuse_type = FuseType::NONE;
+  if ((idioms & FUSE_LUI_ADDI) && first_upper && second_addi && rs1_is_rd) {
+    fuse_type = FuseType::LUI_ADDI;
+  } else if ((idioms & FUSE_AUIPC_JALR) && first_op == Opcode::AUIPC && second_op == Opcode::JALR && rs1_is_rd) {
+    fuse_type = FuseType::AUIPC_JALR;
+  } else if ((idioms & FUSE_SLLI_ADD) && first_slli && first.getImm() >= 1 && first.getImm() <= 3
+          && second_add && (rs1_is_rd != rs2_is_rd)) {
+    fuse_type = FuseType::SLLI_ADD;
+  } else if ((idioms & FUSE_LOAD) && exe_flags.is_load && rs1_is_rd
+          && (first_upper || first_addi || (first_add && imm == 0))) {
+    fuse_type = FuseType::LOAD;
+  } else {
+    return false;
   }
-  case Opcode::R:
-  case Opcode::I: {
-    switch (func3) {
-    case 0: {
-      if (opcode == Opcode::R && func7) {
-        // RV32I: SUB
-        alu_op = AluOp::SUB;
-      } else {
-        // RV32I: ADD
-        alu_op = AluOp::ADD;
-      }
-      break;
-    }
-    case 1: {
-      // RV32I: SLL
-      alu_op = AluOp::SLL;
-      break;
-    }
-    case 2: {
-      // RV32I: SLT
-      alu_op = AluOp::LTI;
-      break;
-    }
-    case 3: {
-      // RV32I: SLTU
-      alu_op = AluOp::LTU;
-      break;
-    }
-    case 4: {
-      // RV32I: XOR
-      alu_op = AluOp::XOR;
-      break;
-    }
-    case 5: {
-      // RV32I: SRL, SRA
-      alu_op = func7 ? AluOp::SRA : AluOp::SRL;
-      break;
-    }
-    case 6: {
-      // RV32I: OR
-      alu_op = AluOp::OR;
-      break;
-    }
-    case 7: {
-      // RV32I: AND
-      alu_op = AluOp::AND;
-      break;
-    }
-    default:
-      std::abort();
-    }
-    break;
-  }
-  case Opcode::B: {
-    exe_flags.alu_s1_PC = 1;
-    alu_op = AluOp::ADD;
-    switch (func3) {
-    case 0: {
-      // RV32I: BEQ
-      br_op = BrOp::BEQ;
-      break;
-    }
-    case 1: {
-      // RV32I: BNE
-      br_op = BrOp::BNE;
-      break;
-    }
-    case 4: {
-      // RV32I: BLT
-      br_op = BrOp::BLT;
-      break;
-    }
-    case 5: {
-      // RV32I: BGE
-      br_op = BrOp::BGE;
-      break;
-    }
-    case 6: {
-      // RV32I: BLTU
-      br_op = BrOp::BLTU;
-      break;
-    }
-    case 7: {
-      // RV32I: BGEU
-      br_op = BrOp::BGEU;
-      break;
-    }
-    default:
-      std::abort();
-    }
-    break;
-  }
-  case Opcode::JAL: {
-    exe_flags.alu_s1_PC = 1;
-    alu_op = AluOp::ADD;
-    br_op = BrOp::JAL;
-    break;
-  }
-  case Opcode::JALR: {
-    alu_op = AluOp::ADD;
-    br_op = BrOp::JALR;
-    break;
-  }
-  case Opcode::L: {
-    // RV32I: LB, LH, LW, LBU, LHU
-    alu_op = AluOp::ADD;
-    exe_flags.is_load = 1;
-    break;
-  }
-  case Opcode::S: {
-    // RV32I: SB, SH, SW
-    alu_op = AluOp::ADD;
-    exe_flags.is_store = 1;
-    break;
-  }
-  case Opcode::SYS: {
-    if (func3 == 0) {
-      alu_op = AluOp::ADD;
-      switch (imm) {
-      case 0x000: // RV32I: ECALL
-      case 0x001: // RV32I: EBREAK
-        exe_flags.is_exit = 1;
-        break;
-      case 0x002: // RV32I: URET
-      case 0x102: // RV32I: SRET
-      case 0x302: // RV32I: MRET
-        break;
-      default:
-        std::abort();
-      }
-    } else {
-      exe_flags.is_csr = 1;
-      exe_flags.alu_s2_csr = 1;
-      switch (func3) {
-      case 1: {
-        // RV32I: CSRRW
-        alu_op = AluOp::ADD;
-        break;
-      }
-      case 2: {
-        // RV32I: CSRRS
-        alu_op = AluOp::OR;
-        break;
-      }
-      case 3: {
-        // RV32I: CSRRC
-        alu_op = AluOp::AND;
-        exe_flags.alu_s1_inv = 1;
-        break;
-      }
-      case 5: {
-        // RV32I: CSRRWI
-        alu_op = AluOp::ADD;
-        exe_flags.alu_s1_rs1 = 1;
-        break;
-      }
-      case 6: {
-        // RV32I: CSRRSI;
-        alu_op = AluOp::OR;
-        exe_flags.alu_s1_rs1 = 1;
-        break;
-      }
-      case 7: {
-        // RV32I: CSRRCI
-        alu_op = AluOp::AND;
-        exe_flags.alu_s1_inv = 1;
-        exe_flags.alu_s1_rs1 = 1;
-        break;
-      }
-      default:
-        std::abort();
-      }
-    }
-    break;
-  }
-  case Opcode::FENCE: {
-    // RV32I: FENCE
-    break;
-  }
-  default:
-    std::abort();
+
+  auto rs1_field = uint32_t(mask_reg) << shift_rs1;
+  auto rs2_field = uint32_t(mask_reg) << shift_rs2;
+
+  if (fuse_type == FuseType::SLLI_ADD) {
+    // rd = (rs1 << shamt) + rs2, encoded as the matching Zba SHnADD
+    auto shamt = first.getImm();
+    auto rs2 = rs1_is_rd ? second.getRs2() : second.getRs1();
+    auto func_field = (uint32_t(mask_func7) << shift_func7) | (uint32_t(mask_func3) << shift_func3);
+    code = (code & ~(rs1_field | rs2_field | func_field))
+         | (0x10 << shift_func7) | ((shamt * 2) << shift_func3)
+         | (first.getRs1() << shift_rs1) | (rs2 << shift_rs2);
+    alu_op = (shamt == 1) ? AluOp::SH1ADD : (shamt == 2) ? AluOp::SH2ADD : AluOp::SH3ADD;
+  } else if (first_upper) {
+    // the upper immediate becomes the base, relative to the PC for auipc
+    imm += first.getImm();
+    exe_flags.use_rs1 = 0;
+    exe_flags.alu_s1_PC = (first_op == Opcode::AUIPC);
+  } else if (first_addi) {
+    imm += first.getImm();
+    code = (code & ~rs1_field) | (first.getRs1() << shift_rs1);
+  } else {
+    // indexed load, the address is rs1 + rs2
+    code = (code & ~(rs1_field | rs2_field)) | (first.getRs1() << shift_rs1) | (first.getRs2() << shift_rs2);
+    exe_flags.use_rs2 = 1;
+    exe_flags.use_imm = 0;
+    exe_flags.alu_s2_imm = 0;
   }
 
-  // Functional unit type decoding
-  // assign fu_type based on the instruction type
-  // We will executre CSR instructions on the Special Function Unit (SFU).
-  // HINT: use the exe_flags as well
-  // TODO:
+  *fused = StaticInstr(first.getPC(), code);
+  fused->setImm(imm);
+  fused->setAluOp(alu_op);
+  fused->setBrOp(second.getBrOp());
+  fused->setExeFlags(exe_flags);
+  fused->setFUType(second.getFUType());
+  *type = fuse_type;
 
-  instr->setOpcode(opcode);
-  instr->setRd(rd);
-  instr->setSrc1(rs1);
-  instr->setSrc2(rs2);
-  instr->setImm(imm);
-  instr->setFunc3(func3);
-  instr->setFunc7(func7);
-  instr->setAluOp(alu_op);
-  instr->setBrOp(br_op);
-  instr->setExeFlags(exe_flags);
-  instr->setFUType(fu_type);
+  return true;
+}
 
-  return instr;
-}
\ No newline at end of file
+}
@@ -0,0 +1,132 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <unistd.h>
+#include <stdlib.h>
+#include "instr.h"
+
+using namespace tinyrv;
+
+static uint32_t num_instrs = 64 * 1024;
+static uint32_t num_passes = 100;
+
+static void show_usage() {
+  std::cout << "Usage: [-n: instructions] [-p: passes] [-h: help]" << std::endl;
+}
+
+static void parse_args(int argc, char **argv) {
+  int c;
+  while ((c = getopt(argc, argv, "n:p:h?")) != -1) {
+    switch (c) {
+    case 'n':
+      num_instrs = atoi(optarg);
+      break;
+    case 'p':
+      num_passes = atoi(optarg);
+      break;
+    case 'h':
+    case '?':
+      show_usage();
+      exit(0);
+      break;
+    default:
+      show_usage();
+      exit(-1);
+    }
+  }
+}
+
+// random valid RV32IM/Zba/Zbb instruction, weighted towards the common formats
+static uint32_t random_instr(std::mt19937& rng) {
+  static const uint32_t r_funcs[]   = {0x0000, 0x2000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x2005, 0x0006, 0x0007,
+                                       0x0100, 0x0101, 0x0102, 0x0103, 0x0104, 0x0105, 0x0106, 0x0107,
+                                       0x1002, 0x1004, 0x1006, 0x2004, 0x2006, 0x2007, 0x0504, 0x0505, 0x0506, 0x0507,
+                                       0x3001, 0x3005};
+  static const uint32_t i_func3[]   = {0, 2, 3, 4, 6, 7};
+  static const uint32_t b_func3[]   = {0, 1, 4, 5, 6, 7};
+  static const uint32_t l_func3[]   = {0, 1, 2, 4, 5};
+  static const uint32_t sys_func3[] = {1, 2, 3, 5, 6, 7};
+
+  uint32_t bits = rng();
+  uint32_t rd   = (bits >> 7)  & 0x1f;
+  uint32_t f3   = (bits >> 12) & 0x7;
+  uint32_t rs1  = (bits >> 15) & 0x1f;
+  uint32_t rs2  = (bits >> 20) & 0x1f;
+  uint32_t sel  = rng() % 16;
+
+  switch (sel) {
+  case 0: case 1: case 2: {
+    uint32_t func = r_funcs[rng() % 30];
+    return ((func >> 8) << 25) | (rs2 << 20) | (rs1 << 15) | ((func & 0x7) << 12) | (rd << 7) | 0x33;
+  }
+  case 3: case 4: case 5: {
+    if (rng() % 4 == 0) {
+      // shift immediate
+      uint32_t f7 = (rng() % 2) ? 0x20 : 0x00;
+      uint32_t f = (rng() % 2) ? 5 : 1;
+      return ((f == 5 ? f7 : 0) << 25) | (rs2 << 20) | (rs1 << 15) | (f << 12) | (rd << 7) | 0x13;
+    }
+    return (bits & 0xfff00000) | (rs1 << 15) | (i_func3[rng() % 6] << 12) | (rd << 7) | 0x13;
+  }
+  case 6: case 7:
+    return (bits & 0xfff00000) | (rs1 << 15) | (l_func3[rng() % 5] << 12) | (rd << 7) | 0x03;
+  case 8: case 9:
+    return (bits & 0xfe000f80) | (rs2 << 20) | (rs1 << 15) | ((f3 % 3) << 12) | 0x23;
+  case 10: case 11:
+    return (bits & 0xfe000f80) | (rs2 << 20) | (rs1 << 15) | (b_func3[rng() % 6] << 12) | 0x63;
+  case 12:
+    return (bits & 0xfffff000) | (rd << 7) | ((rng() % 2) ? 0x37 : 0x17);
+  case 13:
+    return (bits & 0xfffff000) | (rd << 7) | 0x6f;
+  case 14:
+    return (bits & 0xfff00000) | (rs1 << 15) | (rd << 7) | 0x67;
+  default:
+    return (bits & 0xfff00000) | (rs1 << 15) | (sys_func3[rng() % 6] << 12) | (rd << 7) | 0x73;
+  }
+}
+
+int main(int argc, char **argv) {
+  parse_args(argc, argv);
+
+  std::mt19937 rng(0x5eed);
+  std::vector<uint32_t> codes(num_instrs);
+  for (auto& code : codes) {
+    code = random_instr(rng);
+  }
+
+  StaticInstr instr(0, 0);
+  uint64_t checksum = 0;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint32_t pass = 0; pass < num_passes; ++pass) {
+    uint32_t PC = 0x80000000;
+    for (auto code : codes) {
+      if (!decode_instr(code, PC, &instr))
+        return -1;
+      checksum += instr.getImm() + uint32_t(instr.getAluOp()) + instr.getRd();
+      PC += 4;
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  double secs = std::chrono::duration<double>(end - start).count();
+  uint64_t total = uint64_t(num_instrs) * num_passes;
+  std::cout << "decoded " << total << " instructions in " << secs << "s ("
+            << (total / secs / 1e6) << " Minstr/s), checksum=0x" << std::hex << checksum << std::dec << std::endl;
+
+  return 0;
+}
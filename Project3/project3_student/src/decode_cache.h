@@ -0,0 +1,191 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <assert.h>
+#include <util.h>
+#include "instr.h"
+
+namespace tinyrv {
+
+// Direct-mapped cache of decoded instructions, stored by value.
+// Entries are indexed by PC and only hit if the canonical instruction word
+// still matches. Stores that fall within the range of pages holding
+// cached code drop the entries they overwrite.
+class DecodeCache {
+public:
+  struct PerfStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+
+    PerfStats()
+      : hits(0)
+      , misses(0)
+      , invalidations(0)
+    {}
+  };
+
+  DecodeCache(uint32_t size, uint32_t page_size)
+    : entries_(size)
+    , page_shift_(log2ceil(page_size)) {
+    assert(ispow2(size));
+    assert(ispow2(page_size));
+    this->reset();
+  }
+
+  ~DecodeCache() {}
+
+  void reset() {
+    for (auto& entry : entries_) {
+      entry = StaticInstr();
+    }
+    code_lo_ = ~uint64_t(0);
+    code_hi_ = 0;
+    perf_stats_ = PerfStats();
+  }
+
+  const StaticInstr* lookup(uint32_t PC, uint32_t code) {
+    auto& entry = entries_[this->index(PC)];
+    if (entry.valid() && entry.getPC() == PC && entry.getCode() == code) {
+      ++perf_stats_.hits;
+      return &entry;
+    }
+    ++perf_stats_.misses;
+    return nullptr;
+  }
+
+  const StaticInstr* insert(const StaticInstr& sinstr) {
+    auto& entry = entries_[this->index(sinstr.getPC())];
+    entry = sinstr;
+    uint64_t page = uint64_t(sinstr.getPC()) >> page_shift_;
+    code_lo_ = std::min(code_lo_, page);
+    code_hi_ = std::max(code_hi_, page);
+    return &entry;
+  }
+
+  // a store of the given size was made at addr
+  void invalidate(uint64_t addr, uint32_t size) {
+    uint64_t page = addr >> page_shift_;
+    if (page < code_lo_ || page > code_hi_)
+      return;
+    // a 32-bit instruction may start one halfword before the store
+    uint64_t start = addr & ~uint64_t(1);
+    if (start >= 2) {
+      start -= 2;
+    }
+    for (uint64_t PC = start; PC < addr + size; PC += 2) {
+      auto& entry = entries_[this->index(PC)];
+      if (entry.valid() && entry.getPC() == PC) {
+        entry = StaticInstr();
+        ++perf_stats_.invalidations;
+      }
+    }
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  uint32_t index(uint64_t PC) const {
+    return (PC >> 1) & (entries_.size() - 1);
+  }
+
+  std::vector<StaticInstr> entries_;
+  uint32_t  page_shift_;
+  uint64_t  code_lo_;
+  uint64_t  code_hi_;
+  PerfStats perf_stats_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Predecoded program image.
+// Every halfword of [base, end) is decoded once up front, as the start
+// of either a compressed or a 32-bit instruction, into a flat array indexed
+// by (PC - base) >> 1. The caller bounds the range, PCs outside it miss.
+// Positions that do not decode (data) are left empty, and a record is only
+// used while the fetched word still matches it, so self-modified code falls
+// back to the decode cache.
+class PredecodeTable {
+public:
+  struct PerfStats {
+    uint64_t hits;
+    uint64_t misses;
+
+    PerfStats()
+      : hits(0)
+      , misses(0)
+    {}
+  };
+
+  PredecodeTable() : base_(0), decoded_(0) {}
+
+  ~PredecodeTable() {}
+
+  template <typename Mem>
+  void load(Mem& mem, uint64_t base, uint64_t end) {
+    base_ = base & ~uint64_t(1);
+    entries_.assign((end > base_) ? (end - base_ + 1) / 2 : 0, StaticInstr());
+    decoded_ = 0;
+    for (uint32_t i = 0; i < entries_.size(); ++i) {
+      uint32_t PC = base_ + i * 2;
+      uint32_t code = 0;
+      mem.read(&code, PC, sizeof(uint32_t));
+      if (decode_instr(code, PC, &entries_[i])) {
+        ++decoded_;
+      } else {
+        entries_[i] = StaticInstr();
+      }
+    }
+  }
+
+  // the table outlives a reset, it is rebuilt by load() only
+  void reset_stats() {
+    perf_stats_ = PerfStats();
+  }
+
+  const StaticInstr* lookup(uint32_t PC, uint32_t code) {
+    uint64_t index = (uint64_t(PC) - base_) >> 1;
+    if (index < entries_.size()) {
+      auto& entry = entries_[index];
+      if (entry.valid() && entry.getCode() == code) {
+        ++perf_stats_.hits;
+        return &entry;
+      }
+    }
+    ++perf_stats_.misses;
+    return nullptr;
+  }
+
+  uint32_t decoded() const {
+    return decoded_;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  uint64_t base_;
+  uint32_t decoded_;
+  std::vector<StaticInstr> entries_;
+  PerfStats perf_stats_;
+};
+
+}
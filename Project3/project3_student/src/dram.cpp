@@ -0,0 +1,134 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include "types.h"
+#include "debug.h"
+#include "dram.h"
+
+using namespace tinyrv;
+
+DramController::DramController(const SimContext& ctx, const char* name, const Config& config)
+  : SimObject(ctx, name)
+  , MemReqPort(this)
+  , MemRspPort(this)
+  , config_(config)
+  , banks_(config.num_banks)
+  , block_shift_(log2ceil(config.block_size))
+  , bank_shift_(log2ceil(config.num_banks))
+  , row_shift_(log2ceil(config.row_size / config.block_size)) {
+  assert(ispow2(config.num_banks));
+  assert(ispow2(config.block_size));
+  assert(ispow2(config.row_size));
+  assert(config.row_size >= config.block_size);
+  assert(config.queue_size != 0);
+  this->reset();
+}
+
+DramController::~DramController() {
+  //--
+}
+
+void DramController::reset() {
+  for (auto& bank : banks_) {
+    bank = {false, 0, 0};
+  }
+  queue_.clear();
+  while (!MemReqPort.empty()) {
+    MemReqPort.pop();
+  }
+  perf_stats_ = PerfStats();
+}
+
+uint32_t DramController::bank_index(uint64_t addr) const {
+  // consecutive blocks map to consecutive banks
+  return (addr >> block_shift_) & (config_.num_banks - 1);
+}
+
+uint64_t DramController::row_index(uint64_t addr) const {
+  return addr >> (block_shift_ + bank_shift_ + row_shift_);
+}
+
+void DramController::tick() {
+  auto cycles = SimPlatform::instance().cycles();
+
+  // accept incoming requests,
+  // requests left in the port are retried next cycle.
+  while (!MemReqPort.empty()) {
+    if (queue_.size() >= config_.queue_size) {
+      ++perf_stats_.queue_full;
+      break;
+    }
+    auto& req = MemReqPort.front();
+    queue_.push_back({req, this->bank_index(req.addr), this->row_index(req.addr), cycles});
+    DT(3, this->name() << "-req: " << req);
+    MemReqPort.pop();
+  }
+
+  // issue to every idle bank
+  for (uint32_t b = 0; b < banks_.size(); ++b) {
+    if (banks_[b].busy_until <= cycles) {
+      this->schedule(b, cycles);
+    }
+  }
+}
+
+void DramController::schedule(uint32_t bank_id, uint64_t cycles) {
+  auto& bank = banks_.at(bank_id);
+
+  // FR-FCFS: pick the oldest row-hit, otherwise the oldest request
+  auto selected = queue_.end();
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    if (it->bank != bank_id)
+      continue;
+    if (bank.row_open && it->row == bank.open_row) {
+      selected = it;
+      break;
+    }
+    if (selected == queue_.end()) {
+      selected = it;
+    }
+  }
+  if (selected == queue_.end())
+    return;
+
+  uint32_t latency;
+  if (bank.row_open && selected->row == bank.open_row) {
+    latency = config_.tCAS;
+    ++perf_stats_.row_hits;
+  } else if (!bank.row_open) {
+    latency = config_.tRCD + config_.tCAS;
+    ++perf_stats_.row_misses;
+  } else {
+    latency = config_.tRP + config_.tRCD + config_.tCAS;
+    ++perf_stats_.row_conflicts;
+  }
+
+  bank.row_open   = true;
+  bank.open_row   = selected->row;
+  bank.busy_until = cycles + latency;
+
+  if (selected->req.write) {
+    ++perf_stats_.writes;
+  } else {
+    ++perf_stats_.reads;
+  }
+  perf_stats_.total_latency += (cycles - selected->arrival) + latency;
+
+  DT(3, this->name() << "-rsp: bank=" << bank_id << ", row=" << selected->row << ", latency=" << latency << ", " << selected->req);
+  MemRspPort.send(MemRsp{selected->req.tag}, latency);
+
+  queue_.erase(selected);
+}
@@ -0,0 +1,103 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <list>
+#include <simobject.h>
+#include "types.h"
+
+namespace tinyrv {
+
+// Banked DRAM controller with open-page row buffers.
+// Blocks are interleaved across banks, requests are queued and scheduled
+// using FR-FCFS (oldest row-hit first, then oldest request) on every idle bank.
+class DramController : public SimObject<DramController> {
+public:
+  struct Config {
+    uint32_t num_banks;   // number of banks
+    uint32_t block_size;  // interleaving granularity (bytes)
+    uint32_t row_size;    // row buffer size per bank (bytes)
+    uint32_t queue_size;  // request queue capacity
+    uint32_t tCAS;        // column access latency
+    uint32_t tRCD;        // row activate latency
+    uint32_t tRP;         // row precharge latency
+  };
+
+  struct PerfStats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t row_hits;
+    uint64_t row_misses;
+    uint64_t row_conflicts;
+    uint64_t total_latency;
+    uint64_t queue_full;
+
+    PerfStats()
+      : reads(0)
+      , writes(0)
+      , row_hits(0)
+      , row_misses(0)
+      , row_conflicts(0)
+      , total_latency(0)
+      , queue_full(0)
+    {}
+  };
+
+  SimPort<MemReq> MemReqPort;
+  SimPort<MemRsp> MemRspPort;
+
+  DramController(const SimContext& ctx, const char* name, const Config& config);
+
+  ~DramController();
+
+  void reset();
+
+  void tick();
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  struct bank_t {
+    bool     row_open;    // row buffer holds an open row
+    uint64_t open_row;    // open row index
+    uint64_t busy_until;  // cycle the bank becomes idle
+  };
+
+  struct entry_t {
+    MemReq   req;
+    uint32_t bank;
+    uint64_t row;
+    uint64_t arrival;
+  };
+
+  uint32_t bank_index(uint64_t addr) const;
+
+  uint64_t row_index(uint64_t addr) const;
+
+  void schedule(uint32_t bank_id, uint64_t cycles);
+
+  Config config_;
+  std::vector<bank_t> banks_;
+  std::list<entry_t> queue_;
+  uint32_t block_shift_;
+  uint32_t bank_shift_;
+  uint32_t row_shift_;
+  PerfStats perf_stats_;
+};
+
+}
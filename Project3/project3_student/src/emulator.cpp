@@ -0,0 +1,608 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <util.h>
+#include "emulator.h"
+#include "core.h"
+#include "debug.h"
+#include "FU.h"
+#include "checker.h"
+
+using namespace tinyrv;
+
+Emulator::Emulator(Core* core)
+  : core_(core)
+  , reg_file_(NUM_REGS + 1)
+  , warming_(false)
+  , yield_(false)
+  , bbv_(false)
+  , block_cache_(BLOCK_ENTRIES)
+  , code_pages_(1 << (32 - PAGE_BITS))
+{
+  this->reset();
+}
+
+Emulator::~Emulator() {}
+
+void Emulator::attach_ram(RAM* ram) {
+  dbt_.reset(new Dbt(this, ram));
+  if (!dbt_->enabled()) {
+    dbt_ = nullptr;
+  }
+}
+
+void Emulator::reset() {
+  std::fill(reg_file_.begin(), reg_file_.end(), 0);
+  PC_ = STARTUP_ADDR;
+  exited_ = false;
+  this->flush_blocks();
+  bbv_ids_.clear();
+  bbv_counts_.clear();
+  if (dbt_) {
+    dbt_->reset();
+  }
+  perf_stats_ = PerfStats();
+}
+
+void Emulator::predecode(Word PC, emu_instr_t* entry) {
+  // 16-bit instructions only use the low half
+  uint32_t instr_code = 0;
+  core_->mmu_.read(&instr_code, PC, sizeof(instr_code), 0);
+  auto instr = core_->decode_static(instr_code, PC);
+  if (!instr) {
+    std::cout << std::hex << "Error: invalid instruction: 0x" << instr_code << ", PC=0x" << PC << std::dec << std::endl;
+    std::abort();
+  }
+
+  auto exe_flags = instr->getExeFlags();
+  auto opcode = instr->getOpcode();
+  auto func3 = instr->getFunc3();
+  auto imm = instr->getImm();
+
+  // select the inline handler, if any
+  EmuOp op = EmuOp::ALU;
+  bool plain_alu = !exe_flags.alu_s1_inv && !exe_flags.alu_s1_rs1 && !exe_flags.alu_s1_PC;
+  switch (opcode) {
+  case Opcode::R:
+  case Opcode::I: {
+    if (!plain_alu)
+      break;
+    bool is_imm = (opcode == Opcode::I);
+    switch (instr->getAluOp()) {
+    case AluOp::ADD: op = is_imm ? EmuOp::ADDI : EmuOp::ADD; break;
+    case AluOp::SUB: op = is_imm ? EmuOp::ALU : EmuOp::SUB; break;
+    case AluOp::AND: op = is_imm ? EmuOp::ANDI : EmuOp::AND; break;
+    case AluOp::OR:  op = is_imm ? EmuOp::ORI : EmuOp::OR; break;
+    case AluOp::XOR: op = is_imm ? EmuOp::XORI : EmuOp::XOR; break;
+    case AluOp::SLL: op = is_imm ? EmuOp::SLLI : EmuOp::SLL; break;
+    case AluOp::SRL: op = is_imm ? EmuOp::SRLI : EmuOp::SRL; break;
+    case AluOp::SRA: op = is_imm ? EmuOp::SRAI : EmuOp::SRA; break;
+    case AluOp::LTI: op = is_imm ? EmuOp::SLTI : EmuOp::SLT; break;
+    case AluOp::LTU: op = is_imm ? EmuOp::SLTIU : EmuOp::SLTU; break;
+    default:
+      break;
+    }
+  } break;
+  case Opcode::LUI:
+    op = EmuOp::LI;
+    break;
+  case Opcode::AUIPC:
+    op = EmuOp::LI;
+    imm += PC;
+    break;
+  case Opcode::L: {
+    static const EmuOp load_ops[] = {EmuOp::LB, EmuOp::LH, EmuOp::LW, EmuOp::ALU, EmuOp::LBU, EmuOp::LHU, EmuOp::ALU, EmuOp::ALU};
+    op = load_ops[func3];
+  } break;
+  case Opcode::S: {
+    static const EmuOp store_ops[] = {EmuOp::SB, EmuOp::SH, EmuOp::SW, EmuOp::ALU, EmuOp::ALU, EmuOp::ALU, EmuOp::ALU, EmuOp::ALU};
+    op = store_ops[func3];
+  } break;
+  case Opcode::B: {
+    static const EmuOp branch_ops[] = {EmuOp::BEQ, EmuOp::BNE, EmuOp::ALU, EmuOp::ALU, EmuOp::BLT, EmuOp::BGE, EmuOp::BLTU, EmuOp::BGEU};
+    op = branch_ops[func3];
+    imm += PC;
+  } break;
+  case Opcode::JAL:
+    op = EmuOp::JAL;
+    imm += PC;
+    break;
+  case Opcode::JALR:
+    op = EmuOp::JALR;
+    break;
+  default:
+    if (exe_flags.is_exit) {
+      op = EmuOp::EXIT;
+    } else if (exe_flags.is_csr) {
+      op = EmuOp::CSR;
+    }
+    break;
+  }
+  if (op == EmuOp::ALU && (exe_flags.is_load || exe_flags.is_store || instr->getBrOp() != BrOp::NONE)) {
+    std::cout << std::hex << "Error: unsupported instruction: 0x" << instr_code << ", PC=0x" << PC << std::dec << std::endl;
+    std::abort();
+  }
+
+  // x0 reads as zero, unused sources read x0 as well
+  entry->op   = op;
+  entry->handler = nullptr;
+  entry->PC   = PC;
+  entry->imm  = imm;
+  entry->rd   = (exe_flags.use_rd && instr->getRd() != 0) ? instr->getRd() : SINK_REG;
+  entry->rs1  = exe_flags.use_rs1 ? instr->getRs1() : 0;
+  entry->rs2  = exe_flags.use_rs2 ? instr->getRs2() : 0;
+  entry->size = instr->getSize();
+  entry->instr = *instr;
+}
+
+Emulator::emu_block_t* Emulator::lookup_block(Word PC, const void* const* handlers) {
+  auto& entry = block_cache_[(PC >> 1) % BLOCK_ENTRIES];
+  if (entry.first == PC)
+    return entry.second;
+  auto it = blocks_.find(PC);
+  auto block = (it != blocks_.end()) ? it->second.get() : this->build_block(PC, handlers);
+  entry = std::make_pair(PC, block);
+  return block;
+}
+
+Emulator::emu_block_t* Emulator::build_block(Word PC, const void* const* handlers) {
+  auto block = new emu_block_t();
+  block->PC = PC;
+  block->succ_PC = 1;
+
+  // decode up to the first control transfer or exit
+  Word next_PC = PC;
+  for (;;) {
+    emu_instr_t instr;
+    this->predecode(next_PC, &instr);
+    instr.handler = handlers ? handlers[int(instr.op)] : nullptr;
+    this->mark_code(next_PC, instr.size);
+    next_PC += instr.size;
+    auto op = instr.op;
+    block->loads    += (op >= EmuOp::LB && op <= EmuOp::LHU);
+    block->stores   += (op >= EmuOp::SB && op <= EmuOp::SW);
+    block->branches += (op >= EmuOp::BEQ && op <= EmuOp::JALR);
+    block->instrs.push_back(std::move(instr));
+    if ((op >= EmuOp::BEQ && op <= EmuOp::JALR)
+     || op == EmuOp::EXIT
+     || block->instrs.size() == MAX_BLOCK_SIZE)
+      break;
+  }
+  block->n = block->instrs.size();
+
+  blocks_[PC].reset(block);
+  ++perf_stats_.blocks;
+  return block;
+}
+
+void Emulator::extend_block(emu_block_t* block, const void* const* handlers) {
+  if (block->n >= MAX_SUPERBLOCK_SIZE)
+    return;
+  auto succ = this->lookup_block(block->succ_PC, handlers);
+
+  // copy first, the successor may be the block itself
+  uint32_t count = std::min(succ->n, MAX_SUPERBLOCK_SIZE - block->n);
+  std::vector<emu_instr_t> tail(succ->instrs.begin(), succ->instrs.begin() + count);
+  for (auto& instr : tail) {
+    auto op = instr.op;
+    block->loads    += (op >= EmuOp::LB && op <= EmuOp::LHU);
+    block->stores   += (op >= EmuOp::SB && op <= EmuOp::SW);
+    block->branches += (op >= EmuOp::BEQ && op <= EmuOp::JALR);
+  }
+  block->instrs.insert(block->instrs.end(), tail.begin(), tail.end());
+  block->n += count;
+  block->superblock = true;
+  ++perf_stats_.superblocks;
+}
+
+void Emulator::mark_code(Word PC, uint32_t size) {
+  for (Word addr = PC; addr < PC + size; addr += 2) {
+    uint32_t page = addr >> PAGE_BITS;
+    code_pages_[page] = true;
+    code_map_[page].set((addr & ((1 << PAGE_BITS) - 1)) >> 1);
+  }
+  if (dbt_) {
+    dbt_->mark_code(PC, size);
+  }
+}
+
+void Emulator::flush_blocks() {
+  if (bbv_) {
+    this->fold_bbv();
+  }
+  blocks_.clear();
+  std::fill(block_cache_.begin(), block_cache_.end(), std::make_pair(Word(1), (emu_block_t*)nullptr));
+  for (auto& page : code_map_) {
+    code_pages_[page.first] = false;
+  }
+  code_map_.clear();
+  blocks_dirty_ = false;
+}
+
+void Emulator::fold_bbv() {
+  for (auto& it : blocks_) {
+    auto& block = *it.second;
+    uint64_t count = block.retired - block.bbv_mark;
+    if (count == 0)
+      continue;
+    auto id = bbv_ids_.emplace(block.PC, uint32_t(bbv_ids_.size() + 1)).first->second;
+    bbv_counts_[id] += count;
+    block.bbv_mark = block.retired;
+  }
+}
+
+void Emulator::collect_bbv(std::vector<std::pair<uint32_t, uint64_t>>* bbv) {
+  this->fold_bbv();
+  bbv->assign(bbv_counts_.begin(), bbv_counts_.end());
+  bbv_counts_.clear();
+}
+
+std::vector<Emulator::BlockProfile> Emulator::block_profile() const {
+  std::vector<BlockProfile> profile;
+  for (auto& it : blocks_) {
+    auto& block = *it.second;
+    profile.push_back({block.PC, block.n, block.loads, block.stores, block.branches,
+                       block.execs, block.retired, block.superblock});
+  }
+  std::sort(profile.begin(), profile.end(), [](const BlockProfile& a, const BlockProfile& b) {
+    return (a.retired != b.retired) ? (a.retired > b.retired) : (a.PC < b.PC);
+  });
+  return profile;
+}
+
+bool Emulator::step() {
+  this->run(1);
+  return !exited_;
+}
+
+uint64_t Emulator::run(uint64_t max_instrs) {
+  auto start_time = std::chrono::steady_clock::now();
+
+  // hot blocks run translated, the interpreter covers the rest
+  // up to the next control transfer
+  uint64_t executed = 0;
+  yield_ = false;
+  while (executed < max_instrs && !exited_ && !yield_) {
+    if (dbt_ && !warming_ && !bbv_) {
+      executed += dbt_->execute(max_instrs - executed);
+      if (executed == max_instrs)
+        break;
+    }
+    executed += this->interpret(max_instrs - executed, dbt_ && !warming_ && !bbv_);
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+  perf_stats_.host_time += elapsed.count();
+  return executed;
+}
+
+uint64_t Emulator::interpret(uint64_t max_instrs, bool stop_at_branch) {
+  if (exited_)
+    return 0;
+
+  Word* regs = reg_file_.data();
+  Word PC = PC_;
+  uint64_t budget = max_instrs;
+  uint64_t loads = 0, stores = 0, branches = 0;
+  emu_block_t* block;
+  const emu_instr_t* ins;
+  uint32_t entered, left;  // instructions allowed in this visit, and still to go
+
+#if EMU_THREADED
+  static const void* const handlers[] = {
+  #define EMU_OP_LABEL(op) &&op_##op,
+    EMU_OPS(EMU_OP_LABEL)
+  #undef EMU_OP_LABEL
+  };
+#else
+  const void* const* handlers = nullptr;
+#endif
+
+block_start:
+  // only the emulator writes memory while it runs, a store overwriting
+  // cached code ends its block and the cache is dropped here
+  if (blocks_dirty_) {
+    this->flush_blocks();
+  }
+  block = this->lookup_block(PC, handlers);
+  ++block->execs;
+  entered = left = uint32_t(std::min<uint64_t>(block->n, budget));
+  ins = block->instrs.data();
+
+  #define EMU_TRACE() \
+    DP(3, "EMU: PC=0x" << std::hex << PC << ", code=0x" << ins->instr.getCode() << std::dec << ", alu_op=" << ins->instr.getAluOp() << ", br_op=" << ins->instr.getBrOp())
+
+#if EMU_THREADED
+  #define EMU_CASE(op) op_##op:
+  #define EMU_DISPATCH() do { EMU_TRACE(); goto *ins->handler; } while (0)
+  EMU_DISPATCH();
+  {
+#else
+  #define EMU_CASE(op) case EmuOp::op:
+  #define EMU_DISPATCH() goto dispatch
+dispatch:
+  EMU_TRACE();
+  switch (ins->op) {
+#endif
+
+  // straight-line code runs on to the next instruction of the block
+  #define EMU_NEXT() \
+    do { \
+      if (--left == 0) \
+        goto block_end; \
+      ++ins; \
+      EMU_DISPATCH(); \
+    } while (0)
+
+  // a control transfer stays in a superblock only along the path it was
+  // built for, any other target is a side exit
+  #define EMU_NEXT_PC() \
+    do { \
+      if (--left == 0 || ins[1].PC != PC) \
+        goto block_end; \
+      ++ins; \
+      EMU_DISPATCH(); \
+    } while (0)
+
+  #define EMU_RR(op, expr) \
+    EMU_CASE(op) { \
+      Word a = regs[ins->rs1], b = regs[ins->rs2]; \
+      regs[ins->rd] = (expr); \
+      PC += ins->size; \
+    } EMU_NEXT();
+
+  #define EMU_RI(op, expr) \
+    EMU_CASE(op) { \
+      Word a = regs[ins->rs1], b = ins->imm; \
+      regs[ins->rd] = (expr); \
+      PC += ins->size; \
+    } EMU_NEXT();
+
+  #define EMU_LOAD(op, type) \
+    EMU_CASE(op) { \
+      Word addr = regs[ins->rs1] + ins->imm; \
+      type data = 0; \
+      this->dmem_read(&data, addr, sizeof(type)); \
+      if (warming_) \
+        core_->warm_mem(addr, sizeof(type), false); \
+      regs[ins->rd] = data; \
+      ++loads; \
+      PC += ins->size; \
+    } EMU_NEXT();
+
+  #define EMU_STORE(op, type) \
+    EMU_CASE(op) { \
+      Word addr = regs[ins->rs1] + ins->imm; \
+      type data = regs[ins->rs2]; \
+      this->dmem_write(&data, addr, sizeof(type)); \
+      if (warming_) \
+        core_->warm_mem(addr, sizeof(type), true); \
+      ++stores; \
+      PC += ins->size; \
+      if (blocks_dirty_) { \
+        --left; \
+        goto block_end; \
+      } \
+    } EMU_NEXT();
+
+  #define EMU_BRANCH(op, cond) \
+    EMU_CASE(op) { \
+      Word a = regs[ins->rs1], b = regs[ins->rs2]; \
+      bool taken = (cond); \
+      PC = taken ? ins->imm : (PC + ins->size); \
+      if (warming_) \
+        core_->warm_branch(ins->PC, PC, taken); \
+      ++branches; \
+    } EMU_NEXT_PC();
+
+    EMU_RR(ADD,  a + b)
+    EMU_RR(SUB,  a - b)
+    EMU_RR(AND,  a & b)
+    EMU_RR(OR,   a | b)
+    EMU_RR(XOR,  a ^ b)
+    EMU_RR(SLL,  a << (b & 0x1f))
+    EMU_RR(SRL,  a >> (b & 0x1f))
+    EMU_RR(SRA,  Word(int32_t(a) >> (b & 0x1f)))
+    EMU_RR(SLT,  int32_t(a) < int32_t(b))
+    EMU_RR(SLTU, a < b)
+
+    EMU_RI(ADDI,  a + b)
+    EMU_RI(ANDI,  a & b)
+    EMU_RI(ORI,   a | b)
+    EMU_RI(XORI,  a ^ b)
+    EMU_RI(SLLI,  a << (b & 0x1f))
+    EMU_RI(SRLI,  a >> (b & 0x1f))
+    EMU_RI(SRAI,  Word(int32_t(a) >> (b & 0x1f)))
+    EMU_RI(SLTI,  int32_t(a) < int32_t(b))
+    EMU_RI(SLTIU, a < b)
+
+    EMU_CASE(LI) {
+      regs[ins->rd] = ins->imm;
+      PC += ins->size;
+    } EMU_NEXT();
+
+    EMU_LOAD(LB,  int8_t)
+    EMU_LOAD(LH,  int16_t)
+    EMU_LOAD(LW,  uint32_t)
+    EMU_LOAD(LBU, uint8_t)
+    EMU_LOAD(LHU, uint16_t)
+
+    EMU_STORE(SB, uint8_t)
+    EMU_STORE(SH, uint16_t)
+    EMU_STORE(SW, uint32_t)
+
+    EMU_BRANCH(BEQ,  a == b)
+    EMU_BRANCH(BNE,  a != b)
+    EMU_BRANCH(BLT,  int32_t(a) < int32_t(b))
+    EMU_BRANCH(BGE,  int32_t(a) >= int32_t(b))
+    EMU_BRANCH(BLTU, a < b)
+    EMU_BRANCH(BGEU, a >= b)
+
+    EMU_CASE(JAL) {
+      regs[ins->rd] = PC + ins->size;
+      PC = ins->imm;
+      if (warming_)
+        core_->warm_branch(ins->PC, PC, true);
+      ++branches;
+    } EMU_NEXT_PC();
+
+    EMU_CASE(JALR) {
+      Word target = (regs[ins->rs1] + ins->imm) & ~Word(1);
+      regs[ins->rd] = PC + ins->size;
+      PC = target;
+      if (warming_)
+        core_->warm_branch(ins->PC, PC, true);
+      ++branches;
+    } EMU_NEXT_PC();
+
+    EMU_CASE(ALU) {
+      regs[ins->rd] = execute_alu_op(ins->instr, regs[ins->rs1], regs[ins->rs2]);
+      PC += ins->size;
+    } EMU_NEXT();
+
+    EMU_CASE(CSR) {
+      // the CSR counters see the instructions retired so far
+      uint32_t csr_data = this->get_csr(ins->imm, perf_stats_.instrs + (max_instrs - budget) + (entered - left));
+      uint32_t new_data = execute_alu_op(ins->instr, regs[ins->rs1], csr_data);
+      if (new_data != csr_data) {
+        core_->set_csr(ins->imm, new_data, 0);
+      }
+      regs[ins->rd] = csr_data;
+      PC += ins->size;
+      // a simulator mode switch returns to the processor
+      if (yield_) {
+        --left;
+        goto block_end;
+      }
+    } EMU_NEXT();
+
+    EMU_CASE(EXIT) {
+      PC += ins->size;
+      exited_ = true;
+      --left;
+    } goto block_end;
+  }
+
+  #undef EMU_RR
+  #undef EMU_RI
+  #undef EMU_LOAD
+  #undef EMU_STORE
+  #undef EMU_BRANCH
+  #undef EMU_CASE
+  #undef EMU_NEXT
+  #undef EMU_NEXT_PC
+  #undef EMU_DISPATCH
+  #undef EMU_TRACE
+
+block_end:
+  budget -= entered - left;
+  block->retired += entered - left;
+  if (!exited_ && left == 0 && entered == block->n && !block->superblock && !bbv_) {
+    // Boyer-Moore vote over the successors, a block whose majority
+    // successor held through its first executions is extended along it
+    if (PC == block->succ_PC) {
+      ++block->succ_votes;
+    } else if (block->succ_votes == 0) {
+      block->succ_PC = PC;
+      block->succ_votes = 1;
+    } else {
+      --block->succ_votes;
+    }
+    if (block->execs == EMU_SUPERBLOCK_THRESHOLD
+     && 2 * block->succ_votes >= block->execs) {
+      this->extend_block(block, handlers);
+    }
+  }
+  if (!exited_ && budget != 0 && !stop_at_branch && !yield_)
+    goto block_start;
+
+  uint64_t executed = max_instrs - budget;
+  PC_ = PC;
+  perf_stats_.instrs   += executed;
+  perf_stats_.loads    += loads;
+  perf_stats_.stores   += stores;
+  perf_stats_.branches += branches;
+  return executed;
+}
+
+bool Emulator::check_exit(Word* exitcode, bool riscv_test) const {
+  if (!exited_)
+    return false;
+  Word ec = reg_file_.at(3);
+  *exitcode = riscv_test ? (1 - ec) : ec;
+  return true;
+}
+
+void Emulator::handoff() {
+  std::copy(reg_file_.begin(), reg_file_.begin() + NUM_REGS, core_->reg_file_.begin());
+  core_->PC_ = PC_;
+  core_->fetch_buf_.reset();
+  core_->draining_ = false;
+  if (core_->checker_) {
+    core_->checker_->sync(perf_stats_.instrs + core_->perf_stats_.instrs, PC_, reg_file_);
+  }
+  DP(2, "EMU: handoff at PC=0x" << std::hex << PC_ << std::dec << " after " << perf_stats_.instrs << " instructions");
+}
+
+void Emulator::takeover() {
+  std::copy(core_->reg_file_.begin(), core_->reg_file_.end(), reg_file_.begin());
+  PC_ = core_->PC_;
+  // the core's stores may have overwritten cached code
+  this->flush_blocks();
+  if (dbt_) {
+    dbt_->flush();
+  }
+  DP(2, "EMU: takeover at PC=0x" << std::hex << PC_ << std::dec << " after " << perf_stats_.instrs << " instructions");
+}
+
+uint32_t Emulator::get_csr(uint32_t addr, uint64_t instrs) const {
+  // one instruction per cycle
+  switch (addr) {
+  case VX_CSR_MCYCLE:
+  case VX_CSR_MINSTRET:
+    return instrs & 0xffffffff;
+  case VX_CSR_MCYCLE_H:
+  case VX_CSR_MINSTRET_H:
+    return (uint32_t)(instrs >> 32);
+  default:
+    return core_->get_csr(addr);
+  }
+}
+
+void Emulator::dmem_read(void* data, uint64_t addr, uint32_t size) {
+  core_->mmu_.read(data, addr, size, 0);
+}
+
+void Emulator::dmem_write(const void* data, uint64_t addr, uint32_t size) {
+  if (addr >= uint64_t(IO_COUT_ADDR)
+   && addr < (uint64_t(IO_COUT_ADDR) + IO_COUT_SIZE)) {
+    core_->writeToStdOut(data);
+  } else {
+    core_->mmu_.write(data, addr, size, 0);
+    if (dbt_) {
+      dbt_->invalidate(addr, size);
+    }
+    // a write over cached code drops the blocks at the next block boundary
+    for (uint64_t a = addr & ~uint64_t(1); a < addr + size; a += 2) {
+      uint32_t page = uint32_t(a) >> PAGE_BITS;
+      if (code_pages_[page]
+       && code_map_[page].test((a & ((1 << PAGE_BITS) - 1)) >> 1)) {
+        blocks_dirty_ = true;
+        break;
+      }
+    }
+  }
+}
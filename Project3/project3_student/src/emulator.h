@@ -0,0 +1,246 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <bitset>
+#include <map>
+#include <unordered_map>
+#include "types.h"
+#include "instr.h"
+#include "dbt.h"
+
+namespace tinyrv {
+
+class Core;
+
+// Functional instruction-set simulator.
+// Executes the program with the core's decoder, ALU/branch kernels and
+// memory, but keeps its own registers and PC and bypasses the ROB,
+// reservation stations and caches. Its architectural state can be handed
+// off to the timing core at any instruction boundary.
+//
+// Instructions are predecoded once into basic blocks keyed by their entry
+// PC, each holding a handler and the extracted operands per instruction.
+// With EMU_THREADED each handler jumps straight to the next instruction's
+// handler through its label address (GCC computed goto), otherwise a
+// portable switch loop dispatches them. A block whose successor is biased
+// is extended along it into a superblock, the control transfers inside it
+// leave through a side exit when they go the other way. With EMU_DBT hot
+// blocks run as translated host code instead (dbt.h).
+class Emulator {
+public:
+  struct PerfStats {
+    uint64_t instrs;
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t branches;
+    uint64_t blocks;       // blocks decoded
+    uint64_t superblocks;  // blocks extended along their successor
+    double   host_time;    // seconds spent in run()
+
+    PerfStats()
+      : instrs(0)
+      , loads(0)
+      , stores(0)
+      , branches(0)
+      , blocks(0)
+      , superblocks(0)
+      , host_time(0)
+    {}
+  };
+
+  // execution profile of a cached block
+  struct BlockProfile {
+    Word     PC;
+    uint32_t instrs;    // static instruction mix
+    uint32_t loads;
+    uint32_t stores;
+    uint32_t branches;
+    uint64_t execs;     // times entered
+    uint64_t retired;   // instructions executed from it
+    bool     superblock;
+  };
+
+  Emulator(Core* core);
+  ~Emulator();
+
+  // memory the translated code accesses directly
+  void attach_ram(RAM* ram);
+
+  void reset();
+
+  // execute one instruction, returns false once the program has exited
+  bool step();
+
+  // execute up to max_instrs instructions or until the program exits,
+  // returns the number of instructions executed
+  uint64_t run(uint64_t max_instrs);
+
+  bool exited() const {
+    return exited_;
+  }
+
+  bool check_exit(Word* exitcode, bool riscv_test) const;
+
+  // copy the registers and PC into the core, which continues from there
+  void handoff();
+
+  // take the registers and PC back from a drained core
+  void takeover();
+
+  // pass the loads, stores and control transfers executed to the core's
+  // warming hooks, bypassing the translator
+  void set_warming(bool enable) {
+    warming_ = enable;
+  }
+
+  // return from run() after the current instruction
+  void yield() {
+    yield_ = true;
+  }
+
+  // basic-block vector profiling: bypass the translator and superblocks so
+  // that every cached block is a basic block
+  void set_bbv(bool enable) {
+    bbv_ = enable;
+  }
+
+  // (block id, instructions retired) per basic block since the last call,
+  // ids are stable for the whole run and start at 1
+  void collect_bbv(std::vector<std::pair<uint32_t, uint64_t>>* bbv);
+
+  Word PC() const {
+    return PC_;
+  }
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+  // cached blocks, most instructions retired first
+  std::vector<BlockProfile> block_profile() const;
+
+  // the binary translator, nullptr if disabled
+  const Dbt* dbt() const {
+    return dbt_.get();
+  }
+
+private:
+
+  // operation handlers: common RV32I instructions are executed inline,
+  // everything else goes through the decoded instruction's ALU kernel
+  #define EMU_OPS(X) \
+    X(ADD) X(SUB) X(AND) X(OR) X(XOR) X(SLL) X(SRL) X(SRA) X(SLT) X(SLTU) \
+    X(ADDI) X(ANDI) X(ORI) X(XORI) X(SLLI) X(SRLI) X(SRAI) X(SLTI) X(SLTIU) \
+    X(LI) X(LB) X(LH) X(LW) X(LBU) X(LHU) X(SB) X(SH) X(SW) \
+    X(BEQ) X(BNE) X(BLT) X(BGE) X(BLTU) X(BGEU) X(JAL) X(JALR) \
+    X(ALU) X(CSR) X(EXIT)
+
+  enum class EmuOp : uint8_t {
+  #define EMU_OP_ENUM(op) op,
+    EMU_OPS(EMU_OP_ENUM)
+  #undef EMU_OP_ENUM
+  };
+
+  // predecoded instruction
+  struct emu_instr_t {
+    const void* handler;  // label address for threaded dispatch
+    Word     PC;
+    uint32_t imm;         // immediate, branch target or constant result
+    EmuOp    op;
+    uint8_t  rd;          // x0 writes go to the SINK_REG slot
+    uint8_t  rs1;
+    uint8_t  rs2;
+    uint8_t  size;
+    StaticInstr instr;
+  };
+
+  // basic block up to the first control transfer or exit, extended once
+  // along its majority successor when that is biased enough
+  struct emu_block_t {
+    Word     PC;
+    uint32_t n;
+    uint32_t loads;
+    uint32_t stores;
+    uint32_t branches;
+    uint64_t execs;
+    uint64_t retired;
+    uint64_t bbv_mark;    // retired at the last basic-block vector snapshot
+    Word     succ_PC;     // majority vote over the successors seen so far
+    uint32_t succ_votes;
+    bool     superblock;
+    std::vector<emu_instr_t> instrs;
+  };
+
+  static constexpr uint32_t BLOCK_ENTRIES       = 4096;
+  static constexpr uint32_t MAX_BLOCK_SIZE      = 64;
+  static constexpr uint32_t MAX_SUPERBLOCK_SIZE = 256;
+  static constexpr uint32_t PAGE_BITS           = 12;
+
+  // register slot that absorbs writes to x0
+  static constexpr uint32_t SINK_REG = NUM_REGS;
+
+  // decode the instruction at PC
+  void predecode(Word PC, emu_instr_t* entry);
+
+  // the cached block entered at PC, decoded on a miss
+  emu_block_t* lookup_block(Word PC, const void* const* handlers);
+
+  emu_block_t* build_block(Word PC, const void* const* handlers);
+
+  // append the block's majority successor to it
+  void extend_block(emu_block_t* block, const void* const* handlers);
+
+  // note an instruction held by a cached block
+  void mark_code(Word PC, uint32_t size);
+
+  void flush_blocks();
+
+  // move the blocks' retired counts since the last snapshot into bbv_counts_
+  void fold_bbv();
+
+  // interpret up to max_instrs instructions, stopping after a control
+  // transfer if stop_at_branch is set, returns the number executed
+  uint64_t interpret(uint64_t max_instrs, bool stop_at_branch);
+
+  // CSR read with instrs retired so far
+  uint32_t get_csr(uint32_t addr, uint64_t instrs) const;
+
+  void dmem_read(void* data, uint64_t addr, uint32_t size);
+
+  void dmem_write(const void* data, uint64_t addr, uint32_t size);
+
+  Core* core_;
+  std::vector<Word> reg_file_;
+  Word PC_;
+  bool exited_;
+  bool warming_;
+  bool yield_;
+  bool bbv_;
+  std::unordered_map<Word, std::unique_ptr<emu_block_t>> blocks_;
+  std::vector<std::pair<Word, emu_block_t*>> block_cache_;  // direct-mapped by entry PC
+  std::vector<bool> code_pages_;  // pages holding cached instructions
+  std::unordered_map<uint32_t, std::bitset<(1 << PAGE_BITS) / 2>> code_map_;  // and their halfwords
+  bool blocks_dirty_;  // a store overwrote cached code
+  std::unordered_map<Word, uint32_t> bbv_ids_;
+  std::map<uint32_t, uint64_t> bbv_counts_;
+  std::unique_ptr<Dbt> dbt_;
+  PerfStats perf_stats_;
+
+  friend class Dbt;
+};
+
+}
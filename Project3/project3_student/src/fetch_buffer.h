@@ -0,0 +1,76 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <mem.h>
+
+namespace tinyrv {
+
+// Fetch alignment buffer.
+// Instruction memory is read one aligned 32-bit fetch block per cycle and
+// the last block is kept, so a block holding two compressed instructions is
+// only read once. A 32-bit instruction at a 2-byte aligned PC straddles two
+// blocks; it needs an extra cycle unless the first block is already buffered.
+class FetchBuffer {
+public:
+  static constexpr uint32_t BLOCK_SIZE = 4;
+
+  struct PerfStats {
+    uint64_t instrs;
+    uint64_t compressed;
+    uint64_t blocks;      // fetch blocks read from memory
+    uint64_t used_bytes;  // bytes of the fetched blocks that were consumed
+    uint64_t straddles;   // cycles lost to instructions split across blocks
+
+    PerfStats()
+      : instrs(0)
+      , compressed(0)
+      , blocks(0)
+      , used_bytes(0)
+      , straddles(0)
+    {}
+  };
+
+  FetchBuffer(MemoryUnit* mmu);
+
+  ~FetchBuffer();
+
+  void reset();
+
+  // fetch the instruction at PC, returns false if it needs another cycle
+  bool fetch(uint32_t PC, uint32_t* instr_code, uint32_t* instr_size);
+
+  // a store of the given size was made at addr
+  void invalidate(uint64_t addr, uint32_t size);
+
+  const PerfStats& perf_stats() const {
+    return perf_stats_;
+  }
+
+private:
+
+  void load(uint32_t block_addr);
+
+  void consume(uint32_t half);
+
+  MemoryUnit* mmu_;
+  uint32_t  block_addr_;
+  uint32_t  block_data_;
+  uint32_t  used_mask_;  // consumed halfwords of the buffered block
+  bool      valid_;
+  PerfStats perf_stats_;
+};
+
+}
@@ -0,0 +1,168 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks the decoder's macro-op fusion without the out-of-order core: each
+// pair is decoded and fused, and the fused operation must compute what the
+// two instructions compute in sequence (the ALU result, the load address or
+// the jump target) for random register values.
+
+#include <iostream>
+#include <random>
+#include "config.h"
+#include "instr.h"
+#include "FU.h"
+
+using namespace tinyrv;
+
+namespace {
+
+enum Reg { zero = 0, t0 = 5, t1 = 6, a0 = 10, a1 = 11, a2 = 12 };
+
+uint32_t enc_r(uint32_t f7, uint32_t rs2, uint32_t rs1, uint32_t f3, uint32_t rd, uint32_t op) {
+  return (f7 << 25) | (rs2 << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op;
+}
+
+uint32_t enc_i(int32_t imm, uint32_t rs1, uint32_t f3, uint32_t rd, uint32_t op) {
+  return (uint32_t(imm) << 20) | (rs1 << 15) | (f3 << 12) | (rd << 7) | op;
+}
+
+uint32_t lui(uint32_t rd, uint32_t imm)   { return (imm << 12) | (rd << 7) | 0x37; }
+uint32_t auipc(uint32_t rd, uint32_t imm) { return (imm << 12) | (rd << 7) | 0x17; }
+uint32_t addi(uint32_t rd, uint32_t rs1, int32_t imm)  { return enc_i(imm, rs1, 0, rd, 0x13); }
+uint32_t slli(uint32_t rd, uint32_t rs1, uint32_t sh)  { return enc_i(sh, rs1, 1, rd, 0x13); }
+uint32_t add(uint32_t rd, uint32_t rs1, uint32_t rs2)  { return enc_r(0, rs2, rs1, 0, rd, 0x33); }
+uint32_t lw(uint32_t rd, uint32_t rs1, int32_t imm)    { return enc_i(imm, rs1, 2, rd, 0x03); }
+uint32_t lbu(uint32_t rd, uint32_t rs1, int32_t imm)   { return enc_i(imm, rs1, 4, rd, 0x03); }
+uint32_t jalr(uint32_t rd, uint32_t rs1, int32_t imm)  { return enc_i(imm, rs1, 0, rd, 0x67); }
+
+struct pair_t {
+  uint32_t first;
+  uint32_t second;
+  FuseType type;  // NONE if the pair must not fuse
+};
+
+const pair_t sc_pairs[] = {
+  {lui(a0, 0x12345),   addi(a0, a0, 0x678), FuseType::LUI_ADDI},
+  {lui(a0, 0x80000),   addi(a0, a0, -1),    FuseType::LUI_ADDI},
+  {auipc(a0, 0x10),    addi(a0, a0, -16),   FuseType::LUI_ADDI},
+  {auipc(t0, 0x1),     jalr(t0, t0, -4),    FuseType::AUIPC_JALR},
+  {slli(a0, a1, 1),    add(a0, a0, a2),     FuseType::SLLI_ADD},
+  {slli(a0, a1, 2),    add(a0, a2, a0),     FuseType::SLLI_ADD},
+  {slli(a0, a1, 3),    add(a0, a0, a2),     FuseType::SLLI_ADD},
+  {slli(a0, a0, 2),    add(a0, a0, a1),     FuseType::SLLI_ADD},
+  {lui(a0, 0x80001),   lw(a0, a0, 4),       FuseType::LOAD},
+  {auipc(a0, 0x2),     lbu(a0, a0, -8),     FuseType::LOAD},
+  {addi(a0, a1, 64),   lw(a0, a0, -4),      FuseType::LOAD},
+  {add(a0, a1, a2),    lw(a0, a0, 0),       FuseType::LOAD},
+  // the second instruction must overwrite the first one's destination
+  {lui(a0, 0x12345),   addi(a1, a0, 0x678), FuseType::NONE},
+  {slli(a0, a1, 2),    add(a1, a0, a2),     FuseType::NONE},
+  {auipc(t0, 0x1),     jalr(t1, t0, 0),     FuseType::NONE},
+  // and read it
+  {lui(a0, 0x12345),   addi(a0, a1, 0x678), FuseType::NONE},
+  // shifts beyond sh3add, or feeding both add operands
+  {slli(a0, a1, 4),    add(a0, a0, a2),     FuseType::NONE},
+  {slli(a0, a1, 0),    add(a0, a0, a2),     FuseType::NONE},
+  {slli(a0, a1, 1),    add(a0, a0, a0),     FuseType::NONE},
+  // an indexed load has no room for an offset
+  {add(a0, a1, a2),    lw(a0, a0, 4),       FuseType::NONE},
+  {lui(zero, 0x1),     addi(zero, zero, 1), FuseType::NONE},
+};
+
+std::ostream& operator<<(std::ostream& os, const pair_t& pair) {
+  return os << "0x" << std::hex << pair.first << ", 0x" << pair.second << std::dec;
+}
+
+// operands are read as the core's issue stage reads them, 0 when unused
+uint32_t execute(const StaticInstr& instr, const uint32_t* regs) {
+  auto exe_flags = instr.getExeFlags();
+  uint32_t rs1_data = exe_flags.use_rs1 ? regs[instr.getRs1()] : 0;
+  uint32_t rs2_data = exe_flags.use_rs2 ? regs[instr.getRs2()] : 0;
+  return execute_alu_op(instr, rs1_data, rs2_data);
+}
+
+// the value the pair leaves in the shared register, or its jump target
+uint32_t run_pair(const StaticInstr& first, const StaticInstr& second, uint32_t* regs) {
+  uint32_t saved = regs[first.getRd()];
+  regs[first.getRd()] = execute(first, regs);
+  uint32_t result = execute(second, regs);
+  regs[first.getRd()] = saved;
+  return result;
+}
+
+}
+
+int main() {
+  std::mt19937 rng(0x5eed);
+  int errors = 0;
+  uint32_t fused_pairs = 0;
+
+  for (auto& pair : sc_pairs) {
+    uint32_t PC = 0x80000000 + 4 * (rng() % 1024);
+    StaticInstr first(0, 0), second(0, 0), fused(0, 0);
+    if (!decode_instr(pair.first, PC, &first)
+     || !decode_instr(pair.second, PC + 4, &second)) {
+      std::cout << "error: invalid pair " << pair << std::endl;
+      return -1;
+    }
+
+    // disabled idioms never fuse
+    auto type = FuseType::NONE;
+    if (fuse_instrs(first, second, 0, &fused, &type)) {
+      std::cout << "error: fused with FUSION=0: " << pair << std::endl;
+      ++errors;
+    }
+
+    bool is_fused = fuse_instrs(first, second, FUSION, &fused, &type);
+    if (!is_fused)
+      type = FuseType::NONE;
+    if (type != pair.type) {
+      std::cout << "error: " << pair << ": fuse type " << int(type)
+                << ", expected " << int(pair.type) << std::endl;
+      ++errors;
+      continue;
+    }
+    if (!is_fused)
+      continue;
+    ++fused_pairs;
+
+    if (fused.getRd() != second.getRd()
+     || fused.getPC() != first.getPC()
+     || fused.getFUType() != second.getFUType()
+     || fused.getBrOp() != second.getBrOp()) {
+      std::cout << "error: " << pair << ": fused as 0x" << std::hex << fused.getCode() << std::dec << std::endl;
+      ++errors;
+      continue;
+    }
+
+    for (int i = 0; i < 100; ++i) {
+      uint32_t regs[32];
+      for (auto& reg : regs) {
+        reg = rng();
+      }
+      regs[0] = 0;
+      auto expected = run_pair(first, second, regs);
+      auto result = execute(fused, regs);
+      if (result != expected) {
+        std::cout << "error: " << pair << ": fused result=0x" << std::hex << result
+                  << ", expected=0x" << expected << std::dec << std::endl;
+        ++errors;
+        break;
+      }
+    }
+  }
+
+  std::cout << "fusion check: " << (sizeof(sc_pairs) / sizeof(sc_pairs[0])) << " pairs, "
+            << fused_pairs << " fused, " << errors << " errors" << std::endl;
+  return errors ? -1 : 0;
+}
@@ -13,7 +13,9 @@
 
 #pragma once
 
+#include <string.h>
 #include "types.h"
+#include "rvc.h"
 
 namespace tinyrv {
 
@@ -41,103 +43,195 @@ enum class Opcode {
   FENCE = 0x0f,
 };
 
-class Instr {
-public:
-  typedef std::shared_ptr<Instr> Ptr;
+// ALU operand source bits, they select the execute kernel
+// together with the ALU operation.
+enum AluSrc {
+  ALU_SRC_S2_IMM = 1 << 0,  // source2 is the immediate
+  ALU_SRC_S1_INV = 1 << 1,  // source1 is inverted
+  ALU_SRC_S1_RS1 = 1 << 2,  // source1 is the rs1 index
+  ALU_SRC_S1_PC  = 1 << 3,  // source1 is the PC
+  ALU_SRC_COMBOS = 1 << 4,
+};
 
-  Instr(uint64_t uuid, uint32_t PC)
-    : uuid_(uuid)
-    , PC_(PC)
-    , opcode_(Opcode::NONE)
-    , rd_(0)
-    , rs1_(0)
-    , rs2_(0)
+// one ALU kernel for every (AluOp, AluSrc) pair
+constexpr uint32_t ALU_KERNELS = 64 * ALU_SRC_COMBOS;
+
+inline uint32_t alu_kernel_index(AluOp alu_op, uint32_t alu_src) {
+  return uint32_t(alu_op) * ALU_SRC_COMBOS + alu_src;
+}
+
+inline uint32_t alu_src_of(ExeFlags exe_flags) {
+  return (exe_flags.alu_s2_imm ? ALU_SRC_S2_IMM : 0)
+       | (exe_flags.alu_s1_inv ? ALU_SRC_S1_INV : 0)
+       | (exe_flags.alu_s1_rs1 ? ALU_SRC_S1_RS1 : 0)
+       | (exe_flags.alu_s1_PC  ? ALU_SRC_S1_PC  : 0);
+}
+
+// Word kept in a decoded instruction for a fetched encoding.
+// 32-bit instructions are kept as-is, RV32C ones are expanded to their 32-bit
+// equivalent with bit 0 cleared to remember their size. Returns 0 if invalid.
+inline uint32_t canonical_code(uint32_t instr_code) {
+  return is_compressed(instr_code) ? (rvc_expand(instr_code) & ~0x1u) : instr_code;
+}
+
+// Decoded instruction.
+// Packed into 16 bytes: the register, func3 and func7 fields are read
+// straight out of the canonical instruction word, and the ALU kernel index,
+// branch op, functional unit and execution flags share a single 32-bit word.
+class StaticInstr {
+public:
+  StaticInstr()
+    : PC_(0)
+    , code_(0)
     , imm_(0)
-    , func3_(0)
-    , func7_(0)
-    , alu_op_(AluOp::ADD)
-    , exe_flags_(ExeFlags{})
+    , flags_(0)
+    , alu_kernel_(alu_kernel_index(AluOp::ADD, 0))
+    , br_op_(uint32_t(BrOp::NONE))
+    , fu_type_(uint32_t(FUType::NONE))
   {}
 
-  void setOpcode(Opcode opcode)  {
-    opcode_ = opcode;
-  }
-
-  void setRd(uint32_t value) {
-    rd_ = value;
-  }
-
-  void setSrc1(uint32_t value) {
-    rs1_ = value;
-  }
-
-  void setSrc2(uint32_t value) {
-    rs2_ = value;
-  }
+  StaticInstr(uint32_t PC, uint32_t code)
+    : PC_(PC)
+    , code_(code)
+    , imm_(0)
+    , flags_(0)
+    , alu_kernel_(alu_kernel_index(AluOp::ADD, 0))
+    , br_op_(uint32_t(BrOp::NONE))
+    , fu_type_(uint32_t(FUType::NONE))
+  {}
 
   void setImm(uint32_t value) {
     imm_ = value;
   }
 
-  void setFunc3(uint32_t value) {
-    func3_ = value;
-  }
-
-  void setFunc7(uint32_t value) {
-    func7_ = value;
-  }
-
   void setAluOp(AluOp value) {
-    alu_op_ = value;
+    alu_kernel_ = alu_kernel_index(value, alu_kernel_ % ALU_SRC_COMBOS);
   }
 
   void setBrOp(BrOp value) {
-    br_op_ = value;
+    br_op_ = uint32_t(value);
   }
 
   void setExeFlags(ExeFlags value) {
-    exe_flags_ = value;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    flags_ = bits;
+    alu_kernel_ = alu_kernel_index(this->getAluOp(), alu_src_of(value));
   }
 
   void setFUType(FUType value) {
-    fu_type_ = value;
+    fu_type_ = uint32_t(value);
   }
 
-  uint64_t getId() const { return uuid_; }
+  // an all-zero word is not a valid instruction
+  bool valid() const { return code_ != 0; }
+
   uint32_t getPC() const { return PC_; }
+  uint32_t getCode() const { return code_; }
+  uint32_t getSize() const { return (code_ & 0x1) ? 4 : 2; }
 
-  Opcode   getOpcode() const { return opcode_; }
-  uint32_t getRd() const { return rd_; }
-  uint32_t getRs1() const { return rs1_; }
-  uint32_t getRs2() const { return rs2_; }
+  Opcode   getOpcode() const { return Opcode((code_ | 0x3) & 0x7f); }
+  uint32_t getRd() const { return (code_ >> 7) & 0x1f; }
+  uint32_t getRs1() const { return (code_ >> 15) & 0x1f; }
+  uint32_t getRs2() const { return (code_ >> 20) & 0x1f; }
   uint32_t getImm() const { return imm_; }
-  uint32_t getFunc3() const { return func3_; }
-  uint32_t getFunc7() const { return func7_; }
+  uint32_t getFunc3() const { return (code_ >> 12) & 0x7; }
+  uint32_t getFunc7() const { return code_ >> 25; }
+
+  AluOp    getAluOp() const { return AluOp(alu_kernel_ / ALU_SRC_COMBOS); };
+  BrOp     getBrOp() const { return BrOp(br_op_); };
+  FUType   getFUType() const { return FUType(fu_type_); }
+
+  // execute kernel, resolved from the ALU op and operand sources
+  uint32_t getAluKernel() const { return alu_kernel_; }
 
-  AluOp    getAluOp() const { return alu_op_; };
-  BrOp     getBrOp() const { return br_op_; };
-  ExeFlags getExeFlags() const { return exe_flags_; }
-  FUType   getFUType() const { return fu_type_; }
+  ExeFlags getExeFlags() const {
+    ExeFlags value;
+    uint32_t bits = flags_;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
 
 private:
 
-  uint64_t  uuid_;
-  uint32_t  PC_;
+  uint32_t PC_;
+  uint32_t code_;
+  uint32_t imm_;
+  uint32_t flags_      : 15;  // ExeFlags bits
+  uint32_t alu_kernel_ : 10;  // {AluOp, AluSrc}
+  uint32_t br_op_      : 4;
+  uint32_t fu_type_    : 3;
+};
+
+static_assert(sizeof(ExeFlags) == sizeof(uint32_t), "ExeFlags must fit in a word");
+static_assert(sizeof(StaticInstr) <= 16, "StaticInstr must fit in 16 bytes");
+
+// decode a 32-bit or RV32C instruction, returns false if the encoding is invalid
+bool decode_instr(uint32_t instr_code, uint32_t PC, StaticInstr* instr);
+
+// fuse two adjacent instructions into a single operation,
+// returns false if the pair is not one of the enabled FUSE_* idioms.
+// The fused operation takes the second instruction's encoding at the first one's PC.
+bool fuse_instrs(const StaticInstr& first, const StaticInstr& second, uint32_t idioms,
+                 StaticInstr* fused, FuseType* type);
+
+// Dynamic instruction instance.
+// A plain value holding the decoded fields, the uuid and the fusion state,
+// copied through the pipeline queues, the ROB, the RS and the FUs.
+class Instr {
+public:
+  Instr()
+    : uuid_(0)
+    , size_(0)
+    , fuse_type_(FuseType::NONE)
+  {}
+
+  Instr(uint64_t uuid, const StaticInstr& sinstr)
+    : uuid_(uuid)
+    , sinstr_(sinstr)
+    , size_(sinstr.getSize())
+    , fuse_type_(FuseType::NONE)
+  {}
+
+  // mark as the fusion of two instructions spanning size bytes
+  void setFused(FuseType type, uint32_t size) {
+    fuse_type_ = type;
+    size_ = size;
+  }
+
+  uint64_t getId() const { return uuid_; }
+  uint32_t getPC() const { return sinstr_.getPC(); }
+  uint32_t getSize() const { return size_; }
+
+  FuseType getFuseType() const { return fuse_type_; }
 
-  Opcode    opcode_;
-  uint32_t  rd_;
-  uint32_t  rs1_;
-  uint32_t  rs2_;
-  uint32_t  imm_;
-  uint32_t  func3_;
-  uint32_t  func7_;
+  // program instructions retired by this operation
+  uint32_t getCount() const { return (fuse_type_ != FuseType::NONE) ? 2 : 1; }
+
+  Opcode   getOpcode() const { return sinstr_.getOpcode(); }
+  uint32_t getRd() const { return sinstr_.getRd(); }
+  uint32_t getRs1() const { return sinstr_.getRs1(); }
+  uint32_t getRs2() const { return sinstr_.getRs2(); }
+  uint32_t getImm() const { return sinstr_.getImm(); }
+  uint32_t getFunc3() const { return sinstr_.getFunc3(); }
+  uint32_t getFunc7() const { return sinstr_.getFunc7(); }
+
+  AluOp    getAluOp() const { return sinstr_.getAluOp(); };
+  BrOp     getBrOp() const { return sinstr_.getBrOp(); };
+  uint32_t getAluKernel() const { return sinstr_.getAluKernel(); }
+  ExeFlags getExeFlags() const { return sinstr_.getExeFlags(); }
+  FUType   getFUType() const { return sinstr_.getFUType(); }
+
+  const StaticInstr& getStatic() const { return sinstr_; }
+
+private:
 
-  AluOp     alu_op_;
-  BrOp      br_op_;
-  ExeFlags  exe_flags_;
-  FUType    fu_type_;
+  uint64_t uuid_;
+  StaticInstr sinstr_;
+  uint8_t size_;
+  FuseType fuse_type_;
 
   friend std::ostream &operator<<(std::ostream &, const Instr&);
 };
 
-}
\ No newline at end of file
+}
@@ -16,30 +16,159 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <memory>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <util.h>
 #include "processor.h"
+#include "simpoint.h"
 #include "mem.h"
 #include "core.h"
+#include "memtrace.h"
+#include "tracesim.h"
+#include "reuse.h"
+#include "checker.h"
+#include "core_config.h"
 
 using namespace tinyrv;
 
+// simulation point files are named after the program, in the working directory
+static std::string simpoint_prefix(const char* program) {
+  std::string name(program);
+  auto slash = name.find_last_of('/');
+  if (slash != std::string::npos) {
+    name = name.substr(slash + 1);
+  }
+  auto dot = name.find_last_of('.');
+  if (dot != std::string::npos) {
+    name = name.substr(0, dot);
+  }
+  return name;
+}
+
 static void show_usage() {
-   std::cout << "Usage: [-g: gshare] [-s: stats] [-h: help] <program>" << std::endl;
+   std::cout << "Usage: [-g: gshare] [-s: stats] [-t <trace>: write memory trace] [-h: help] <program>" << std::endl;
+   std::cout << "       -f: functional simulation only, -F <n>: fast-forward n instructions functionally" << std::endl;
+   std::cout << "       -R: run functionally outside the regions of interest marked by the program" << std::endl;
+   std::cout << "       -S <period>[:<warmup>[:<window>]]: sampled simulation, one timed window per period" << std::endl;
+   std::cout << "       -B <interval>[:<max_k>]: write basic-block vectors and pick simulation points, -P <interval>: run them" << std::endl;
+   std::cout << "       -r <trace>: replay a memory trace through the cache sweep (CSV on stdout)" << std::endl;
+   std::cout << "       -u <csv>: write the reuse-distance miss-ratio curve" << std::endl;
+   std::cout << "       -c: check every committed instruction against a golden functional model" << std::endl;
+   std::cout << "       -C <file>: read core parameters (name=value lines), -D <name>=<value>: set one, see core_config.h" << std::endl;
+   std::cout << "       -W <state>: save the cache state at the end of the run, -L <state>: start from a saved state" << std::endl;
 }
 
 bool showStats = false;
 const char* program = nullptr;
+const char* trace_file = nullptr;
+const char* replay_file = nullptr;
+const char* reuse_file = nullptr;
+const char* save_state_file = nullptr;
+const char* load_state_file = nullptr;
+bool functional = false;
+bool cosim = false;
+uint64_t ffwd_instrs = 0;
+uint64_t sample_period = 0;
+uint64_t sample_warmup = SAMPLE_WARMUP;
+uint64_t sample_window = SAMPLE_WINDOW;
+uint64_t bbv_interval = 0;
+uint32_t simpoint_max_k = SIMPOINT_MAX_K;
+uint64_t simpoint_interval = 0;
+CoreConfig core_config;
+
+static bool load_program(RAM* ram) {
+  std::string program_ext(fileExtension(program));
+  if (program_ext == "bin") {
+    ram->loadBinImage(program, STARTUP_ADDR);
+  } else if (program_ext == "hex") {
+    ram->loadHexImage(program);
+  } else {
+    return false;
+  }
+  return true;
+}
 
 static void parse_args(int argc, char **argv) {
   int c;
-  while ((c = getopt(argc, argv, "gsh?")) != -1) {
+  while ((c = getopt(argc, argv, "gcst:r:u:W:L:C:D:fF:RS:B:P:h?")) != -1) {
     switch (c) {
     case 's':
       showStats = true;
       break;
+    case 't':
+      trace_file = optarg;
+      break;
+    case 'r':
+      replay_file = optarg;
+      break;
+    case 'u':
+      reuse_file = optarg;
+      break;
+    case 'W':
+      save_state_file = optarg;
+      break;
+    case 'L':
+      load_state_file = optarg;
+      break;
+    case 'C':
+      if (!core_config.load(optarg))
+        exit(-1);
+      break;
+    case 'D':
+      if (!core_config.parse(optarg))
+        exit(-1);
+      break;
+    case 'f':
+      functional = true;
+      break;
+    case 'c':
+      cosim = true;
+      break;
+    case 'F':
+      ffwd_instrs = std::strtoull(optarg, nullptr, 0);
+      break;
+    case 'R':
+      // until the program switches to detailed mode
+      ffwd_instrs = UINT64_MAX;
+      break;
+    case 'S': {
+      char* end;
+      sample_period = std::strtoull(optarg, &end, 0);
+      if (*end == ':') {
+        sample_warmup = std::strtoull(end + 1, &end, 0);
+        if (*end == ':') {
+          sample_window = std::strtoull(end + 1, &end, 0);
+        }
+      }
+      if (*end != '\0' || sample_period == 0 || sample_window == 0) {
+        show_usage();
+        exit(-1);
+      }
+      // the sampling report is part of the stats
+      showStats = true;
+    } break;
+    case 'B': {
+      char* end;
+      bbv_interval = std::strtoull(optarg, &end, 0);
+      if (*end == ':') {
+        simpoint_max_k = std::strtoul(end + 1, &end, 0);
+      }
+      if (*end != '\0' || bbv_interval == 0 || simpoint_max_k == 0) {
+        show_usage();
+        exit(-1);
+      }
+    } break;
+    case 'P': {
+      char* end;
+      simpoint_interval = std::strtoull(optarg, &end, 0);
+      if (*end != '\0' || simpoint_interval == 0) {
+        show_usage();
+        exit(-1);
+      }
+      showStats = true;
+    } break;
     case 'h':
     case '?':
       show_usage();
@@ -51,6 +180,12 @@ static void parse_args(int argc, char **argv) {
     }
   }
 
+  if (!core_config.validate())
+    exit(-1);
+
+  if (replay_file)
+    return;
+
   if (optind < argc) {
     program = argv[optind];
     std::cout << "Running " << program << ".." << std::endl;
@@ -65,31 +200,96 @@ int main(int argc, char **argv) {
 
   parse_args(argc, argv);
 
+  if (replay_file) {
+    // trace-driven cache simulation
+    TraceSim tracesim;
+    tracesim.add_default_sweep();
+    auto count = tracesim.run(replay_file);
+    tracesim.dump_csv(std::cout);
+    std::cerr << "Replayed " << count << " references through " << tracesim.num_configs() << " configurations" << std::endl;
+    return 0;
+  }
+
   {
     // create memory module
     RAM ram(RAM_PAGE_SIZE);
 
     // load program
-    {
-      std::string program_ext(fileExtension(program));
-      if (program_ext == "bin") {
-        ram.loadBinImage(program, STARTUP_ADDR);
-      } else if (program_ext == "hex") {
-        ram.loadHexImage(program);
-      } else {
-        std::cout << "*** error: only *.bin or *.hex images supported." << std::endl;
-        return -1;
-      }
+    if (!load_program(&ram)) {
+      std::cout << "*** error: only *.bin or *.hex images supported." << std::endl;
+      return -1;
     }
 
     // create processor
-    Processor processor;
+    Processor processor(core_config);
 
     // attach memory module
     processor.attach_ram(&ram);
 
+    // attach memory trace
+    std::unique_ptr<MemTraceWriter> trace;
+    if (trace_file) {
+      trace.reset(new MemTraceWriter(trace_file));
+      processor.attach_trace(trace.get());
+    }
+
+    // attach reuse-distance profiler
+    std::unique_ptr<ReuseProfiler> reuse;
+    if (reuse_file) {
+      reuse.reset(new ReuseProfiler(MEM_BLOCK_SIZE));
+      processor.attach_reuse(reuse.get());
+    }
+
+    // attach the co-simulation checker, on its own copy of the program
+    std::unique_ptr<RAM> checker_ram;
+    std::unique_ptr<Checker> checker;
+    if (cosim) {
+      checker_ram.reset(new RAM(RAM_PAGE_SIZE));
+      load_program(checker_ram.get());
+      checker.reset(new Checker(checker_ram.get()));
+      processor.attach_checker(checker.get());
+    }
+
+    // start from a warm cache state
+    if (load_state_file && !processor.load_state(load_state_file)) {
+      std::cout << "*** error: cannot load state from " << load_state_file << std::endl;
+      return -1;
+    }
+
     // run simulation
-    exitcode = processor.run(true);
+    if (functional) {
+      // a functional pass only trains the state it saves
+      exitcode = processor.emulate(true, save_state_file != nullptr);
+    } else if (sample_period != 0) {
+      exitcode = processor.sample(true, sample_period, sample_warmup, sample_window);
+    } else if (bbv_interval != 0) {
+      SimPoint simpoint(bbv_interval, simpoint_max_k);
+      exitcode = processor.profile(true, &simpoint);
+      auto prefix = simpoint_prefix(program);
+      std::ofstream bb(prefix + ".bb");
+      simpoint.write_bb(bb);
+      std::ofstream simpoints(prefix + ".simpoints");
+      std::ofstream weights(prefix + ".weights");
+      simpoint.write_points(simpoints, weights);
+      std::cout << "SimPoint: intervals=" << simpoint.num_intervals()
+                << ", points=" << simpoint.points().size() << ", written to " << prefix << ".{bb,simpoints,weights}" << std::endl;
+      for (auto& point : simpoint.points()) {
+        std::cout << "SimPoint: interval=" << point.interval << ", cluster=" << point.cluster
+                  << ", weight=" << point.weight << std::endl;
+      }
+    } else if (simpoint_interval != 0) {
+      SimPoint simpoint(simpoint_interval, SIMPOINT_MAX_K);
+      auto prefix = simpoint_prefix(program);
+      std::ifstream simpoints(prefix + ".simpoints");
+      std::ifstream weights(prefix + ".weights");
+      if (!simpoint.read_points(simpoints, weights)) {
+        std::cout << "*** error: cannot read " << prefix << ".simpoints and " << prefix << ".weights" << std::endl;
+        return -1;
+      }
+      exitcode = processor.run_simpoints(true, simpoint);
+    } else {
+      exitcode = processor.run(true, ffwd_instrs);
+    }
     if (exitcode != 0) {
       std::cout << "*** FAILED: exitcode=" << exitcode << std::endl;
     } else {
@@ -100,6 +300,18 @@ int main(int argc, char **argv) {
     if (showStats) {
       processor.showStats();
     }
+
+    // save the warm state for later runs
+    if (save_state_file && !processor.save_state(save_state_file)) {
+      std::cout << "*** error: cannot write state to " << save_state_file << std::endl;
+      return -1;
+    }
+
+    // write the miss-ratio curve
+    if (reuse) {
+      std::ofstream ofs(reuse_file);
+      reuse->dump_csv(ofs);
+    }
   }
 
   return exitcode;
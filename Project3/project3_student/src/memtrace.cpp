@@ -0,0 +1,178 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string.h>
+#include <assert.h>
+#include <util.h>
+#include "memtrace.h"
+
+using namespace tinyrv;
+
+static const char TRACE_MAGIC[4] = {'T', 'R', 'V', 'T'};
+static const uint8_t TRACE_VERSION = 1;
+static const size_t TRACE_BUFFER_SIZE = 64 * 1024;
+
+static uint64_t zigzag_encode(int64_t value) {
+  return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MemTraceWriter::MemTraceWriter(const char* filename)
+  : ofs_(filename, std::ios::binary)
+  , last_PC_(0)
+  , last_addr_(0)
+  , count_(0) {
+  if (!ofs_) {
+    std::cout << "error: cannot create " << filename << std::endl;
+    std::abort();
+  }
+  buffer_.reserve(TRACE_BUFFER_SIZE + 32);
+  ofs_.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  ofs_.put(TRACE_VERSION);
+}
+
+MemTraceWriter::~MemTraceWriter() {
+  this->flush();
+}
+
+void MemTraceWriter::write(const MemRef& ref) {
+  assert(ispow2(ref.size) && ref.size <= 8);
+
+  auto put_varint = [&](uint64_t value) {
+    while (value >= 0x80) {
+      buffer_.push_back(uint8_t(value) | 0x80);
+      value >>= 7;
+    }
+    buffer_.push_back(uint8_t(value));
+  };
+
+  bool is_fetch = (ref.type == MemRefType::FETCH);
+  bool sequential = is_fetch && (ref.PC == last_PC_ + 4);
+
+  uint8_t header = uint8_t(ref.type)
+                 | (log2ceil(ref.size) << 2)
+                 | (sequential << 4);
+  buffer_.push_back(header);
+
+  if (!sequential) {
+    put_varint(zigzag_encode(int64_t(ref.PC) - int64_t(last_PC_)));
+  }
+  last_PC_ = ref.PC;
+
+  if (!is_fetch) {
+    put_varint(zigzag_encode(int64_t(ref.addr - last_addr_)));
+    last_addr_ = ref.addr;
+  }
+
+  ++count_;
+
+  if (buffer_.size() >= TRACE_BUFFER_SIZE) {
+    this->flush();
+  }
+}
+
+void MemTraceWriter::flush() {
+  ofs_.write((const char*)buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MemTraceReader::MemTraceReader(const char* filename)
+  : ifs_(filename, std::ios::binary)
+  , buffer_(TRACE_BUFFER_SIZE)
+  , buf_pos_(0)
+  , buf_size_(0)
+  , last_PC_(0)
+  , last_addr_(0) {
+  if (!ifs_) {
+    std::cout << "error: " << filename << " not found" << std::endl;
+    std::abort();
+  }
+  char magic[sizeof(TRACE_MAGIC)];
+  ifs_.read(magic, sizeof(magic));
+  int version = ifs_.get();
+  if (!ifs_
+   || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+   || version != TRACE_VERSION) {
+    std::cout << "error: " << filename << " is not a valid memory trace" << std::endl;
+    std::abort();
+  }
+}
+
+MemTraceReader::~MemTraceReader() {
+  //--
+}
+
+bool MemTraceReader::read_byte(uint8_t* byte) {
+  if (buf_pos_ == buf_size_) {
+    ifs_.read((char*)buffer_.data(), buffer_.size());
+    buf_size_ = ifs_.gcount();
+    buf_pos_ = 0;
+    if (buf_size_ == 0)
+      return false;
+  }
+  *byte = buffer_[buf_pos_++];
+  return true;
+}
+
+bool MemTraceReader::read_varint(int64_t* value) {
+  uint64_t result = 0;
+  uint32_t shift = 0;
+  uint8_t byte;
+  do {
+    if (!this->read_byte(&byte) || shift > 63)
+      return false;
+    result |= uint64_t(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  *value = zigzag_decode(result);
+  return true;
+}
+
+bool MemTraceReader::read(MemRef* ref) {
+  uint8_t header;
+  if (!this->read_byte(&header))
+    return false;
+
+  ref->type = MemRefType(header & 0x3);
+  ref->size = 1 << ((header >> 2) & 0x3);
+
+  if (header & 0x10) {
+    ref->PC = last_PC_ + 4;
+  } else {
+    int64_t delta;
+    if (!this->read_varint(&delta))
+      return false;
+    ref->PC = uint32_t(last_PC_ + delta);
+  }
+  last_PC_ = ref->PC;
+
+  if (ref->type == MemRefType::FETCH) {
+    ref->addr = ref->PC;
+  } else {
+    int64_t delta;
+    if (!this->read_varint(&delta))
+      return false;
+    ref->addr = last_addr_ + delta;
+    last_addr_ = ref->addr;
+  }
+
+  return true;
+}
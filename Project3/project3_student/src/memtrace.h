@@ -0,0 +1,87 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace tinyrv {
+
+enum class MemRefType {
+  FETCH,
+  LOAD,
+  STORE
+};
+
+struct MemRef {
+  MemRefType type;
+  uint32_t   PC;
+  uint64_t   addr;
+  uint32_t   size;
+};
+
+// Binary memory-reference trace.
+// The file starts with a "TRVT" magic and a version byte, then holds one
+// variable-length record per reference:
+//   header byte: [1:0] type, [3:2] log2(size), [4] sequential fetch
+//   PC delta:    zigzag varint from the previous PC, omitted for sequential fetches
+//   addr delta:  zigzag varint from the previous data address, omitted for fetches
+class MemTraceWriter {
+public:
+  MemTraceWriter(const char* filename);
+
+  ~MemTraceWriter();
+
+  void write(const MemRef& ref);
+
+  uint64_t count() const {
+    return count_;
+  }
+
+private:
+
+  void flush();
+
+  std::ofstream ofs_;
+  std::vector<uint8_t> buffer_;
+  uint32_t last_PC_;
+  uint64_t last_addr_;
+  uint64_t count_;
+};
+
+class MemTraceReader {
+public:
+  MemTraceReader(const char* filename);
+
+  ~MemTraceReader();
+
+  // read the next reference, returns false at the end of the trace
+  bool read(MemRef* ref);
+
+private:
+
+  bool read_byte(uint8_t* byte);
+
+  bool read_varint(int64_t* value);
+
+  std::ifstream ifs_;
+  std::vector<uint8_t> buffer_;
+  size_t   buf_pos_;
+  size_t   buf_size_;
+  uint32_t last_PC_;
+  uint64_t last_addr_;
+};
+
+}
@@ -20,6 +20,7 @@
 #include "core.h"
 #include "debug.h"
 #include "processor_impl.h"
+#include "checker.h"
 
 using namespace tinyrv;
 
@@ -29,7 +30,7 @@ void Core::issue() {
 
   auto& is_data = issue_queue_->data();
   auto instr = is_data.instr;
-  auto exe_flags = instr->getExeFlags();
+  auto exe_flags = instr.getExeFlags();
 
   // check for structial hazards
   // TODO:
@@ -39,8 +40,8 @@ void Core::issue() {
   int rs1_rsid = -1;      // reservation station id for rs1 (-1 indicates data in already available)
   int rs2_rsid = -1;      // reservation station id for rs2 (-1 indicates data is already available)
 
-  auto rs1 = instr->getRs1();
-  auto rs2 = instr->getRs2();
+  auto rs1 = instr.getRs1();
+  auto rs2 = instr.getRs2();
 
   // get rs1 data
   // check the RAT if value is in the registe file
@@ -70,7 +71,7 @@ void Core::issue() {
   // update RST mapping
   // TODO:
 
-  DT(2, "Issue: " << *instr);
+  DT(2, "Issue: " << instr);
 
   // pop issue queue
   issue_queue_->pop();
@@ -139,7 +140,7 @@ void Core::commit() {
   // check if the head entry is ready to commit
   if (rob_head.ready) {
     auto instr = rob_head.instr;
-    auto exe_flags = instr->getExeFlags();
+    auto exe_flags = instr.getExeFlags();
 
     // If this instruction writes to the register file,
     // (1) update the register file
@@ -149,10 +150,20 @@ void Core::commit() {
     // pop ROB entry
     // TODO:
 
-    DT(2, "Commit: " << *instr);
+    DT(2, "Commit: " << instr);
 
     assert(perf_stats_.instrs <= fetched_instrs_);
-    ++perf_stats_.instrs;
+    perf_stats_.instrs += instr.getCount();
+
+    // lockstep check against the golden model
+    if (checker_) {
+      checker_->commit(instr, reg_file_, perf_stats_.cycles);
+    }
+
+    // apply guest control CSR writes
+    if (exe_flags.is_csr) {
+      processor_->commit_sim_csr(instr.getId());
+    }
 
     // handle program termination
     if (exe_flags.is_exit) {
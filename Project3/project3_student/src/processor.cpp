@@ -11,17 +11,30 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <iomanip>
+#include <cmath>
 #include "processor.h"
 #include "processor_impl.h"
 
 using namespace tinyrv;
 
-ProcessorImpl::ProcessorImpl() {
+ProcessorImpl::ProcessorImpl(const CoreConfig& config) {
   // initialize simulator
   SimPlatform::instance().initialize();
 
   // create the core
-  core_ = Core::Create(0, this);
+  core_ = Core::Create(0, this, config);
+
+  // create the functional simulator
+  emulator_.reset(new Emulator(core_.get()));
+  checker_ = nullptr;
+  timing_ = false;
+  simpoints_ = false;
+  sim_control_ = false;
+  detailed_ = false;
+  want_detailed_ = false;
+  in_roi_ = false;
 
   this->reset();
 }
@@ -33,34 +46,418 @@ ProcessorImpl::~ProcessorImpl() {
 
 void ProcessorImpl::reset() {
   core_->reset();
+  if (warm_state_) {
+    core_->load_state(*warm_state_);
+  }
 }
 
 void ProcessorImpl::attach_ram(RAM* ram) {
   core_->attach_ram(ram);
+  emulator_->attach_ram(ram);
+}
+
+void ProcessorImpl::attach_trace(MemTraceWriter* trace) {
+  core_->attach_trace(trace);
+}
+
+void ProcessorImpl::attach_reuse(ReuseProfiler* reuse) {
+  core_->attach_reuse(reuse);
 }
 
-int ProcessorImpl::run(bool riscv_test) {
+void ProcessorImpl::attach_checker(Checker* checker) {
+  core_->attach_checker(checker);
+  checker_ = checker;
+}
+
+int ProcessorImpl::run(bool riscv_test, uint64_t ffwd_instrs) {
   SimPlatform::instance().reset();
   this->reset();
+  rois_.clear();
+  pending_csrs_.clear();
+  in_roi_ = false;
+  sim_control_ = true;
 
-  bool done;
+  bool done = false;
   Word exitcode = 0;
-  do {
+
+  detailed_ = true;
+  if (ffwd_instrs != 0) {
+    // fast-forward functionally, up to a switch to detailed mode, then
+    // continue on the timing core
+    emulator_->reset();
+    detailed_ = false;
+    emulator_->run(ffwd_instrs);
+    done = emulator_->check_exit(&exitcode, riscv_test);
+    if (!done) {
+      emulator_->handoff();
+      detailed_ = true;
+    }
+  }
+  want_detailed_ = detailed_;
+
+  timing_ = true;
+  while (!done) {
     SimPlatform::instance().tick();
     done = core_->check_exit(&exitcode, riscv_test);
-  } while (!done);
+    if (!done && !want_detailed_) {
+      // drain, then continue functionally up to the next switch
+      while (!done && !core_->drain()) {
+        SimPlatform::instance().tick();
+        done = core_->check_exit(&exitcode, riscv_test);
+      }
+      if (done)
+        break;
+      emulator_->takeover();
+      detailed_ = false;
+      emulator_->run(UINT64_MAX);
+      done = emulator_->check_exit(&exitcode, riscv_test);
+      if (!done) {
+        emulator_->handoff();
+        detailed_ = true;
+      }
+    }
+  }
+
+  sim_control_ = false;
+  return exitcode;
+}
+
+int ProcessorImpl::emulate(bool riscv_test, bool warm) {
+  this->reset();
+  emulator_->reset();
+
+  Word exitcode = 0;
+  emulator_->set_warming(warm);
+  emulator_->run(UINT64_MAX);
+  emulator_->set_warming(false);
+  emulator_->check_exit(&exitcode, riscv_test);
+
+  return exitcode;
+}
+
+int ProcessorImpl::sample(bool riscv_test, uint64_t period, uint64_t warmup, uint64_t window) {
+  SimPlatform::instance().reset();
+  this->reset();
+  emulator_->reset();
+  samples_.clear();
+  simpoints_ = false;
+
+  // each period fast-forwards, warms, then runs in detail
+  uint64_t detail = SAMPLE_DETAIL_WARMUP + window;
+  uint64_t ffwd_instrs = (period > warmup + detail) ? (period - warmup - detail) : 0;
+
+  Word exitcode = 0;
+  for (;;) {
+    emulator_->run(ffwd_instrs);
+    emulator_->set_warming(true);
+    emulator_->run(warmup);
+    emulator_->set_warming(false);
+    if (emulator_->check_exit(&exitcode, riscv_test))
+      return exitcode;
+
+    sample_t sample{0, 0, 0, 0, 1.0};
+    bool done = this->run_detailed(SAMPLE_DETAIL_WARMUP, window, &sample, riscv_test, &exitcode);
+    if (sample.instrs != 0) {
+      samples_.push_back(sample);
+    }
+    if (done)
+      return exitcode;
+  }
+}
+
+int ProcessorImpl::profile(bool riscv_test, SimPoint* simpoint) {
+  this->reset();
+  emulator_->reset();
+
+  SimPoint::bbv_t bbv;
+  emulator_->set_bbv(true);
+  while (!emulator_->exited()) {
+    emulator_->run(simpoint->interval());
+    emulator_->collect_bbv(&bbv);
+    if (!bbv.empty()) {
+      simpoint->add_interval(bbv);
+    }
+  }
+  emulator_->set_bbv(false);
+  simpoint->cluster();
+
+  Word exitcode = 0;
+  emulator_->check_exit(&exitcode, riscv_test);
+  return exitcode;
+}
+
+int ProcessorImpl::run_simpoints(bool riscv_test, const SimPoint& simpoint) {
+  SimPlatform::instance().reset();
+  this->reset();
+  emulator_->reset();
+  samples_.clear();
+  simpoints_ = true;
+
+  // fast-forward and warm up to each point, the pipeline refill starts
+  // just before it
+  auto& core_stats = core_->perf_stats();
+  Word exitcode = 0;
+  for (auto& point : simpoint.points()) {
+    uint64_t pos = emulator_->perf_stats().instrs + core_stats.instrs;
+    uint64_t start = point.interval * simpoint.interval();
+    start = (start > SAMPLE_DETAIL_WARMUP) ? (start - SAMPLE_DETAIL_WARMUP) : 0;
+    if (start < pos)
+      start = pos;
+    uint64_t warm_start = (start > pos + SAMPLE_WARMUP) ? (start - SAMPLE_WARMUP) : pos;
+    emulator_->run(warm_start - pos);
+    emulator_->set_warming(true);
+    emulator_->run(start - warm_start);
+    emulator_->set_warming(false);
+    if (emulator_->exited())
+      break;
 
+    sample_t sample{0, 0, 0, point.interval, point.weight};
+    bool done = this->run_detailed(SAMPLE_DETAIL_WARMUP, simpoint.interval(), &sample, riscv_test, &exitcode);
+    if (sample.instrs != 0) {
+      samples_.push_back(sample);
+    }
+    if (done)
+      return exitcode;
+  }
+
+  // finish functionally
+  emulator_->run(UINT64_MAX);
+  emulator_->check_exit(&exitcode, riscv_test);
   return exitcode;
 }
 
+bool ProcessorImpl::run_detailed(uint64_t refill, uint64_t window, sample_t* sample, bool riscv_test, Word* exitcode) {
+  auto& core_stats = core_->perf_stats();
+  emulator_->handoff();
+  timing_ = true;
+
+  // the window is measured once the refill instructions have committed
+  sample->PC = emulator_->PC();
+  uint64_t start = core_stats.instrs;
+  uint64_t mark_instrs = start;
+  uint64_t mark_cycles = core_stats.cycles;
+  bool done = false;
+  while (!done && (core_stats.instrs - start) < (refill + window)) {
+    SimPlatform::instance().tick();
+    if ((core_stats.instrs - start) <= refill) {
+      mark_instrs = core_stats.instrs;
+      mark_cycles = core_stats.cycles;
+    }
+    done = core_->check_exit(exitcode, riscv_test);
+  }
+  sample->instrs = core_stats.instrs - mark_instrs;
+  sample->cycles = core_stats.cycles - mark_cycles;
+
+  // retire what is in flight and continue functionally
+  while (!done && !core_->drain()) {
+    SimPlatform::instance().tick();
+    done = core_->check_exit(exitcode, riscv_test);
+  }
+  if (!done) {
+    emulator_->takeover();
+  }
+  return done;
+}
+
+bool ProcessorImpl::save_state(const char* filename) const {
+  StateWriter writer(filename);
+  core_->save_state(writer);
+  return writer.good();
+}
+
+bool ProcessorImpl::load_state(const char* filename) {
+  // keep the file mapped, every later reset starts from it
+  std::unique_ptr<StateReader> reader(new StateReader(filename));
+  if (!reader->good() || !core_->load_state(*reader))
+    return false;
+  warm_state_ = std::move(reader);
+  return true;
+}
+
+uint32_t ProcessorImpl::get_sim_csr(uint32_t addr) const {
+  // the ROI CSRs read as 0 so that writing 1 always takes effect
+  switch (addr) {
+  case VX_CSR_SIM_MODE:
+    return detailed_;
+  default:
+    return 0;
+  }
+}
+
+void ProcessorImpl::set_sim_csr(uint64_t uuid, uint32_t addr, uint32_t value) {
+  // other modes keep their own schedule
+  if (!sim_control_)
+    return;
+
+  // the emulator retires in order, the timing core writes CSRs ahead of
+  // commit so its writes wait for the instruction to retire
+  if (!detailed_) {
+    this->apply_sim_csr(addr, value);
+    return;
+  }
+  for (auto& csr : pending_csrs_) {
+    if (csr.uuid == uuid && csr.addr == addr) {
+      csr.value = value;
+      return;
+    }
+  }
+  pending_csrs_.push_back({uuid, addr, value});
+}
+
+void ProcessorImpl::commit_sim_csr(uint64_t uuid) {
+  // older entries belong to squashed instructions
+  size_t n = 0;
+  for (auto& csr : pending_csrs_) {
+    if (csr.uuid == uuid) {
+      this->apply_sim_csr(csr.addr, csr.value);
+    } else if (csr.uuid > uuid) {
+      pending_csrs_[n++] = csr;
+    }
+  }
+  pending_csrs_.resize(n);
+}
+
+void ProcessorImpl::apply_sim_csr(uint32_t addr, uint32_t value) {
+  // the core's counters only advance in detailed mode
+  auto& core_stats = core_->perf_stats();
+  switch (addr) {
+  case VX_CSR_SIM_ROI_BEGIN:
+    if (in_roi_)
+      break;
+    in_roi_ = true;
+    roi_start_ = {core_stats.instrs, core_stats.cycles};
+    want_detailed_ = true;
+    break;
+  case VX_CSR_SIM_ROI_END:
+    if (!in_roi_)
+      break;
+    in_roi_ = false;
+    rois_.push_back({core_stats.instrs - roi_start_.instrs, core_stats.cycles - roi_start_.cycles});
+    want_detailed_ = false;
+    break;
+  case VX_CSR_SIM_MODE:
+    want_detailed_ = (value != 0);
+    break;
+  }
+  DP(2, "SIM: CSR write addr=0x" << std::hex << addr << ", value=0x" << value << std::dec
+     << ", " << (want_detailed_ ? "detailed" : "functional"));
+
+  // the emulator stops after this instruction
+  if (want_detailed_ && !detailed_) {
+    emulator_->yield();
+  }
+}
+
 void ProcessorImpl::showStats() {
-  core_->showStats();
+  core_->config().dump(std::cout);
+  auto& emu_stats = emulator_->perf_stats();
+  if (emu_stats.instrs != 0) {
+    std::cout << std::dec << "EMU: instrs=" << emu_stats.instrs << ", loads=" << emu_stats.loads
+              << ", stores=" << emu_stats.stores << ", branches=" << emu_stats.branches;
+    if (timing_) {
+      std::cout << ", handoff_PC=0x" << std::hex << emulator_->PC() << std::dec;
+    }
+    if (emu_stats.host_time > 0) {
+      std::cout << ", mips=" << std::fixed << std::setprecision(1)
+                << (emu_stats.instrs / emu_stats.host_time / 1e6);
+      std::cout.unsetf(std::ios::floatfield);
+    }
+    std::cout << std::endl;
+    // hottest interpreted blocks
+    auto profile = emulator_->block_profile();
+    std::cout << "BLOCKS: decoded=" << emu_stats.blocks << ", superblocks=" << emu_stats.superblocks << std::endl;
+    for (size_t i = 0; i < profile.size() && i < 5 && profile[i].retired != 0; ++i) {
+      auto& block = profile[i];
+      std::cout << "BLOCK: PC=0x" << std::hex << block.PC << std::dec << ", instrs=" << block.instrs
+                << ", loads=" << block.loads << ", stores=" << block.stores << ", branches=" << block.branches
+                << ", execs=" << block.execs << ", retired=" << block.retired;
+      if (block.superblock) {
+        std::cout << ", superblock";
+      }
+      std::cout << std::endl;
+    }
+    auto dbt = emulator_->dbt();
+    if (dbt && dbt->perf_stats().blocks != 0) {
+      auto& dbt_stats = dbt->perf_stats();
+      std::cout << "DBT: instrs=" << dbt_stats.instrs << ", blocks=" << dbt_stats.blocks
+                << ", flushes=" << dbt_stats.flushes << std::endl;
+    }
+  }
+  if (timing_) {
+    core_->showStats();
+    if (checker_) {
+      auto& checker_stats = checker_->perf_stats();
+      std::cout << "COSIM: instrs=" << checker_stats.instrs << ", stores=" << checker_stats.stores << std::endl;
+    }
+  }
+  if (!rois_.empty()) {
+    // regions of interest, in detailed core time
+    uint64_t instrs = 0, cycles = 0;
+    for (size_t i = 0; i < rois_.size(); ++i) {
+      auto& roi = rois_[i];
+      std::cout << "ROI: #" << i << ", instrs=" << roi.instrs << ", cycles=" << roi.cycles
+                << ", ipc=" << std::fixed << std::setprecision(3) << (roi.cycles ? (double(roi.instrs) / roi.cycles) : 0) << std::endl;
+      std::cout.unsetf(std::ios::floatfield);
+      instrs += roi.instrs;
+      cycles += roi.cycles;
+    }
+    std::cout << "ROIS: count=" << rois_.size() << ", instrs=" << instrs << ", cycles=" << cycles
+              << ", ipc=" << std::fixed << std::setprecision(3) << (cycles ? (double(instrs) / cycles) : 0) << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+  }
+  if (!samples_.empty() && simpoints_) {
+    // weighted CPI over the simulation points that were reached
+    double cpi = 0, weights = 0;
+    for (auto& sample : samples_) {
+      std::cout << "SIMPOINT: interval=" << sample.interval << ", weight=" << std::setprecision(3) << sample.weight
+                << ", PC=0x" << std::hex << sample.PC << std::dec
+                << ", instrs=" << sample.instrs << ", cycles=" << sample.cycles
+                << ", ipc=" << std::fixed << std::setprecision(3) << (double(sample.instrs) / sample.cycles) << std::endl;
+      std::cout.unsetf(std::ios::floatfield);
+      cpi += sample.weight * sample.cycles / sample.instrs;
+      weights += sample.weight;
+    }
+    cpi /= weights;
+    uint64_t instrs = emulator_->perf_stats().instrs + core_->perf_stats().instrs;
+    std::cout << "SIMPOINTS: points=" << samples_.size() << ", weight=" << weights << ", instrs=" << instrs
+              << std::fixed << std::setprecision(3) << ", cpi=" << cpi << ", ipc=" << (1 / cpi);
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << ", est_cycles=" << uint64_t(cpi * instrs) << std::endl;
+  } else if (!samples_.empty()) {
+    // mean CPI over the windows, with its 95% confidence interval
+    double mean = 0;
+    for (size_t i = 0; i < samples_.size(); ++i) {
+      auto& sample = samples_[i];
+      std::cout << "SAMPLE: #" << i << ", PC=0x" << std::hex << sample.PC << std::dec
+                << ", instrs=" << sample.instrs << ", cycles=" << sample.cycles
+                << ", ipc=" << std::fixed << std::setprecision(3) << (double(sample.instrs) / sample.cycles) << std::endl;
+      std::cout.unsetf(std::ios::floatfield);
+      mean += double(sample.cycles) / sample.instrs;
+    }
+    size_t n = samples_.size();
+    mean /= n;
+    double var = 0;
+    for (auto& sample : samples_) {
+      double cpi = double(sample.cycles) / sample.instrs;
+      var += (cpi - mean) * (cpi - mean);
+    }
+    uint64_t instrs = emulator_->perf_stats().instrs + core_->perf_stats().instrs;
+    std::cout << "SAMPLING: samples=" << n << ", instrs=" << instrs << std::fixed << std::setprecision(3)
+              << ", cpi=" << mean;
+    if (n > 1) {
+      double ci = 1.96 * std::sqrt(var / (n - 1) / n);
+      std::cout << " +/- " << ci << " (" << std::setprecision(1) << (100 * ci / mean) << "%)";
+    }
+    std::cout << std::setprecision(3) << ", ipc=" << (1 / mean);
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << ", est_cycles=" << uint64_t(mean * instrs) << std::endl;
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Processor::Processor()
-  : impl_(new ProcessorImpl())
+Processor::Processor(const CoreConfig& config)
+  : impl_(new ProcessorImpl(config))
 {}
 
 Processor::~Processor() {
@@ -71,8 +468,44 @@ void Processor::attach_ram(RAM* mem) {
   impl_->attach_ram(mem);
 }
 
-int Processor::run(bool riscv_test) {
-  return impl_->run(riscv_test);
+void Processor::attach_trace(MemTraceWriter* trace) {
+  impl_->attach_trace(trace);
+}
+
+void Processor::attach_reuse(ReuseProfiler* reuse) {
+  impl_->attach_reuse(reuse);
+}
+
+void Processor::attach_checker(Checker* checker) {
+  impl_->attach_checker(checker);
+}
+
+int Processor::run(bool riscv_test, uint64_t ffwd_instrs) {
+  return impl_->run(riscv_test, ffwd_instrs);
+}
+
+int Processor::emulate(bool riscv_test, bool warm) {
+  return impl_->emulate(riscv_test, warm);
+}
+
+int Processor::sample(bool riscv_test, uint64_t period, uint64_t warmup, uint64_t window) {
+  return impl_->sample(riscv_test, period, warmup, window);
+}
+
+int Processor::profile(bool riscv_test, SimPoint* simpoint) {
+  return impl_->profile(riscv_test, simpoint);
+}
+
+int Processor::run_simpoints(bool riscv_test, const SimPoint& simpoint) {
+  return impl_->run_simpoints(riscv_test, simpoint);
+}
+
+bool Processor::save_state(const char* filename) const {
+  return impl_->save_state(filename);
+}
+
+bool Processor::load_state(const char* filename) {
+  return impl_->load_state(filename);
 }
 
 void Processor::showStats() {
@@ -0,0 +1,238 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include "replacement.h"
+
+using namespace tinyrv;
+
+PackedFields::PackedFields(uint32_t num_sets, uint32_t num_fields, uint32_t width)
+  : width_(width)
+  , fields_per_word_(64 / width)
+  , words_per_set_((num_fields + fields_per_word_ - 1) / fields_per_word_)
+  , mask_((uint64_t(1) << width) - 1) {
+  assert(width > 0 && width <= 32);
+  words_.resize(uint64_t(num_sets) * words_per_set_, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReplacementPolicy::Ptr ReplacementPolicy::Create(ReplPolicy policy, uint32_t num_sets, uint32_t num_ways) {
+  switch (policy) {
+  case ReplPolicy::LRU:    return std::make_shared<LRUPolicy>(num_sets, num_ways);
+  case ReplPolicy::PLRU:   return std::make_shared<PLRUPolicy>(num_sets, num_ways);
+  case ReplPolicy::RANDOM: return std::make_shared<RandomPolicy>(num_sets, num_ways);
+  case ReplPolicy::SRRIP:  return std::make_shared<RRIPPolicy>(num_sets, num_ways, false);
+  case ReplPolicy::BRRIP:  return std::make_shared<RRIPPolicy>(num_sets, num_ways, true);
+  default:
+    std::abort();
+  }
+  return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+LRUPolicy::LRUPolicy(uint32_t num_sets, uint32_t num_ways)
+  : ReplacementPolicy(num_sets, num_ways)
+  , ages_(num_sets, num_ways, log2up(num_ways)) {
+  this->reset();
+}
+
+void LRUPolicy::reset() {
+  // ages start as a permutation so that a single oldest way always exists
+  for (uint32_t s = 0; s < num_sets_; ++s) {
+    for (uint32_t w = 0; w < num_ways_; ++w) {
+      ages_.set(s, w, w);
+    }
+  }
+}
+
+void LRUPolicy::touch(uint32_t set, uint32_t way) {
+  uint32_t age = ages_.get(set, way);
+  for (uint32_t w = 0; w < num_ways_; ++w) {
+    uint32_t a = ages_.get(set, w);
+    if (a < age) {
+      ages_.set(set, w, a + 1);
+    }
+  }
+  ages_.set(set, way, 0);
+}
+
+void LRUPolicy::insert(uint32_t set, uint32_t way) {
+  this->touch(set, way);
+}
+
+uint32_t LRUPolicy::victim(uint32_t set) {
+  uint32_t victim = 0;
+  uint32_t max_age = 0;
+  for (uint32_t w = 0; w < num_ways_; ++w) {
+    uint32_t a = ages_.get(set, w);
+    if (a >= max_age) {
+      max_age = a;
+      victim = w;
+    }
+  }
+  return victim;
+}
+
+
+void LRUPolicy::save_state(StateWriter& writer, const std::string& prefix) const {
+  ages_.save_state(writer, prefix + ".ages");
+}
+
+bool LRUPolicy::load_state(const StateReader& reader, const std::string& prefix) {
+  return ages_.load_state(reader, prefix + ".ages");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+PLRUPolicy::PLRUPolicy(uint32_t num_sets, uint32_t num_ways)
+  : ReplacementPolicy(num_sets, num_ways)
+  , tree_(num_sets, num_ways - 1, 1)
+  , levels_(log2ceil(num_ways)) {
+  assert(ispow2(num_ways));
+  this->reset();
+}
+
+void PLRUPolicy::reset() {
+  tree_.clear();
+}
+
+void PLRUPolicy::touch(uint32_t set, uint32_t way) {
+  // point every node on the path away from the accessed way
+  uint32_t node = 0;
+  for (uint32_t l = 0; l < levels_; ++l) {
+    uint32_t dir = (way >> (levels_ - 1 - l)) & 0x1;
+    tree_.set(set, node, !dir);
+    node = 2 * node + 1 + dir;
+  }
+}
+
+void PLRUPolicy::insert(uint32_t set, uint32_t way) {
+  this->touch(set, way);
+}
+
+uint32_t PLRUPolicy::victim(uint32_t set) {
+  uint32_t node = 0;
+  uint32_t way = 0;
+  for (uint32_t l = 0; l < levels_; ++l) {
+    uint32_t dir = tree_.get(set, node);
+    way = (way << 1) | dir;
+    node = 2 * node + 1 + dir;
+  }
+  return way;
+}
+
+
+void PLRUPolicy::save_state(StateWriter& writer, const std::string& prefix) const {
+  tree_.save_state(writer, prefix + ".tree");
+}
+
+bool PLRUPolicy::load_state(const StateReader& reader, const std::string& prefix) {
+  return tree_.load_state(reader, prefix + ".tree");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RandomPolicy::RandomPolicy(uint32_t num_sets, uint32_t num_ways)
+  : ReplacementPolicy(num_sets, num_ways) {
+  this->reset();
+}
+
+void RandomPolicy::reset() {
+  seed_ = 0x2545f491;
+}
+
+void RandomPolicy::touch(uint32_t /*set*/, uint32_t /*way*/) {
+  //--
+}
+
+void RandomPolicy::insert(uint32_t /*set*/, uint32_t /*way*/) {
+  //--
+}
+
+uint32_t RandomPolicy::victim(uint32_t /*set*/) {
+  // xorshift32
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  return seed_ % num_ways_;
+}
+
+
+void RandomPolicy::save_state(StateWriter& writer, const std::string& prefix) const {
+  writer.write(prefix + ".seed", &seed_, sizeof(seed_));
+}
+
+bool RandomPolicy::load_state(const StateReader& reader, const std::string& prefix) {
+  return reader.read(prefix + ".seed", &seed_, sizeof(seed_));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+#define RRPV_MAX     3
+#define RRPV_LONG    2
+#define BRRIP_PERIOD 32
+
+RRIPPolicy::RRIPPolicy(uint32_t num_sets, uint32_t num_ways, bool bimodal)
+  : ReplacementPolicy(num_sets, num_ways)
+  , rrpv_(num_sets, num_ways, 2)
+  , bimodal_(bimodal) {
+  this->reset();
+}
+
+void RRIPPolicy::reset() {
+  for (uint32_t s = 0; s < num_sets_; ++s) {
+    for (uint32_t w = 0; w < num_ways_; ++w) {
+      rrpv_.set(s, w, RRPV_MAX);
+    }
+  }
+  bip_ctr_ = 0;
+}
+
+void RRIPPolicy::touch(uint32_t set, uint32_t way) {
+  rrpv_.set(set, way, 0);
+}
+
+void RRIPPolicy::insert(uint32_t set, uint32_t way) {
+  uint32_t rrpv = RRPV_LONG;
+  if (bimodal_) {
+    // distant insertion except once every BRRIP_PERIOD fills
+    rrpv = (++bip_ctr_ % BRRIP_PERIOD) ? RRPV_MAX : RRPV_LONG;
+  }
+  rrpv_.set(set, way, rrpv);
+}
+
+uint32_t RRIPPolicy::victim(uint32_t set) {
+  while (true) {
+    for (uint32_t w = 0; w < num_ways_; ++w) {
+      if (rrpv_.get(set, w) == RRPV_MAX)
+        return w;
+    }
+    for (uint32_t w = 0; w < num_ways_; ++w) {
+      rrpv_.set(set, w, rrpv_.get(set, w) + 1);
+    }
+  }
+}
+
+void RRIPPolicy::save_state(StateWriter& writer, const std::string& prefix) const {
+  rrpv_.save_state(writer, prefix + ".rrpv");
+  writer.write(prefix + ".bip_ctr", &bip_ctr_, sizeof(bip_ctr_));
+}
+
+bool RRIPPolicy::load_state(const StateReader& reader, const std::string& prefix) {
+  return rrpv_.load_state(reader, prefix + ".rrpv")
+      && reader.read(prefix + ".bip_ctr", &bip_ctr_, sizeof(bip_ctr_));
+}
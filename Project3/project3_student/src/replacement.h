@@ -0,0 +1,203 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <iostream>
+#include <assert.h>
+#include "statefile.h"
+
+namespace tinyrv {
+
+enum class ReplPolicy {
+  LRU,
+  PLRU,
+  RANDOM,
+  SRRIP,
+  BRRIP
+};
+
+inline std::ostream &operator<<(std::ostream &os, const ReplPolicy& policy) {
+  switch (policy) {
+  case ReplPolicy::LRU:    os << "LRU"; break;
+  case ReplPolicy::PLRU:   os << "PLRU"; break;
+  case ReplPolicy::RANDOM: os << "RANDOM"; break;
+  case ReplPolicy::SRRIP:  os << "SRRIP"; break;
+  case ReplPolicy::BRRIP:  os << "BRRIP"; break;
+  default: assert(false);
+  }
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Bit-packed per-set metadata.
+// Each set owns a whole number of 64-bit words holding fixed-width fields,
+// a field never straddles two words.
+class PackedFields {
+public:
+  PackedFields(uint32_t num_sets, uint32_t num_fields, uint32_t width);
+
+  uint32_t get(uint32_t set, uint32_t field) const {
+    auto word = words_[set * words_per_set_ + field / fields_per_word_];
+    return (word >> ((field % fields_per_word_) * width_)) & mask_;
+  }
+
+  void set(uint32_t set, uint32_t field, uint32_t value) {
+    auto& word = words_[set * words_per_set_ + field / fields_per_word_];
+    uint32_t shift = (field % fields_per_word_) * width_;
+    word = (word & ~(mask_ << shift)) | ((uint64_t(value) & mask_) << shift);
+  }
+
+  void clear() {
+    std::fill(words_.begin(), words_.end(), 0);
+  }
+
+  void save_state(StateWriter& writer, const std::string& name) const {
+    writer.write(name, words_);
+  }
+
+  bool load_state(const StateReader& reader, const std::string& name) {
+    return reader.read(name, &words_);
+  }
+
+private:
+  std::vector<uint64_t> words_;
+  uint32_t width_;
+  uint32_t fields_per_word_;
+  uint32_t words_per_set_;
+  uint64_t mask_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Replacement policy interface.
+// The cache picks invalid ways on its own and only asks the policy
+// for a victim when the set is full.
+class ReplacementPolicy {
+public:
+  typedef std::shared_ptr<ReplacementPolicy> Ptr;
+
+  static Ptr Create(ReplPolicy policy, uint32_t num_sets, uint32_t num_ways);
+
+  virtual ~ReplacementPolicy() {}
+
+  // reset all sets to their initial state
+  virtual void reset() = 0;
+
+  // a cache hit on the given way
+  virtual void touch(uint32_t set, uint32_t way) = 0;
+
+  // a new block was filled into the given way
+  virtual void insert(uint32_t set, uint32_t way) = 0;
+
+  // select the way to evict from a full set
+  virtual uint32_t victim(uint32_t set) = 0;
+
+  // warm-start: the per-set state under the given section prefix
+  virtual void save_state(StateWriter& writer, const std::string& prefix) const = 0;
+  virtual bool load_state(const StateReader& reader, const std::string& prefix) = 0;
+
+  uint32_t num_sets() const {
+    return num_sets_;
+  }
+
+  uint32_t num_ways() const {
+    return num_ways_;
+  }
+
+protected:
+  ReplacementPolicy(uint32_t num_sets, uint32_t num_ways)
+    : num_sets_(num_sets)
+    , num_ways_(num_ways)
+  {}
+
+  uint32_t num_sets_;
+  uint32_t num_ways_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// True LRU using a log2(ways)-bit age per way (0 = most recently used).
+class LRUPolicy : public ReplacementPolicy {
+public:
+  LRUPolicy(uint32_t num_sets, uint32_t num_ways);
+
+  void reset() override;
+  void touch(uint32_t set, uint32_t way) override;
+  void insert(uint32_t set, uint32_t way) override;
+  uint32_t victim(uint32_t set) override;
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
+private:
+  PackedFields ages_;
+};
+
+// Tree pseudo-LRU using (ways - 1) bits per set.
+class PLRUPolicy : public ReplacementPolicy {
+public:
+  PLRUPolicy(uint32_t num_sets, uint32_t num_ways);
+
+  void reset() override;
+  void touch(uint32_t set, uint32_t way) override;
+  void insert(uint32_t set, uint32_t way) override;
+  uint32_t victim(uint32_t set) override;
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
+private:
+  PackedFields tree_;
+  uint32_t levels_;
+};
+
+// Random replacement (no per-set state).
+class RandomPolicy : public ReplacementPolicy {
+public:
+  RandomPolicy(uint32_t num_sets, uint32_t num_ways);
+
+  void reset() override;
+  void touch(uint32_t set, uint32_t way) override;
+  void insert(uint32_t set, uint32_t way) override;
+  uint32_t victim(uint32_t set) override;
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
+private:
+  uint32_t seed_;
+};
+
+// Re-reference interval prediction using a 2-bit RRPV per way.
+// SRRIP inserts with a long re-reference interval, BRRIP inserts with a
+// distant interval and only occasionally with a long one.
+class RRIPPolicy : public ReplacementPolicy {
+public:
+  RRIPPolicy(uint32_t num_sets, uint32_t num_ways, bool bimodal);
+
+  void reset() override;
+  void touch(uint32_t set, uint32_t way) override;
+  void insert(uint32_t set, uint32_t way) override;
+  uint32_t victim(uint32_t set) override;
+  void save_state(StateWriter& writer, const std::string& prefix) const override;
+  bool load_state(const StateReader& reader, const std::string& prefix) override;
+
+private:
+  PackedFields rrpv_;
+  bool bimodal_;
+  uint32_t bip_ctr_;
+};
+
+}
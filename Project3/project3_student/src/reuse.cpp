@@ -0,0 +1,142 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+#include <util.h>
+#include "reuse.h"
+
+using namespace tinyrv;
+
+static const uint64_t REUSE_INIT_CAPACITY = 64 * 1024;
+
+ReuseHistogram::ReuseHistogram(uint32_t line_size)
+  : line_shift_(log2ceil(line_size))
+  , tree_(REUSE_INIT_CAPACITY + 1, 0)
+  , now_(0)
+  , live_(0)
+  , accesses_(0)
+  , cold_misses_(0) {
+  assert(ispow2(line_size));
+}
+
+void ReuseHistogram::mark(uint64_t pos, int delta) {
+  for (uint64_t i = pos + 1; i < tree_.size(); i += (i & -i)) {
+    tree_[i] += delta;
+  }
+}
+
+uint64_t ReuseHistogram::prefix(uint64_t pos) const {
+  // number of marked positions in [0, pos]
+  uint64_t sum = 0;
+  for (uint64_t i = pos + 1; i != 0; i -= (i & -i)) {
+    sum += tree_[i];
+  }
+  return sum;
+}
+
+void ReuseHistogram::compact() {
+  // renumber the live positions densely, preserving their order,
+  // and grow the tree if more than half of it stays occupied.
+  std::vector<std::pair<uint64_t, uint64_t>> live;
+  live.reserve(last_access_.size());
+  for (auto& entry : last_access_) {
+    live.emplace_back(entry.second, entry.first);
+  }
+  std::sort(live.begin(), live.end());
+
+  uint64_t capacity = tree_.size() - 1;
+  while (live.size() * 2 > capacity) {
+    capacity *= 2;
+  }
+  tree_.assign(capacity + 1, 0);
+
+  now_ = 0;
+  for (auto& entry : live) {
+    last_access_[entry.second] = now_;
+    this->mark(now_, 1);
+    ++now_;
+  }
+}
+
+void ReuseHistogram::access(uint64_t addr) {
+  uint64_t line = addr >> line_shift_;
+  ++accesses_;
+
+  if (now_ == tree_.size() - 1) {
+    this->compact();
+  }
+
+  auto it = last_access_.find(line);
+  if (it != last_access_.end()) {
+    // distinct lines accessed after the previous access to this line
+    uint64_t distance = live_ - this->prefix(it->second);
+    if (distance >= histogram_.size()) {
+      histogram_.resize(distance + 1, 0);
+    }
+    ++histogram_[distance];
+    this->mark(it->second, -1);
+    it->second = now_;
+  } else {
+    ++cold_misses_;
+    ++live_;
+    last_access_.emplace(line, now_);
+  }
+  this->mark(now_, 1);
+  ++now_;
+}
+
+uint64_t ReuseHistogram::misses(uint64_t num_lines) const {
+  uint64_t misses = cold_misses_;
+  for (uint64_t d = num_lines; d < histogram_.size(); ++d) {
+    misses += histogram_[d];
+  }
+  return misses;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ReuseProfiler::ReuseProfiler(uint32_t line_size)
+  : line_size_(line_size)
+  , inst_(line_size)
+  , data_(line_size)
+  , unified_(line_size)
+{}
+
+void ReuseProfiler::access(const MemRef& ref) {
+  if (ref.type == MemRefType::FETCH) {
+    inst_.access(ref.addr);
+  } else {
+    data_.access(ref.addr);
+  }
+  unified_.access(ref.addr);
+}
+
+void ReuseProfiler::dump_csv(std::ostream& os) const {
+  auto miss_ratio = [](const ReuseHistogram& hist, uint64_t num_lines) {
+    return hist.accesses() ? (double(hist.misses(num_lines)) / hist.accesses()) : 0;
+  };
+
+  uint64_t max_lines = std::max({inst_.max_lines(), data_.max_lines(), unified_.max_lines(), uint64_t(1)});
+
+  os << "lines,size,inst_miss_ratio,data_miss_ratio,miss_ratio" << std::endl;
+  for (uint64_t lines = 1;; lines *= 2) {
+    os << lines << "," << lines * line_size_
+       << "," << miss_ratio(inst_, lines)
+       << "," << miss_ratio(data_, lines)
+       << "," << miss_ratio(unified_, lines) << std::endl;
+    if (lines >= max_lines)
+      break;
+  }
+}
@@ -0,0 +1,85 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include "memtrace.h"
+
+namespace tinyrv {
+
+// Reuse (LRU stack) distance histogram at cache-line granularity.
+// The distance of an access is the number of distinct lines touched since
+// the previous access to the same line. Each line's last access time is
+// marked in a Fenwick tree, so the distance is a prefix-sum query and
+// every access costs O(log n).
+class ReuseHistogram {
+public:
+  ReuseHistogram(uint32_t line_size);
+
+  void access(uint64_t addr);
+
+  // misses of a fully-associative LRU cache holding the given lines
+  uint64_t misses(uint64_t num_lines) const;
+
+  uint64_t accesses() const {
+    return accesses_;
+  }
+
+  uint64_t cold_misses() const {
+    return cold_misses_;
+  }
+
+  // largest finite distance + 1, the capacity that removes all reuse misses
+  uint64_t max_lines() const {
+    return histogram_.size();
+  }
+
+private:
+
+  void mark(uint64_t pos, int delta);
+
+  uint64_t prefix(uint64_t pos) const;
+
+  void compact();
+
+  uint32_t line_shift_;
+  std::unordered_map<uint64_t, uint64_t> last_access_;
+  std::vector<uint32_t> tree_;
+  uint64_t now_;
+  uint64_t live_;
+  std::vector<uint64_t> histogram_;
+  uint64_t accesses_;
+  uint64_t cold_misses_;
+};
+
+// Reuse-distance profiler for the instruction, data and unified streams.
+class ReuseProfiler {
+public:
+  ReuseProfiler(uint32_t line_size);
+
+  void access(const MemRef& ref);
+
+  // miss-ratio curve for every power-of-two capacity
+  void dump_csv(std::ostream& os) const;
+
+private:
+  uint32_t line_size_;
+  ReuseHistogram inst_;
+  ReuseHistogram data_;
+  ReuseHistogram unified_;
+};
+
+}
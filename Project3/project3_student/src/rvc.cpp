@@ -0,0 +1,222 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "rvc.h"
+
+using namespace tinyrv;
+
+namespace {
+
+enum {
+  OP_L     = 0x03,
+  OP_I     = 0x13,
+  OP_S     = 0x23,
+  OP_R     = 0x33,
+  OP_LUI   = 0x37,
+  OP_B     = 0x63,
+  OP_JALR  = 0x67,
+  OP_JAL   = 0x6f,
+  EBREAK   = 0x00100073,
+};
+
+inline uint32_t bits(uint32_t code, uint32_t hi, uint32_t lo) {
+  return (code >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+inline uint32_t bit(uint32_t code, uint32_t pos) {
+  return (code >> pos) & 0x1;
+}
+
+inline uint32_t sext(uint32_t value, uint32_t width) {
+  uint32_t shift = 32 - width;
+  return uint32_t(int32_t(value << shift) >> shift);
+}
+
+// 3-bit register fields address x8-x15
+inline uint32_t creg(uint32_t field) {
+  return field + 8;
+}
+
+inline uint32_t enc_r(uint32_t func7, uint32_t rs2, uint32_t rs1, uint32_t func3, uint32_t rd, uint32_t opcode) {
+  return (func7 << 25) | (rs2 << 20) | (rs1 << 15) | (func3 << 12) | (rd << 7) | opcode;
+}
+
+inline uint32_t enc_i(uint32_t imm, uint32_t rs1, uint32_t func3, uint32_t rd, uint32_t opcode) {
+  return ((imm & 0xfff) << 20) | (rs1 << 15) | (func3 << 12) | (rd << 7) | opcode;
+}
+
+inline uint32_t enc_s(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t func3, uint32_t opcode) {
+  return (bits(imm, 11, 5) << 25) | (rs2 << 20) | (rs1 << 15) | (func3 << 12) | (bits(imm, 4, 0) << 7) | opcode;
+}
+
+inline uint32_t enc_b(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t func3, uint32_t opcode) {
+  return (bit(imm, 12) << 31) | (bits(imm, 10, 5) << 25) | (rs2 << 20) | (rs1 << 15) | (func3 << 12)
+       | (bits(imm, 4, 1) << 8) | (bit(imm, 11) << 7) | opcode;
+}
+
+inline uint32_t enc_u(uint32_t imm, uint32_t rd, uint32_t opcode) {
+  return (imm & 0xfffff000) | (rd << 7) | opcode;
+}
+
+inline uint32_t enc_j(uint32_t imm, uint32_t rd, uint32_t opcode) {
+  return (bit(imm, 20) << 31) | (bits(imm, 10, 1) << 21) | (bit(imm, 11) << 20) | (bits(imm, 19, 12) << 12)
+       | (rd << 7) | opcode;
+}
+
+// CJ-format jump offset
+inline uint32_t cj_imm(uint32_t code) {
+  return sext((bit(code, 12) << 11) | (bit(code, 11) << 4) | (bits(code, 10, 9) << 8) | (bit(code, 8) << 10)
+            | (bit(code, 7) << 6) | (bit(code, 6) << 7) | (bits(code, 5, 3) << 1) | (bit(code, 2) << 5), 12);
+}
+
+// CB-format branch offset
+inline uint32_t cb_imm(uint32_t code) {
+  return sext((bit(code, 12) << 8) | (bits(code, 11, 10) << 3) | (bits(code, 6, 5) << 6)
+            | (bits(code, 4, 3) << 1) | (bit(code, 2) << 5), 9);
+}
+
+// CI-format 6-bit signed immediate
+inline uint32_t ci_imm(uint32_t code) {
+  return sext((bit(code, 12) << 5) | bits(code, 6, 2), 6);
+}
+
+// CL/CS-format word offset
+inline uint32_t clw_imm(uint32_t code) {
+  return (bits(code, 12, 10) << 3) | (bit(code, 6) << 2) | (bit(code, 5) << 6);
+}
+
+uint32_t expand_q0(uint32_t code) {
+  uint32_t rd  = creg(bits(code, 4, 2));
+  uint32_t rs1 = creg(bits(code, 9, 7));
+  switch (bits(code, 15, 13)) {
+  case 0: { // C.ADDI4SPN
+    uint32_t imm = (bits(code, 12, 11) << 4) | (bits(code, 10, 7) << 6) | (bit(code, 6) << 2) | (bit(code, 5) << 3);
+    if (imm == 0)
+      return 0;
+    return enc_i(imm, 2, 0, rd, OP_I);
+  }
+  case 2: // C.LW
+    return enc_i(clw_imm(code), rs1, 2, rd, OP_L);
+  case 6: // C.SW
+    return enc_s(clw_imm(code), rd, rs1, 2, OP_S);
+  default: // floating-point loads/stores and reserved
+    return 0;
+  }
+}
+
+uint32_t expand_q1(uint32_t code) {
+  uint32_t rd = bits(code, 11, 7);
+  switch (bits(code, 15, 13)) {
+  case 0: // C.ADDI, C.NOP
+    return enc_i(ci_imm(code), rd, 0, rd, OP_I);
+  case 1: // C.JAL
+    return enc_j(cj_imm(code), 1, OP_JAL);
+  case 2: // C.LI
+    return enc_i(ci_imm(code), 0, 0, rd, OP_I);
+  case 3: {
+    if (rd == 2) { // C.ADDI16SP
+      uint32_t imm = sext((bit(code, 12) << 9) | (bit(code, 6) << 4) | (bit(code, 5) << 6)
+                        | (bits(code, 4, 3) << 7) | (bit(code, 2) << 5), 10);
+      if (imm == 0)
+        return 0;
+      return enc_i(imm, 2, 0, 2, OP_I);
+    }
+    // C.LUI
+    uint32_t imm = sext((bit(code, 12) << 17) | (bits(code, 6, 2) << 12), 18);
+    if (imm == 0)
+      return 0;
+    return enc_u(imm, rd, OP_LUI);
+  }
+  case 4: {
+    uint32_t rd_c = creg(bits(code, 9, 7));
+    uint32_t rs2_c = creg(bits(code, 4, 2));
+    switch (bits(code, 11, 10)) {
+    case 0: // C.SRLI
+      if (bit(code, 12))
+        return 0;
+      return enc_i(bits(code, 6, 2), rd_c, 5, rd_c, OP_I);
+    case 1: // C.SRAI
+      if (bit(code, 12))
+        return 0;
+      return enc_i(0x400 | bits(code, 6, 2), rd_c, 5, rd_c, OP_I);
+    case 2: // C.ANDI
+      return enc_i(ci_imm(code), rd_c, 7, rd_c, OP_I);
+    default:
+      if (bit(code, 12)) // RV64 only
+        return 0;
+      switch (bits(code, 6, 5)) {
+      case 0: return enc_r(0x20, rs2_c, rd_c, 0, rd_c, OP_R); // C.SUB
+      case 1: return enc_r(0x00, rs2_c, rd_c, 4, rd_c, OP_R); // C.XOR
+      case 2: return enc_r(0x00, rs2_c, rd_c, 6, rd_c, OP_R); // C.OR
+      default: return enc_r(0x00, rs2_c, rd_c, 7, rd_c, OP_R); // C.AND
+      }
+    }
+  }
+  case 5: // C.J
+    return enc_j(cj_imm(code), 0, OP_JAL);
+  case 6: // C.BEQZ
+    return enc_b(cb_imm(code), 0, creg(bits(code, 9, 7)), 0, OP_B);
+  default: // C.BNEZ
+    return enc_b(cb_imm(code), 0, creg(bits(code, 9, 7)), 1, OP_B);
+  }
+}
+
+uint32_t expand_q2(uint32_t code) {
+  uint32_t rd  = bits(code, 11, 7);
+  uint32_t rs2 = bits(code, 6, 2);
+  switch (bits(code, 15, 13)) {
+  case 0: // C.SLLI
+    if (bit(code, 12))
+      return 0;
+    return enc_i(rs2, rd, 1, rd, OP_I);
+  case 2: { // C.LWSP
+    if (rd == 0)
+      return 0;
+    uint32_t imm = (bit(code, 12) << 5) | (bits(code, 6, 4) << 2) | (bits(code, 3, 2) << 6);
+    return enc_i(imm, 2, 2, rd, OP_L);
+  }
+  case 4:
+    if (bit(code, 12) == 0) {
+      if (rs2 == 0) { // C.JR
+        if (rd == 0)
+          return 0;
+        return enc_i(0, rd, 0, 0, OP_JALR);
+      }
+      return enc_r(0, rs2, 0, 0, rd, OP_R); // C.MV
+    }
+    if (rs2 == 0) {
+      if (rd == 0) // C.EBREAK
+        return EBREAK;
+      return enc_i(0, rd, 0, 1, OP_JALR); // C.JALR
+    }
+    return enc_r(0, rs2, rd, 0, rd, OP_R); // C.ADD
+  case 6: { // C.SWSP
+    uint32_t imm = (bits(code, 12, 9) << 2) | (bits(code, 8, 7) << 6);
+    return enc_s(imm, rs2, 2, 2, OP_S);
+  }
+  default: // floating-point loads/stores
+    return 0;
+  }
+}
+
+}
+
+uint32_t tinyrv::rvc_expand(uint32_t instr_code) {
+  uint32_t code = instr_code & 0xffff;
+  switch (code & 0x3) {
+  case 0:  return (code == 0) ? 0 : expand_q0(code);
+  case 1:  return expand_q1(code);
+  case 2:  return expand_q2(code);
+  default: return 0;
+  }
+}
@@ -0,0 +1,122 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <assert.h>
+#include <util.h>
+#include "tracesim.h"
+
+using namespace tinyrv;
+
+static const size_t TRACE_CHUNK_SIZE = 16 * 1024;
+
+TraceSim::config_t::config_t(const CacheArray::Config& config)
+  : array(config)
+  , icache(config)
+  , dcache(config)
+  , fetches({0, 0})
+  , loads({0, 0})
+  , stores({0, 0})
+{}
+
+TraceSim::TraceSim() {
+  //--
+}
+
+TraceSim::~TraceSim() {
+  //--
+}
+
+void TraceSim::add_sweep(const std::vector<uint32_t>& sizes,
+                         const std::vector<uint32_t>& block_sizes,
+                         const std::vector<uint32_t>& ways,
+                         const std::vector<ReplPolicy>& policies) {
+  for (auto size : sizes) {
+    for (auto block_size : block_sizes) {
+      for (auto num_ways : ways) {
+        // skip geometries without a power-of-two number of sets
+        if (size < block_size * num_ways)
+          continue;
+        if (!ispow2(size / (block_size * num_ways)))
+          continue;
+        for (auto policy : policies) {
+          // all policies behave the same on a direct-mapped cache
+          if (num_ways == 1 && policy != policies.front())
+            continue;
+          configs_.emplace_back(CacheArray::Config{size, block_size, num_ways, policy});
+        }
+      }
+    }
+  }
+}
+
+void TraceSim::add_default_sweep() {
+  // 1KB-1MB x 16-128B blocks x 1-16 ways x all policies
+  std::vector<uint32_t> sizes;
+  for (uint32_t size = 1024; size <= 1024 * 1024; size *= 2) {
+    sizes.push_back(size);
+  }
+  this->add_sweep(sizes, {16, 32, 64, 128}, {1, 2, 4, 8, 16}, {
+    ReplPolicy::LRU, ReplPolicy::PLRU, ReplPolicy::RANDOM, ReplPolicy::SRRIP, ReplPolicy::BRRIP
+  });
+}
+
+uint64_t TraceSim::run(const char* trace_file) {
+  MemTraceReader reader(trace_file);
+  uint64_t count = 0;
+
+  // the trace is read once in chunks, each chunk is replayed through one
+  // configuration at a time to keep its arrays hot in the host caches.
+  std::vector<MemRef> chunk;
+  chunk.reserve(TRACE_CHUNK_SIZE);
+  for (;;) {
+    chunk.clear();
+    MemRef ref;
+    while (chunk.size() < TRACE_CHUNK_SIZE && reader.read(&ref)) {
+      chunk.push_back(ref);
+    }
+    if (chunk.empty())
+      break;
+    for (auto& config : configs_) {
+      for (auto& ref : chunk) {
+        // tags-only arrays: fill on every miss (write-allocate)
+        bool is_write = (ref.type == MemRefType::STORE);
+        auto& array = (ref.type == MemRefType::FETCH) ? config.icache : config.dcache;
+        auto& stats = (ref.type == MemRefType::FETCH) ? config.fetches
+                    : (is_write ? config.stores : config.loads);
+        ++stats.accesses;
+        if (!array.lookup(ref.addr, is_write)) {
+          ++stats.misses;
+          array.fill(ref.addr, is_write);
+        }
+      }
+    }
+    count += chunk.size();
+  }
+  return count;
+}
+
+void TraceSim::dump_csv(std::ostream& os) const {
+  os << "size,block_size,ways,policy,fetches,fetch_misses,loads,load_misses,stores,store_misses,imiss_rate,dmiss_rate" << std::endl;
+  for (auto& config : configs_) {
+    uint64_t daccesses = config.loads.accesses + config.stores.accesses;
+    uint64_t dmisses = config.loads.misses + config.stores.misses;
+    double imiss_rate = config.fetches.accesses ? (double(config.fetches.misses) / config.fetches.accesses) : 0;
+    double dmiss_rate = daccesses ? (double(dmisses) / daccesses) : 0;
+    os << config.array.size << "," << config.array.block_size << "," << config.array.ways << "," << config.array.repl
+       << "," << config.fetches.accesses << "," << config.fetches.misses
+       << "," << config.loads.accesses << "," << config.loads.misses
+       << "," << config.stores.accesses << "," << config.stores.misses
+       << "," << imiss_rate << "," << dmiss_rate << std::endl;
+  }
+}
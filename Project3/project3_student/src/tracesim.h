@@ -0,0 +1,71 @@
+// Copyright 2025 Blaise Tine
+//
+// Licensed under the Apache License;
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include "cache.h"
+#include "memtrace.h"
+
+namespace tinyrv {
+
+// Trace-driven cache simulator.
+// Replays a memory-reference trace once through every cache configuration
+// of a parameter sweep, with separate instruction and data caches per
+// configuration, and reports the miss counts as CSV.
+class TraceSim {
+public:
+  TraceSim();
+
+  ~TraceSim();
+
+  // add every valid combination of the given parameters to the sweep
+  void add_sweep(const std::vector<uint32_t>& sizes,
+                 const std::vector<uint32_t>& block_sizes,
+                 const std::vector<uint32_t>& ways,
+                 const std::vector<ReplPolicy>& policies);
+
+  // add the default sweep
+  void add_default_sweep();
+
+  uint64_t run(const char* trace_file);
+
+  void dump_csv(std::ostream& os) const;
+
+  size_t num_configs() const {
+    return configs_.size();
+  }
+
+private:
+
+  struct stats_t {
+    uint64_t accesses;
+    uint64_t misses;
+  };
+
+  struct config_t {
+    CacheArray::Config array;
+    CacheArray icache;
+    CacheArray dcache;
+    stats_t    fetches;
+    stats_t    loads;
+    stats_t    stores;
+
+    config_t(const CacheArray::Config& config);
+  };
+
+  std::vector<config_t> configs_;
+};
+
+}
@@ -65,7 +65,35 @@ enum class AluOp {
   SRL,
   SRA,
   LTI,
-  LTU
+  LTU,
+  MUL,
+  MULH,
+  MULHSU,
+  MULHU,
+  DIV,
+  DIVU,
+  REM,
+  REMU,
+  SH1ADD,
+  SH2ADD,
+  SH3ADD,
+  ANDN,
+  ORN,
+  XNOR,
+  CLZ,
+  CTZ,
+  CPOP,
+  MIN,
+  MINU,
+  MAX,
+  MAXU,
+  SEXTB,
+  SEXTH,
+  ZEXTH,
+  ROL,
+  ROR,
+  REV8,
+  ORCB
 };
 
 inline std::ostream &operator<<(std::ostream &os, const AluOp& op) {
@@ -81,6 +109,34 @@ inline std::ostream &operator<<(std::ostream &os, const AluOp& op) {
   case AluOp::SRA:  os << "SRA"; break;
   case AluOp::LTI:  os << "LTI"; break;
   case AluOp::LTU:  os << "LTU"; break;
+  case AluOp::MUL:  os << "MUL"; break;
+  case AluOp::MULH: os << "MULH"; break;
+  case AluOp::MULHSU: os << "MULHSU"; break;
+  case AluOp::MULHU: os << "MULHU"; break;
+  case AluOp::DIV:  os << "DIV"; break;
+  case AluOp::DIVU: os << "DIVU"; break;
+  case AluOp::REM:  os << "REM"; break;
+  case AluOp::REMU: os << "REMU"; break;
+  case AluOp::SH1ADD: os << "SH1ADD"; break;
+  case AluOp::SH2ADD: os << "SH2ADD"; break;
+  case AluOp::SH3ADD: os << "SH3ADD"; break;
+  case AluOp::ANDN: os << "ANDN"; break;
+  case AluOp::ORN: os << "ORN"; break;
+  case AluOp::XNOR: os << "XNOR"; break;
+  case AluOp::CLZ: os << "CLZ"; break;
+  case AluOp::CTZ: os << "CTZ"; break;
+  case AluOp::CPOP: os << "CPOP"; break;
+  case AluOp::MIN: os << "MIN"; break;
+  case AluOp::MINU: os << "MINU"; break;
+  case AluOp::MAX: os << "MAX"; break;
+  case AluOp::MAXU: os << "MAXU"; break;
+  case AluOp::SEXTB: os << "SEXTB"; break;
+  case AluOp::SEXTH: os << "SEXTH"; break;
+  case AluOp::ZEXTH: os << "ZEXTH"; break;
+  case AluOp::ROL: os << "ROL"; break;
+  case AluOp::ROR: os << "ROR"; break;
+  case AluOp::REV8: os << "REV8"; break;
+  case AluOp::ORCB: os << "ORCB"; break;
   default: assert(false);
   }
   return os;
@@ -154,11 +210,37 @@ inline std::ostream &operator<<(std::ostream &os, const ExeFlags& flags) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// macro-op fusion idioms, FUSE_* in config.h enables each of them
+enum class FuseType {
+  NONE,
+  LUI_ADDI,   // lui/auipc + addi
+  AUIPC_JALR, // auipc + jalr
+  SLLI_ADD,   // slli + add
+  LOAD,       // lui/auipc/addi/add + load
+  COUNT
+};
+
+inline std::ostream &operator<<(std::ostream &os, const FuseType& type) {
+  switch (type) {
+  case FuseType::NONE:       os << "NONE"; break;
+  case FuseType::LUI_ADDI:   os << "LUI_ADDI"; break;
+  case FuseType::AUIPC_JALR: os << "AUIPC_JALR"; break;
+  case FuseType::SLLI_ADD:   os << "SLLI_ADD"; break;
+  case FuseType::LOAD:       os << "LOAD"; break;
+  default: assert(false);
+  }
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 enum class FUType {
   ALU,
   BRU,
   LSU,
   SFU,
+  MUL,
+  DIV,
   NONE
 };
 
@@ -169,11 +251,39 @@ inline std::ostream &operator<<(std::ostream &os, const FUType& type) {
   case FUType::BRU: os << "BRU"; break;
   case FUType::LSU: os << "LSU"; break;
   case FUType::SFU: os << "SFU"; break;
+  case FUType::MUL: os << "MUL"; break;
+  case FUType::DIV: os << "DIV"; break;
   default: assert(false);
   }
   return os;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+struct MemReq {
+  uint64_t addr;    // request address
+  bool     write;   // is write request
+  uint32_t tag;     // requester tag
+};
+
+inline std::ostream &operator<<(std::ostream &os, const MemReq& req) {
+  os << "addr=0x" << std::hex << req.addr << std::dec
+     << ", write=" << req.write
+     << ", tag=" << req.tag;
+  return os;
+}
+
+struct MemRsp {
+  uint32_t tag;     // requester tag
+};
+
+inline std::ostream &operator<<(std::ostream &os, const MemRsp& rsp) {
+  os << "tag=" << rsp.tag;
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 class TicketBarrier  {
 public:
   TicketBarrier () : tick_(0), tock_(0) {}